@@ -0,0 +1,115 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Benchmark:
+   Read a file with a single line value and a multiline value of the
+   given size and split the multiline value with econf_getExtValue and
+   econf_getExtValueView.
+
+   Usage: bench-longvalue [megabytes [iterations]]
+*/
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(int argc, char **argv)
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+  int iterations = argc > 2 ? atoi(argv[2]) : 10;
+  char dir[] = "/tmp/bench-longvalue-XXXXXX";
+  double read_time = 0, ext_time = 0, view_time = 0;
+  char *path;
+  int retval = 0;
+
+  if (iterations <= 0)
+    iterations = 1;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  if (asprintf(&path, "%s/bench.conf", dir) < 0)
+    return 1;
+
+  FILE *out = fopen(path, "w");
+  if (out == NULL)
+    {
+      perror("fopen");
+      return 1;
+    }
+  fputs("cert = ", out);
+  for (size_t i = 0; i < megabytes * 1024 * 1024; i++)
+    putc('A' + i % 26, out);
+  fputs("\nhosts = host-000000000.example.com\n", out);
+  size_t hosts = megabytes * 1024 * 1024 / 32;
+  for (size_t i = 1; i < hosts; i++)
+    fprintf(out, "  host-%09zu.example.com\n", i);
+  fclose(out);
+
+  printf("bench-longvalue: 2 x %zu MB, %d iterations\n", megabytes, iterations);
+  for (int i = 0; i < iterations && !retval; i++)
+    {
+      econf_file *key_file = NULL;
+      econf_ext_value *ext_val;
+      econf_ext_value_view view;
+      econf_err error;
+
+      double start = now();
+      if ((error = econf_readFile(&key_file, path, "=", "#")))
+	{
+	  fprintf (stderr, "ERROR: couldn't read file: %s\n",
+		   econf_errString(error));
+	  retval = 1;
+	  break;
+	}
+      double middle = now();
+      if ((error = econf_getExtValue(key_file, NULL, "hosts", &ext_val)))
+	{
+	  fprintf (stderr, "ERROR: couldn't get hosts: %s\n",
+		   econf_errString(error));
+	  retval = 1;
+	}
+      else
+	econf_freeExtValue(ext_val);
+      double end = now();
+      if (!retval &&
+	  (error = econf_getExtValueView(key_file, NULL, "hosts", &view)))
+	{
+	  fprintf (stderr, "ERROR: couldn't get view of hosts: %s\n",
+		   econf_errString(error));
+	  retval = 1;
+	}
+      view_time += now() - end;
+      ext_time += end - middle;
+      read_time += middle - start;
+      econf_free(key_file);
+    }
+  if (!retval)
+    {
+      printf("%-12s %10.3f ms\n", "readFile", read_time * 1000 / iterations);
+      printf("%-12s %10.3f ms\n", "getExtValue", ext_time * 1000 / iterations);
+      printf("%-12s %10.3f ms\n", "view", view_time * 1000 / iterations);
+    }
+
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
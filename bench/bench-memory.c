@@ -0,0 +1,172 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Benchmark:
+   Report the heap memory used by econf_memoryUsage() for representative
+   configurations: a small daemon configuration, a medium sized one with
+   and without comments, a large flat one and a vendor configuration
+   merged with drop-in files, which is also published and attached
+   again (see econf_attach()). Every file is looked up once before
+   measuring, so the lookup index is included.
+
+   Usage: bench-memory
+*/
+
+#define KEYS_PER_GROUP 20
+
+/* Write keys keys starting with first_key, a comment before every group
+   and before every fourth key, and return the size of the file.  */
+static long
+generate(const char *path, size_t keys, size_t first_key, int groups)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL)
+    {
+      perror(path);
+      exit(1);
+    }
+  for (size_t key = first_key; key < first_key + keys; key++)
+    {
+      if (groups && (key == first_key || key % KEYS_PER_GROUP == 0))
+	fprintf(fp, "\n# Settings of group %zu\n[group%zu]\n",
+		key / KEYS_PER_GROUP, key / KEYS_PER_GROUP);
+      if (key % 4 == 0)
+	fprintf(fp, "# Description of option%zu\n", key);
+      switch (key % 3)
+	{
+	case 0:
+	  fprintf(fp, "option%zu = %zu\n", key, key);
+	  break;
+	case 1:
+	  fprintf(fp, "option%zu = yes # default\n", key);
+	  break;
+	default:
+	  fprintf(fp, "option%zu = /usr/lib/example/%zu\n", key, key);
+	}
+    }
+  long size = ftell(fp);
+  fclose(fp);
+  return size;
+}
+
+static void
+check(econf_err error, const char *what)
+{
+  if (error)
+    {
+      fprintf(stderr, "ERROR: %s: %s\n", what, econf_errString(error));
+      exit(1);
+    }
+}
+
+static void
+report(const char *name, econf_file *key_file, long file_size)
+{
+  econf_memory_usage usage;
+  char *value = NULL;
+
+  /* Builds the index */
+  econf_getStringValue(key_file, "group0", "option0", &value);
+  free(value);
+  check(econf_memoryUsage(key_file, &usage), "econf_memoryUsage");
+
+  printf("%-16s %8zu %9ld %10zu %8.1f %9zu %9zu %9zu %9zu %9zu %9zu %7zu %9zu\n",
+	 name, usage.entry_count, file_size, usage.total,
+	 usage.entry_count ? (double) usage.total / usage.entry_count : 0,
+	 usage.entries, usage.slack, usage.strings, usage.comments,
+	 usage.source, usage.index, usage.other, usage.shared);
+  econf_free(key_file);
+}
+
+static void
+bench_file(const char *dir, const char *name, size_t keys, int groups,
+	   const econf_options *options)
+{
+  char path[PATH_MAX];
+  econf_file *key_file;
+
+  snprintf(path, sizeof(path), "%s/%s.conf", dir, name);
+  long size = generate(path, keys, 0, groups);
+  check(econf_readFileWithOptions(&key_file, path, "=", "#", options),
+	"econf_readFileWithOptions");
+  report(name, key_file, size);
+  unlink(path);
+}
+
+int
+main(void)
+{
+  char dir[] = "/tmp/bench-memory-XXXXXX";
+  char path[PATH_MAX], usr[64], etc[64], dropins[128];
+  econf_options *options;
+  econf_file *key_file;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  check(econf_newOptions(&options), "econf_newOptions");
+  check(econf_setOpt(options, ECONF_OPT_DISCARD_COMMENTS, true),
+	"econf_setOpt");
+
+  printf("%-16s %8s %9s %10s %8s %9s %9s %9s %9s %9s %9s %7s %9s\n",
+	 "config", "entries", "file", "total", "B/entry", "entries", "slack",
+	 "strings", "comments", "source", "index", "other", "shared");
+  bench_file(dir, "small", 20, 1, NULL);
+  bench_file(dir, "medium", 500, 1, NULL);
+  bench_file(dir, "medium-lean", 500, 1, options);
+  bench_file(dir, "large-flat", 50000, 0, NULL);
+
+  /* A vendor configuration with 500 keys and three drop-in files which
+     override 20 keys each.  */
+  snprintf(usr, sizeof(usr), "%s/usr", dir);
+  snprintf(etc, sizeof(etc), "%s/etc", dir);
+  snprintf(dropins, sizeof(dropins), "%s/merged.conf.d", etc);
+  if (mkdir(usr, 0700) || mkdir(etc, 0700) || mkdir(dropins, 0700))
+    {
+      perror("mkdir");
+      return 1;
+    }
+  snprintf(path, sizeof(path), "%s/merged.conf", usr);
+  long size = generate(path, 500, 0, 1);
+  for (int i = 0; i < 3; i++)
+    {
+      snprintf(path, sizeof(path), "%s/%d-override.conf", dropins, i);
+      size += generate(path, 20, i * 100, 1);
+    }
+  check(econf_readDirs(&key_file, usr, etc, "merged", "conf", "=", "#"),
+	"econf_readDirs");
+
+  int fd;
+  econf_file *attached;
+  check(econf_publish(key_file, &fd), "econf_publish");
+  check(econf_attach(&attached, fd), "econf_attach");
+  close(fd);
+  report("merged", key_file, size);
+  report("merged-attached", attached, size);
+
+  for (int i = 0; i < 3; i++)
+    {
+      snprintf(path, sizeof(path), "%s/%d-override.conf", dropins, i);
+      unlink(path);
+    }
+  snprintf(path, sizeof(path), "%s/merged.conf", usr);
+  unlink(path);
+  rmdir(dropins);
+  rmdir(etc);
+  rmdir(usr);
+  rmdir(dir);
+  econf_freeOptions(options);
+  return 0;
+}
@@ -0,0 +1,147 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Benchmark:
+   Feed a generated file with groups, comments and key/value lines of
+   the given size to a parser and report the throughput. The callbacks
+   only count the entries, so mostly the tokenizer is measured.
+
+   The file is read by econf_readFile() afterwards, once with the default
+   options and once without comments and multiline values, which uses
+   the lean variant of the parser.
+
+   Usage: bench-parse [megabytes [iterations]]
+*/
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static econf_err
+count_entry(void *data, const econf_parse_entry *entry __attribute__((unused)))
+{
+  (*(size_t *) data)++;
+  return ECONF_SUCCESS;
+}
+
+/* Read path iterations times and report the throughput */
+static int
+bench_read(const char *name, const char *path, size_t length, int iterations,
+	   const econf_options *options)
+{
+  size_t entries = 0;
+  double start = now();
+  for (int i = 0; i < iterations; i++)
+    {
+      econf_file *key_file;
+      econf_entry entry;
+      size_t cursor = 0;
+      econf_err error = econf_readFileWithOptions(&key_file, path, "=", "#",
+						  options);
+      if (error)
+	{
+	  fprintf (stderr, "ERROR: couldn't read %s: %s\n", path,
+		   econf_errString(error));
+	  return 1;
+	}
+      while (econf_nextEntry(key_file, &cursor, &entry) == ECONF_SUCCESS)
+	entries++;
+      econf_free(key_file);
+    }
+  double elapsed = now() - start;
+  printf("%-12s %10.1f MB/s (%zu entries)\n", name,
+	 length * (double) iterations / elapsed / (1024 * 1024),
+	 entries / iterations);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+  int iterations = argc > 2 ? atoi(argv[2]) : 5;
+  econf_parse_callbacks callbacks = { .on_entry = count_entry };
+  char *text = NULL;
+  size_t length, entries = 0;
+  int retval = 0;
+
+  if (iterations <= 0)
+    iterations = 1;
+
+  FILE *out = open_memstream(&text, &length);
+  if (out == NULL)
+    return 1;
+  for (size_t i = 0; ftell(out) < (long) (megabytes * 1024 * 1024); i++)
+    {
+      if (i % 100 == 0)
+	fprintf(out, "\n# Settings of group %zu\n[group%zu]\n", i / 100, i / 100);
+      fprintf(out, "some_configuration_key_%zu = \"a value of entry %zu\" # comment\n",
+	      i, i);
+    }
+  fclose(out);
+
+  printf("bench-parse: %zu MB, %d iterations\n", megabytes, iterations);
+  double start = now();
+  for (int i = 0; i < iterations && !retval; i++)
+    {
+      econf_parser *parser;
+      econf_err error = econf_newParser(&parser, "=", "#", &callbacks,
+					&entries);
+      /* Feed the data in chunks like econf_parseFile() does */
+      for (size_t offset = 0; !error && offset < length; offset += BUFSIZ)
+	error = econf_parserFeed(parser, text + offset,
+				 length - offset < BUFSIZ ? length - offset
+							  : BUFSIZ);
+      if (!error)
+	error = econf_parserFinish(parser);
+      econf_freeParser(parser);
+      if (error)
+	{
+	  fprintf (stderr, "ERROR: couldn't parse: %s\n",
+		   econf_errString(error));
+	  retval = 1;
+	}
+    }
+  double elapsed = now() - start;
+  if (!retval)
+    printf("%-12s %10.1f MB/s (%zu entries)\n", "parse",
+	   length * (double) iterations / elapsed / (1024 * 1024),
+	   entries / iterations);
+
+  char path[] = "/tmp/bench-parse-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, text, length) != (ssize_t) length)
+    {
+      perror("bench-parse");
+      free(text);
+      return 1;
+    }
+  close(fd);
+
+  econf_options *lean;
+  if (!retval && !econf_newOptions(&lean))
+    {
+      econf_setOpt(lean, ECONF_OPT_DISCARD_COMMENTS, true);
+      econf_setOpt(lean, ECONF_OPT_NO_MULTILINE, true);
+      retval |= bench_read("read", path, length, iterations, NULL);
+      retval |= bench_read("read-lean", path, length, iterations, lean);
+      econf_freeOptions(lean);
+    }
+  unlink(path);
+
+  free(text);
+  return retval;
+}
@@ -0,0 +1,453 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+#include "../tests/alloc-count.h"
+
+/* Benchmark suite:
+   Generate synthetic configuration files and measure
+
+   - parse-*:     econf_readFile() of a file with 1K, 100K and 1M lines
+   - readdirs-*:  econf_readDirs() with 1 to 500 drop-ins
+   - lookup-*:    econf_getStringValue() of existing and missing keys
+   - merge:       econf_mergeFiles() of two files with 10K keys each
+   - write:       econf_writeFile() of a file with 100K keys
+
+   The results are written as JSON: throughput, latency percentiles of
+   one iteration and the number of allocations of the library per
+   iteration, counted with an allocator installed by alloc-count.h.
+
+   Usage: bench-suite [--quick] [output.json]
+*/
+
+#define KEYS_PER_GROUP 100
+
+static int quick;
+static FILE *out;
+static int first_result = 1;
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Write a configuration file with lines lines and return its size. Every
+   group starts with a comment, some values are quoted or have a comment
+   after them. Keys are named <prefix><number>, starting with first_key,
+   and key n belongs to group n / KEYS_PER_GROUP. The number of keys is
+   stored in *keys if it is not NULL. */
+static size_t
+generate(const char *path, size_t lines, const char *prefix,
+	 size_t first_key, size_t *keys)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL)
+    {
+      perror(path);
+      exit(1);
+    }
+  size_t line = 0, key = first_key;
+  while (line < lines)
+    {
+      if (key == first_key || key % KEYS_PER_GROUP == 0)
+	{
+	  fprintf(fp, "# Settings of group %zu\n[group%zu]\n",
+		  key / KEYS_PER_GROUP, key / KEYS_PER_GROUP);
+	  line += 2;
+	}
+      switch (key % 4)
+	{
+	case 0:
+	  fprintf(fp, "%s%zu = %zu\n", prefix, key, key);
+	  break;
+	case 1:
+	  fprintf(fp, "%s%zu = \"quoted value %zu\"\n", prefix, key, key);
+	  break;
+	case 2:
+	  fprintf(fp, "%s%zu = value_%zu # comment\n", prefix, key, key);
+	  break;
+	default:
+	  fprintf(fp, "%s%zu=/usr/lib/%zu/path\n", prefix, key, key);
+	}
+      line++;
+      key++;
+    }
+  long size = ftell(fp);
+  fclose(fp);
+  if (keys)
+    *keys = key - first_key;
+  return size;
+}
+
+static void
+check(econf_err error, const char *what)
+{
+  if (error)
+    {
+      fprintf(stderr, "ERROR: %s: %s\n", what, econf_errString(error));
+      exit(1);
+    }
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+static double
+percentile(const double *sorted, size_t length, double p)
+{
+  size_t i = (size_t) (p * (length - 1) + 0.5);
+  return sorted[i];
+}
+
+/* One benchmark. run() is called once per iteration and processes
+   bytes bytes and items items. */
+struct bench {
+  const char *name;
+  void (*run)(void *data);
+  void *data;
+  size_t iterations;
+  size_t bytes, items;
+};
+
+static void
+report(const struct bench *b, double *samples, size_t allocs,
+       size_t alloc_bytes)
+{
+  double total = 0;
+  for (size_t i = 0; i < b->iterations; i++)
+    total += samples[i];
+  qsort(samples, b->iterations, sizeof(double), compare_double);
+
+  fprintf(out, "%s    {\n", first_result ? "" : ",\n");
+  first_result = 0;
+  fprintf(out, "      \"name\": \"%s\",\n", b->name);
+  fprintf(out, "      \"iterations\": %zu,\n", b->iterations);
+  fprintf(out, "      \"bytes\": %zu,\n", b->bytes);
+  fprintf(out, "      \"items\": %zu,\n", b->items);
+  fprintf(out, "      \"throughput_mb_s\": %.3f,\n",
+	  b->bytes * (double) b->iterations / total / (1024 * 1024));
+  fprintf(out, "      \"items_per_s\": %.1f,\n",
+	  b->items * (double) b->iterations / total);
+  fprintf(out, "      \"latency_ns\": { \"min\": %.0f, \"p50\": %.0f, "
+	  "\"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f },\n",
+	  samples[0] * 1e9, percentile(samples, b->iterations, 0.5) * 1e9,
+	  percentile(samples, b->iterations, 0.9) * 1e9,
+	  percentile(samples, b->iterations, 0.99) * 1e9,
+	  samples[b->iterations - 1] * 1e9);
+  fprintf(out, "      \"allocations\": %zu,\n"
+	  "      \"allocated_bytes\": %zu\n",
+	  allocs / b->iterations, alloc_bytes / b->iterations);
+  fprintf(out, "    }");
+  fflush(out);
+}
+
+static void
+bench_run(struct bench *b)
+{
+  if (quick && b->iterations > 3)
+    b->iterations /= 10;
+  if (b->iterations < 3)
+    b->iterations = 3;
+
+  double *samples = malloc(b->iterations * sizeof(double));
+  if (samples == NULL)
+    exit(1);
+
+  fprintf(stderr, "bench-suite: %s (%zu iterations)\n", b->name,
+	  b->iterations);
+  /* Warm up caches */
+  b->run(b->data);
+
+  alloc_count_start();
+  for (size_t i = 0; i < b->iterations; i++)
+    {
+      double start = now();
+      b->run(b->data);
+      samples[i] = now() - start;
+    }
+  struct alloc_count count = alloc_count_stop();
+
+  report(b, samples, count.mallocs + count.reallocs, count.bytes);
+  free(samples);
+}
+
+/* parse-* */
+static void
+run_parse(void *data)
+{
+  econf_file *key_file;
+  check(econf_readFile(&key_file, data, "=", "#"), "econf_readFile");
+  econf_free(key_file);
+}
+
+/* readdirs-* */
+struct readdirs {
+  char usr[PATH_MAX], etc[PATH_MAX];
+};
+
+static void
+run_readdirs(void *data)
+{
+  struct readdirs *rd = data;
+  econf_file *key_file;
+  check(econf_readDirs(&key_file, rd->usr, rd->etc, "bench", "conf", "=", "#"),
+	"econf_readDirs");
+  econf_free(key_file);
+}
+
+/* lookup-* */
+#define LOOKUPS 1000
+
+struct lookup {
+  econf_file *key_file;
+  const char *prefix;
+  size_t keys;
+  size_t next;
+};
+
+static void
+run_lookup(void *data)
+{
+  struct lookup *l = data;
+  char group[32], key[32];
+  char *value;
+
+  for (int i = 0; i < LOOKUPS; i++)
+    {
+      /* Spread the lookups over the whole file */
+      size_t num = l->next;
+      l->next = (l->next + 7919) % l->keys;
+      snprintf(group, sizeof(group), "group%zu", num / KEYS_PER_GROUP);
+      snprintf(key, sizeof(key), "%s%zu", l->prefix, num);
+      econf_err error = econf_getStringValue(l->key_file, group, key, &value);
+      if (!error)
+	free(value);
+      else if (error != ECONF_NOKEY)
+	check(error, "econf_getStringValue");
+    }
+}
+
+/* merge */
+struct merge {
+  econf_file *usr, *etc;
+};
+
+static void
+run_merge(void *data)
+{
+  struct merge *m = data;
+  econf_file *merged;
+  check(econf_mergeFiles(&merged, m->usr, m->etc), "econf_mergeFiles");
+  econf_free(merged);
+}
+
+/* write */
+struct writefile {
+  econf_file *key_file;
+  const char *dir;
+};
+
+static void
+run_write(void *data)
+{
+  struct writefile *w = data;
+  check(econf_writeFile(w->key_file, w->dir, "write.conf"), "econf_writeFile");
+}
+
+static void
+remove_tree(const char *path)
+{
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      DIR *dir = opendir(path);
+      struct dirent *de;
+      while (dir && (de = readdir(dir)))
+	{
+	  if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+	    continue;
+	  char child[PATH_MAX];
+	  snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+	  remove_tree(child);
+	}
+      if (dir)
+	closedir(dir);
+      rmdir(path);
+    }
+  else
+    unlink(path);
+}
+
+int
+main(int argc, char **argv)
+{
+  char dir[] = "/tmp/bench-suite-XXXXXX";
+  char path[PATH_MAX];
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++)
+    {
+      if (!strcmp(argv[i], "--quick"))
+	quick = 1;
+      else
+	output = argv[i];
+    }
+  out = output ? fopen(output, "w") : stdout;
+  if (out == NULL)
+    {
+      perror(output);
+      return 1;
+    }
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+
+  fprintf(out, "{\n  \"benchmarks\": [\n");
+
+  static const struct {
+    const char *name;
+    size_t lines, iterations;
+  } parse[] = {
+    { "parse-1k", 1000, 1000 },
+    { "parse-100k", 100000, 20 },
+    { "parse-1m", 1000000, 5 },
+  };
+  for (size_t i = 0; i < sizeof(parse) / sizeof(parse[0]); i++)
+    {
+      snprintf(path, sizeof(path), "%s/%s.conf", dir, parse[i].name);
+      struct bench b = {
+	.name = parse[i].name, .run = run_parse, .data = path,
+	.iterations = parse[i].iterations, .items = parse[i].lines,
+      };
+      b.bytes = generate(path, parse[i].lines, "key", 0, NULL);
+      bench_run(&b);
+      unlink(path);
+    }
+
+  static const struct {
+    const char *name;
+    size_t dropins, iterations;
+  } readdirs[] = {
+    { "readdirs-1", 1, 500 },
+    { "readdirs-10", 10, 200 },
+    { "readdirs-100", 100, 50 },
+    { "readdirs-500", 500, 10 },
+  };
+  for (size_t i = 0; i < sizeof(readdirs) / sizeof(readdirs[0]); i++)
+    {
+      struct readdirs rd;
+      struct bench b = {
+	.name = readdirs[i].name, .run = run_readdirs, .data = &rd,
+	.iterations = readdirs[i].iterations,
+      };
+      snprintf(rd.usr, sizeof(rd.usr), "%s/%s-usr", dir, readdirs[i].name);
+      snprintf(rd.etc, sizeof(rd.etc), "%s/%s-etc", dir, readdirs[i].name);
+      snprintf(path, sizeof(path), "%s/bench.conf.d", rd.etc);
+      if (mkdir(rd.usr, 0700) || mkdir(rd.etc, 0700) || mkdir(path, 0700))
+	{
+	  perror("mkdir");
+	  return 1;
+	}
+      /* The vendor file defines all keys, every drop-in overrides some
+	 of them. */
+      snprintf(path, sizeof(path), "%s/bench.conf", rd.usr);
+      b.bytes = generate(path, 1000, "key", 0, NULL);
+      b.items = 1000;
+      for (size_t d = 0; d < readdirs[i].dropins; d++)
+	{
+	  snprintf(path, sizeof(path), "%s/bench.conf.d/%03zu-dropin.conf",
+		   rd.etc, d);
+	  b.bytes += generate(path, 20, "key", d * 20, NULL);
+	  b.items += 20;
+	}
+      bench_run(&b);
+      snprintf(path, sizeof(path), "%s/%s-usr", dir, readdirs[i].name);
+      remove_tree(path);
+      snprintf(path, sizeof(path), "%s/%s-etc", dir, readdirs[i].name);
+      remove_tree(path);
+    }
+
+  /* lookup-hit and lookup-miss use the same file with 100K keys */
+  {
+    struct lookup l = { .prefix = "key" };
+    snprintf(path, sizeof(path), "%s/lookup.conf", dir);
+    generate(path, 100000, "key", 0, &l.keys);
+    check(econf_readFile(&l.key_file, path, "=", "#"), "econf_readFile");
+
+    struct bench b = {
+      .name = "lookup-hit", .run = run_lookup, .data = &l,
+      .iterations = 1000, .items = LOOKUPS,
+    };
+    bench_run(&b);
+
+    /* Keys with another prefix do not exist */
+    l.prefix = "missing";
+    b.name = "lookup-miss";
+    bench_run(&b);
+    econf_free(l.key_file);
+    unlink(path);
+  }
+
+  {
+    struct merge m;
+    snprintf(path, sizeof(path), "%s/merge-usr.conf", dir);
+    size_t keys;
+    size_t bytes = generate(path, 10000, "key", 0, &keys);
+    check(econf_readFile(&m.usr, path, "=", "#"), "econf_readFile");
+    unlink(path);
+    /* Half of the keys of etc override keys of usr, the others are new */
+    snprintf(path, sizeof(path), "%s/merge-etc.conf", dir);
+    bytes += generate(path, 10000, "key", keys / 2, NULL);
+    check(econf_readFile(&m.etc, path, "=", "#"), "econf_readFile");
+    unlink(path);
+
+    struct bench b = {
+      .name = "merge", .run = run_merge, .data = &m,
+      .iterations = 20, .bytes = bytes, .items = 20000,
+    };
+    bench_run(&b);
+    econf_free(m.usr);
+    econf_free(m.etc);
+  }
+
+  {
+    struct writefile w = { .dir = dir };
+    snprintf(path, sizeof(path), "%s/write-source.conf", dir);
+    struct bench b = {
+      .name = "write", .run = run_write, .data = &w,
+      .iterations = 20, .items = 100000,
+    };
+    b.bytes = generate(path, 100000, "key", 0, NULL);
+    check(econf_readFile(&w.key_file, path, "=", "#"), "econf_readFile");
+    unlink(path);
+    bench_run(&b);
+    econf_free(w.key_file);
+    snprintf(path, sizeof(path), "%s/write.conf", dir);
+    unlink(path);
+  }
+
+  fprintf(out, "\n  ]\n}\n");
+  if (output)
+    fclose(out);
+  rmdir(dir);
+  return 0;
+}
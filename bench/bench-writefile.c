@@ -0,0 +1,99 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Benchmark:
+   Write a file with many groups and keys several times with and without
+   ECONF_WRITE_SYNC.
+
+   Usage: bench-writefile [entries [iterations]]
+*/
+
+#define KEYS_PER_GROUP 100
+
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+run(econf_file *key_file, const char *dir, int iterations, int flags)
+{
+  double start = now();
+  for (int i = 0; i < iterations; i++)
+    {
+      econf_err error = econf_writeFileWithFlags(key_file, dir, "bench.conf",
+						 flags);
+      if (error)
+	{
+	  fprintf (stderr, "ERROR: couldn't write file: %s\n",
+		   econf_errString(error));
+	  return 1;
+	}
+    }
+  printf("%-12s %10.3f ms/write\n", flags & ECONF_WRITE_SYNC ? "sync" : "default",
+	 (now() - start) * 1000 / iterations);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  size_t entries = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 20;
+  char dir[] = "/tmp/bench-writefile-XXXXXX";
+  char group[32], key[32], value[64];
+  int retval;
+
+  if (iterations <= 0)
+    iterations = 1;
+
+  if ((error = econf_newIniFile(&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  for (size_t i = 0; i < entries; i++)
+    {
+      snprintf(group, sizeof(group), "group%zu", i / KEYS_PER_GROUP);
+      snprintf(key, sizeof(key), "key%zu", i % KEYS_PER_GROUP);
+      snprintf(value, sizeof(value), "value of entry %zu", i);
+      econf_setStringValue(key_file, group, key, value);
+    }
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+
+  printf("bench-writefile: %zu entries, %d iterations\n", entries, iterations);
+  retval = run(key_file, dir, iterations, 0);
+  if (!retval)
+    retval = run(key_file, dir, iterations, ECONF_WRITE_SYNC);
+
+  char *path;
+  if (asprintf(&path, "%s/bench.conf", dir) >= 0)
+    {
+      unlink(path);
+      free(path);
+    }
+  rmdir(dir);
+  econf_free(key_file);
+
+  return retval;
+}
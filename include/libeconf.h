@@ -126,8 +126,10 @@ typedef struct econf_file econf_file;
  * Default behaviour if entries have the same name in one file: The
  * first hit will be returned. Further entries will be ignored.
  * This can be changed by setting the environment variable 
- * ECONF_JOIN_SAME_ENTRIES. In that case entries with the same name
- * will be joined to one single entry.
+ * ECONF_JOIN_SAME_ENTRIES before the first file is read or by
+ * ECONF_OPT_JOIN_SAME_ENTRIES (see econf_readFileWithOptions()).
+ * In that case entries with the same name will be joined to one
+ * single entry.
  */
 extern econf_err econf_readFile(econf_file **result, const char *file_name,
 				    const char *delim, const char *comment);
@@ -164,6 +166,10 @@ extern econf_err econf_mergeFiles(econf_file **merged_file,
 /** @brief Evaluating key/values of a given configuration by reading and merging all
  *         needed/available files in two different directories (normally in /usr/etc and /etc).
  *
+ * A drop-in file in <project_name>.<config_suffix>.d of etc_conf_dir
+ * replaces the file with the same name in usr_conf_dir, which is not
+ * read.
+ *
  * @param key_file content of parsed file(s)
  * @param usr_conf_dir absolute path of the first directory (normally "/usr/etc")
  * @param etc_conf_dir absolute path of the second directory (normally "/etc")
@@ -201,7 +207,8 @@ extern econf_err econf_readDirs(econf_file **key_file,
 
 /** @brief Evaluating key/values for every given configuration files in two different
  *  directories (normally in /usr/etc and /etc). Returns a list of read configuration
- *  files and their values.
+ *  files and their values. Drop-in files which are replaced by a file with
+ *  the same name in etc_conf_dir are not in the list, see econf_readDirs().
  *
  * @param key_files list of parsed file(s).
  *        Each entry includes all key/value, path, comments,... information of the regarding file.
@@ -224,6 +231,120 @@ extern econf_err econf_readDirsHistory(econf_file ***key_files,
 				       const char *delim,
 				       const char *comment);
 
+typedef struct econf_options econf_options;
+
+/** @brief Options which modify the behaviour of econf_readFileWithOptions()
+ *         and econf_readDirsWithOptions()
+ */
+enum econf_option {
+  /** Do not collect comments. The comments of all entries are NULL and
+      the file cannot be written losslessly (see ECONF_WRITE_LOSSLESS). */
+  ECONF_OPT_DISCARD_COMMENTS = 0,
+  /** Do not join lines without delimiter to the value of the entry in
+      the line before. Such lines are keys without value. */
+  ECONF_OPT_NO_MULTILINE = 1,
+  /** Join entries with the same name in one file to one single entry.
+      The default is taken from the environment variable
+      ECONF_JOIN_SAME_ENTRIES. */
+  ECONF_OPT_JOIN_SAME_ENTRIES = 2,
+  /** Collect statistics about reading the files. They are returned by
+      econf_getStats(). */
+  ECONF_OPT_STATS = 3,
+  /** Count the lookups of every key and the lookups of missing keys.
+      They are returned by econf_getLookups(). */
+  ECONF_OPT_PROFILE_LOOKUPS = 4
+};
+typedef enum econf_option econf_option;
+
+/** @brief Create a new options object with default values.
+ *
+ * @param result Pointer to the allocated options object.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf.h"
+ *
+ *   econf_options *options = NULL;
+ *   econf_file *key_file = NULL;
+ *   econf_err error;
+ *
+ *   error = econf_newOptions (&options);
+ *   error = econf_setOpt (options, ECONF_OPT_DISCARD_COMMENTS, true);
+ *   error = econf_readFileWithOptions (&key_file, "/etc/test.conf", "=", "#",
+ *                                      options);
+ *
+ *   econf_free (key_file);
+ *   econf_freeOptions (options);
+ * @endcode
+ *
+ */
+extern econf_err econf_newOptions(econf_options **result);
+
+/** @brief Enable or disable an option.
+ *
+ * @param options Options object created by econf_newOptions().
+ * @param option Option which has to be changed.
+ * @param value true enables the option, false disables it.
+ * @return econf_err ECONF_SUCCESS or ECONF_ERROR for an unknown option
+ *
+ */
+extern econf_err econf_setOpt(econf_options *options, econf_option option,
+			      bool value);
+
+/** @brief Free an options object created by econf_newOptions().
+ *
+ * @param options Options object which has to be freed.
+ * @return void
+ *
+ */
+extern void econf_freeOptions(econf_options *options);
+
+/** @brief Same as econf_readFile() but the file is read with the given
+ *         options.
+ *
+ * Files which are read without comments and multiline values are
+ * parsed by a faster variant of the parser.
+ *
+ * @param result content of parsed file
+ * @param file_name absolute path of parsed file
+ * @param delim delimiters of key/value e.g. "\t ="
+ * @param comment array of characters which define the start of a comment
+ * @param options Options created by econf_newOptions(). NULL uses the
+ *        default options.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_readFileWithOptions(econf_file **result,
+					   const char *file_name,
+					   const char *delim,
+					   const char *comment,
+					   const econf_options *options);
+
+/** @brief Same as econf_readDirs() but all files are read with the given
+ *         options.
+ *
+ * @param key_file content of parsed file(s)
+ * @param usr_conf_dir absolute path of the first directory (normally "/usr/etc")
+ * @param etc_conf_dir absolute path of the second directory (normally "/etc")
+ * @param project_name basename of the configuration file
+ * @param config_suffix suffix of the configuration file. Can also be NULL.
+ * @param delim delimiters of key/value e.g. "\t ="
+ * @param comment array of characters which define the start of a comment
+ * @param options Options created by econf_newOptions(). NULL uses the
+ *        default options.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_readDirsWithOptions(econf_file **key_file,
+					   const char *usr_conf_dir,
+					   const char *etc_conf_dir,
+					   const char *project_name,
+					   const char *config_suffix,
+					   const char *delim,
+					   const char *comment,
+					   const econf_options *options);
+
 /* The API/ABI of the following three functions (econf_newKeyFile,
    econf_newIniFile and econf_writeFile) are not stable and will change */
 
@@ -263,6 +384,78 @@ extern econf_err econf_newIniFile(econf_file **result);
 extern econf_err econf_writeFile(econf_file *key_file, const char *save_to_dir,
 				      const char *file_name);
 
+/** @brief Flags for econf_writeFileWithFlags()
+ */
+enum econf_write_flags {
+  /** Flush the file and its directory to disk before returning */
+  ECONF_WRITE_SYNC = 1 << 0,
+  /** Keep comments and formatting of the file which has been read by
+      econf_readFile(). Only modified values are written again, new keys
+      are added at the end of their group. */
+  ECONF_WRITE_LOSSLESS = 1 << 1
+};
+
+/** @brief Write content of a econf_file struct to specified location.
+ *
+ * The content is written into a temporary file in the same directory
+ * which replaces the destination afterwards, so the destination is
+ * never left partially written. This is done by econf_writeFile() too.
+ * The permissions, owner and group of an existing destination are kept;
+ * ECONF_WRITEERROR is returned if the owner cannot be kept. If the
+ * destination is a symbolic link, the file it points to is replaced and
+ * the link is kept. Dangling links are not followed.
+ *
+ * @param key_file Data which has to be written.
+ * @param save_to_dir Directory into which the file has to be written.
+ * @param file_name filename (with suffix)
+ * @param flags 0 or a combination of ECONF_WRITE_SYNC and ECONF_WRITE_LOSSLESS
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_writeFileWithFlags(econf_file *key_file, const char *save_to_dir,
+					  const char *file_name, int flags);
+
+/** @brief Evaluating all entries of edited_file which are not defined in
+ *         base_file or which have a different value there.
+ *
+ * Entries of base_file which are missing in edited_file are ignored.
+ *
+ * @param delta New econf_file containing the changed and added entries.
+ * @param base_file Original data, e.g. evaluated by econf_readDirs().
+ * @param edited_file Data which has been derived from base_file.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_diffFiles(econf_file **delta, econf_file *base_file,
+				 econf_file *edited_file);
+
+/** @brief Write the entries of edited_file which differ from base_file into
+ *         a drop-in file.
+ *
+ * The changes are evaluated by econf_diffFiles(). If the drop-in file
+ * already exists the changes are added to it and all other entries and
+ * comments of it are kept (see ECONF_WRITE_LOSSLESS). Nothing is written
+ * if there are no changes and the file does not exist.
+ *
+ * Example: Store changes of the merged example.conf in
+ *          /etc/example.conf.d/90_changes.conf
+ * @code
+ *   error = econf_writeDropIn (base_file, edited_file,
+ *                              "/etc/example.conf.d", "90_changes.conf", 0);
+ * @endcode
+ *
+ * @param base_file Original data, e.g. evaluated by econf_readDirs().
+ * @param edited_file Data which has been derived from base_file.
+ * @param dropin_dir Existing directory into which the file has to be written.
+ * @param file_name filename (with suffix)
+ * @param flags 0 or ECONF_WRITE_SYNC
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_writeDropIn(econf_file *base_file, econf_file *edited_file,
+				   const char *dropin_dir, const char *file_name,
+				   int flags);
+
 /* --------------- */
 /* --- GETTERS --- */
 /* --------------- */
@@ -582,6 +775,46 @@ extern econf_err econf_setStringValue(econf_file *kf, const char *group, const c
  */
 extern econf_err econf_setBoolValue(econf_file *kf, const char *group, const char *key, const char *value);
 
+/* ------------------------ */
+/* --- DELETE FUNCTIONS --- */
+/* ------------------------ */
+
+/** @brief Delete the given group/key.
+ *
+ * The entry is only marked as deleted. The memory of its group and key
+ * is released by econf_compact() or when the file is written or
+ * merged. If the key occurs several times in the group, all
+ * occurrences are deleted.
+ *
+ * @param kf given/parsed data
+ * @param group Desired group or NULL if there is no group defined.
+ * @param key Key which has to be deleted.
+ * @return econf_err ECONF_SUCCESS or error code (ECONF_NOKEY if the key
+ *         does not exist)
+ *
+ */
+extern econf_err econf_deleteKey(econf_file *kf, const char *group, const char *key);
+
+/** @brief Delete the given group with all its keys.
+ *
+ * @param kf given/parsed data
+ * @param group Desired group or NULL for the keys without a group.
+ * @return econf_err ECONF_SUCCESS or error code (ECONF_NOGROUP if the group
+ *         does not exist)
+ *
+ */
+extern econf_err econf_deleteGroup(econf_file *kf, const char *group);
+
+/** @brief Remove deleted entries and release unused memory.
+ *
+ * The remaining entries are stored group by group afterwards.
+ *
+ * @param kf given/parsed data
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_compact(econf_file *kf);
+
 /* --------------- */
 /* --- HELPERS --- */
 /* --------------- */
@@ -618,6 +851,55 @@ extern void econf_freeArray(char **array);
  */
 extern void econf_freeFile(econf_file *key_file);
 
+/* ----------------- */
+/* --- ALLOCATOR --- */
+/* ----------------- */
+
+/** @brief Functions which are used by the library to allocate memory.
+ */
+typedef struct econf_allocator {
+  /** Allocate size bytes. Returns NULL if there is not enough memory. */
+  void *(*allocate)(size_t size, void *data);
+  /** Resize the block ptr to size bytes like realloc(). ptr can be NULL,
+      size is never 0. */
+  void *(*reallocate)(void *ptr, size_t size, void *data);
+  /** Release the block ptr, which is never NULL. */
+  void (*release)(void *ptr, void *data);
+  /** Passed to every function, e.g. an arena. */
+  void *data;
+} econf_allocator;
+
+/** @brief Install the functions which are used for all allocations of
+ *         the library.
+ *
+ * This has to be done before any other function of the library is called
+ * and must not be changed as long as memory allocated by the library is
+ * in use. Memory returned to the caller, e.g. strings of
+ * econf_getStringValue() or econf_errLocation(), is allocated with these
+ * functions too and has to be released by allocator->release instead of
+ * free().
+ *
+ * @param allocator Allocation functions which are copied. NULL restores
+ *        malloc(), realloc() and free() of the C library.
+ * @return econf_err ECONF_SUCCESS or ECONF_ERROR if a function is missing
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf.h"
+ *
+ *   static void *arena_allocate(size_t size, void *arena) { ... }
+ *   static void *arena_reallocate(void *ptr, size_t size, void *arena) { ... }
+ *   static void arena_release(void *ptr, void *arena) { ... }
+ *
+ *   econf_allocator allocator = {
+ *     arena_allocate, arena_reallocate, arena_release, &arena
+ *   };
+ *   econf_setAllocator (&allocator);
+ * @endcode
+ *
+ */
+extern econf_err econf_setAllocator(const econf_allocator *allocator);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,282 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+/** @file libeconf_client.h
+ * @brief Client of econfd, which answers lookups over a UNIX socket.
+ *
+ * econfd loads and watches the configuration of some projects. Instead
+ * of reading the files itself, a process connects to the daemon and
+ * reads the values with the same semantics as the econf_get*Value()
+ * functions. The merged configuration of a project can also be fetched
+ * as a whole; it is passed as a sealed memory file and attached with
+ * econf_attach().
+ *
+ * Protocol: all integers are in the native byte order, the socket is
+ * local. Each request is a frame of
+ *
+ *   uint32 length of the following bytes,
+ *   uint8  type (econfd_request_type),
+ *   project\0 group\0 key\0
+ *
+ * An empty group means no group. ECONFD_GET_SNAPSHOT frames have an
+ * empty group and key. Each response is a frame of
+ *
+ *   uint32 length of the following bytes,
+ *   uint32 econf_err,
+ *   value
+ *
+ * The value is only sent on success. Strings include the terminating 0,
+ * numbers are sent as 8 bytes: int64 for signed types, uint64 for
+ * unsigned types and bool, double for floats. The memory file of a
+ * snapshot is passed with SCM_RIGHTS together with its response frame.
+ * Requests can be pipelined; the responses are sent in the order of the
+ * requests.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "libeconf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Socket used if no path is given to econf_clientConnect(). */
+#define ECONFD_SOCKET "/run/econfd.sock"
+
+/** Maximum length of a request frame. */
+#define ECONFD_MAX_REQUEST 65536
+
+/** Maximum length of a response frame. */
+#define ECONFD_MAX_RESPONSE (16 * 1024 * 1024)
+
+/** @brief Type of a request sent to econfd. */
+enum econfd_request_type {
+  /** econf_getStringValue() */
+  ECONFD_GET_STRING = 0,
+  /** econf_getIntValue() */
+  ECONFD_GET_INT = 1,
+  /** econf_getInt64Value() */
+  ECONFD_GET_INT64 = 2,
+  /** econf_getUIntValue() */
+  ECONFD_GET_UINT = 3,
+  /** econf_getUInt64Value() */
+  ECONFD_GET_UINT64 = 4,
+  /** econf_getFloatValue() */
+  ECONFD_GET_FLOAT = 5,
+  /** econf_getDoubleValue() */
+  ECONFD_GET_DOUBLE = 6,
+  /** econf_getBoolValue() */
+  ECONFD_GET_BOOL = 7,
+  /** Memory file with the merged configuration, see econf_publish() */
+  ECONFD_GET_SNAPSHOT = 8
+};
+
+typedef enum econfd_request_type econfd_request_type;
+
+/** @brief Connection to econfd. */
+typedef struct econf_client econf_client;
+
+/** @brief One lookup of econf_clientBatch(). */
+struct econf_client_request {
+  /** Type of the value. ECONFD_GET_SNAPSHOT is not allowed here. */
+  econfd_request_type type;
+  /** Project, e.g. "example.conf" */
+  const char *project;
+  /** Group or NULL */
+  const char *group;
+  /** Key */
+  const char *key;
+  /** Result of the lookup, set by econf_clientBatch(). */
+  econf_err error;
+  /** Value if error is ECONF_SUCCESS. The member matches the type. The
+      string is newly allocated like the one of econf_getStringValue(). */
+  union {
+    char *s;
+    int32_t i;
+    int64_t i64;
+    uint32_t u;
+    uint64_t u64;
+    float f;
+    double d;
+    bool b;
+  } value;
+};
+
+typedef struct econf_client_request econf_client_request;
+
+/** @brief Connect to econfd.
+ *
+ * @param result Connection, which has to be closed with
+ *        econf_clientDisconnect().
+ * @param socket_path Socket of the daemon or NULL for ECONFD_SOCKET.
+ * @return econf_err ECONF_SUCCESS, ECONF_NOFILE if the daemon cannot be
+ *         reached or another error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_client.h"
+ *
+ *   econf_client *client;
+ *   int32_t value;
+ *
+ *   if (econf_clientConnect (&client, NULL) == ECONF_SUCCESS) {
+ *     econf_clientGetIntValue (client, "example.conf", "group", "key", &value);
+ *     econf_clientDisconnect (client);
+ *   }
+ * @endcode
+ *
+ */
+extern econf_err econf_clientConnect(econf_client **result,
+				     const char *socket_path);
+
+/** @brief Close the connection.
+ *
+ * @param client Connection returned by econf_clientConnect() or NULL
+ * @return void
+ */
+extern void econf_clientDisconnect(econf_client *client);
+
+/** @brief Look up a batch of values with one round trip.
+ *
+ * All requests are written before the responses are read. The result
+ * of each lookup is stored in its error and value members.
+ *
+ * @param client Connection
+ * @param requests Lookups
+ * @param length Number of lookups
+ * @return econf_err ECONF_SUCCESS if all lookups have been answered,
+ *         otherwise the error of the connection, which cannot be used
+ *         anymore.
+ */
+extern econf_err econf_clientBatch(econf_client *client,
+				   econf_client_request *requests,
+				   size_t length);
+
+/** @brief Like econf_getIntValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetIntValue(econf_client *client, const char *project, const char *group, const char *key, int32_t *result);
+
+/** @brief Like econf_getInt64Value() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetInt64Value(econf_client *client, const char *project, const char *group, const char *key, int64_t *result);
+
+/** @brief Like econf_getUIntValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetUIntValue(econf_client *client, const char *project, const char *group, const char *key, uint32_t *result);
+
+/** @brief Like econf_getUInt64Value() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetUInt64Value(econf_client *client, const char *project, const char *group, const char *key, uint64_t *result);
+
+/** @brief Like econf_getFloatValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetFloatValue(econf_client *client, const char *project, const char *group, const char *key, float *result);
+
+/** @brief Like econf_getDoubleValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetDoubleValue(econf_client *client, const char *project, const char *group, const char *key, double *result);
+
+/** @brief Like econf_getStringValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result A newly allocated string.
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetStringValue(econf_client *client, const char *project, const char *group, const char *key, char **result);
+
+/** @brief Like econf_getBoolValue() but answered by econfd.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param group Group or NULL
+ * @param key Key
+ * @param result Value
+ * @return econf_err ECONF_SUCCESS or error code
+ */
+extern econf_err econf_clientGetBoolValue(econf_client *client, const char *project, const char *group, const char *key, bool *result);
+
+/** @brief Fetch the merged configuration of a project.
+ *
+ * The configuration is attached with econf_attach(); it is read-only
+ * and does not change when econfd reloads the project.
+ *
+ * @param client Connection
+ * @param project Project, e.g. "example.conf"
+ * @param result Configuration, which has to be freed with econf_free().
+ * @return econf_err ECONF_SUCCESS, ECONF_NOFILE for an unknown project
+ *         or another error code
+ */
+extern econf_err econf_clientGetSnapshot(econf_client *client,
+					 const char *project,
+					 econf_file **result);
+
+#ifdef __cplusplus
+}
+#endif
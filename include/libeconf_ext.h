@@ -49,6 +49,118 @@ struct econf_ext_value {
   
 typedef struct econf_ext_value econf_ext_value;
 
+/** @brief Part of a string which is not terminated by a 0 byte. */
+struct econf_span {
+  /** First character of the span. */
+  const char *start;
+  /** Number of characters in the span. */
+  size_t length;
+};
+
+typedef struct econf_span econf_span;
+
+/** @brief Same information as econf_ext_value returned by
+ *         econf_getExtValueView() without copying it.
+ *
+ * All data is borrowed from the econf_file object. It must not be
+ * freed and is only valid until the object is modified or freed.
+ */
+struct econf_ext_value_view {
+  /** Lines of the value without leading and trailing whitespace. */
+  const econf_span *values;
+  /** Number of elements in values. */
+  size_t values_length;
+  /** Path of the configuration file where this value has been read. */
+  const char *file;
+  /** Line number of the configuration key/value. */
+  uint64_t line_number;
+  /** Comment before the key/value entry. */
+  const char *comment_before_key;
+  /** Comment after the value entry. */
+  const char *comment_after_value;
+};
+
+typedef struct econf_ext_value_view econf_ext_value_view;
+
+/** @brief One key/value entry returned by econf_nextEntry().
+ *
+ * All strings are borrowed from the econf_file object. They must not be
+ * freed and are only valid until the object is modified or freed.
+ */
+struct econf_entry {
+  /** Group of the entry including the brackets, or NULL if there is no group. */
+  const char *group;
+  /** Key of the entry. */
+  const char *key;
+  /** Value of the entry or NULL if the key has no value. */
+  const char *value;
+  /** Comment before the key/value entry. */
+  const char *comment_before_key;
+  /** Comment after the value entry. */
+  const char *comment_after_value;
+  /** Line number of the configuration key/value. */
+  uint64_t line_number;
+  /** Path of the file the entry has been read from or NULL. */
+  const char *file;
+};
+
+typedef struct econf_entry econf_entry;
+
+/** @brief One key/value entry reported by econf_parseFile().
+ *
+ * All strings are borrowed from the parser and are only valid during
+ * the callback.
+ */
+struct econf_parse_entry {
+  /** Current group including the brackets, or NULL if there is no group. */
+  const char *group;
+  /** Key of the entry. NULL if continuation is set. */
+  const char *key;
+  /** Value of the entry or NULL if the key has no value. */
+  const char *value;
+  /** Comments before the key/value entry. */
+  const char *comment_before_key;
+  /** Comment after the value entry. */
+  const char *comment_after_value;
+  /** Line number of the key/value. */
+  uint64_t line_number;
+  /** The line is the continuation of the value of the previous entry.
+      value contains the complete line without comment. */
+  bool continuation;
+  /** Byte offsets of the line in the file: [line_start, line_end) */
+  size_t line_start, line_end;
+  /** Byte offsets of the value in the file, 0 if there is no value
+      or continuation is set. */
+  size_t value_start, value_end;
+};
+
+typedef struct econf_parse_entry econf_parse_entry;
+
+/** @brief Callbacks used by econf_parseFile(). Every callback can be NULL.
+ *
+ * Each callback gets the data pointer given to econf_parseFile(). If a
+ * callback returns an error code other than ECONF_SUCCESS parsing stops
+ * and econf_parseFile() returns it.
+ */
+struct econf_parse_callbacks {
+  /** Called with every raw line of the file including the newline
+      before it is parsed. */
+  econf_err (*on_line)(void *data, const char *line, size_t length,
+		       uint64_t line_number);
+  /** Called for every group header. group includes the brackets. */
+  econf_err (*on_group)(void *data, const char *group, uint64_t line_number);
+  /** Called for every key/value entry and value continuation line. */
+  econf_err (*on_entry)(void *data, const econf_parse_entry *entry);
+  /** Called for every comment without the comment character. after_value
+      is set if the comment follows a key/value entry in the same line. */
+  econf_err (*on_comment)(void *data, const char *comment, bool after_value,
+			  uint64_t line_number);
+};
+
+typedef struct econf_parse_callbacks econf_parse_callbacks;
+
+typedef struct econf_parser econf_parser;
+
 
 /** @brief Evaluating more information for given group/key.
  *
@@ -62,6 +174,169 @@ typedef struct econf_ext_value econf_ext_value;
 extern econf_err econf_getExtValue(econf_file *kf, const char *group,
 				   const char *key, econf_ext_value **result);
 
+/** @brief Same as econf_getExtValue(), but returns borrowed data.
+ *
+ * The lines of a value are split on the first call and kept until the
+ * value is changed, so further calls do not allocate memory.
+ * file is the file the key has been read from. After merging it is
+ * the file which has set the value.
+ *
+ * @param kf given/parsed data
+ * @param group Desired group or NULL if there is no group defined.
+ * @param key Key for which the value is requested.
+ * @param result Filled with borrowed data of the value.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_ext_value_view view;
+ *
+ *   if (econf_getExtValueView (key_file, NULL, "hosts", &view) == ECONF_SUCCESS)
+ *     for (size_t i = 0; i < view.values_length; i++)
+ *       printf ("%.*s\n", (int) view.values[i].length, view.values[i].start);
+ * @endcode
+ *
+ */
+extern econf_err econf_getExtValueView(econf_file *kf, const char *group,
+				       const char *key,
+				       econf_ext_value_view *result);
+
+/** @brief Iterating over all entries without allocating memory.
+ *         The entries are returned group by group, in the order of
+ *         econf_getGroups() and econf_getKeys().
+ *
+ * The file is not changed by the iteration. Entries which are deleted
+ * during the iteration are skipped, entries which are set are returned
+ * if their group has not been passed yet.
+ *
+ * @param kf given/parsed data
+ * @param cursor Position of the iteration. Has to be set to 0 before the
+ *        first call and is advanced by each call.
+ * @param entry Filled with borrowed data of the next entry.
+ * @return econf_err ECONF_SUCCESS, ECONF_NOKEY if there are no more
+ *         entries or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_entry entry;
+ *   size_t cursor = 0;
+ *
+ *   while (econf_nextEntry (key_file, &cursor, &entry) == ECONF_SUCCESS)
+ *     printf ("%s %s=%s\n", entry.group ? entry.group : "",
+ *             entry.key, entry.value ? entry.value : "");
+ * @endcode
+ *
+ */
+extern econf_err econf_nextEntry(econf_file *kf, size_t *cursor,
+				 econf_entry *entry);
+
+/** @brief Parse a file and report its content via callbacks without
+ *         creating an econf_file object.
+ *
+ * The file is read in chunks and fed to an econf_parser, so the memory
+ * used does not depend on the size of the file. econf_readFile() is based on this function.
+ *
+ * @param file_name path of the parsed file
+ * @param delim delimiters of key/value e.g. "\t ="
+ * @param comment array of characters which define the start of a comment
+ * @param callbacks functions which are called for the parsed elements
+ * @param data pointer which is passed to the callbacks
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   static econf_err print_entry(void *data, const econf_parse_entry *entry)
+ *   {
+ *     if (!entry->continuation)
+ *       printf ("%s=%s\n", entry->key, entry->value ? entry->value : "");
+ *     return ECONF_SUCCESS;
+ *   }
+ *
+ *   econf_parse_callbacks callbacks = { .on_entry = print_entry };
+ *   error = econf_parseFile ("/etc/test.conf", "=", "#", &callbacks, NULL);
+ * @endcode
+ *
+ */
+extern econf_err econf_parseFile(const char *file_name, const char *delim,
+				 const char *comment,
+				 const econf_parse_callbacks *callbacks,
+				 void *data);
+
+/** @brief Create a parser which is fed with data chunk by chunk.
+ *
+ * The parser has the same semantics as econf_parseFile() but does not
+ * read the data itself. This way data received from pipes or sockets
+ * can be parsed while it arrives, e.g. from within an event loop.
+ * Only an incomplete line is buffered between the calls.
+ *
+ * @param result newly allocated parser
+ * @param delim delimiters of key/value e.g. "\t ="
+ * @param comment array of characters which define the start of a comment
+ * @param callbacks functions which are called for the parsed elements
+ * @param data pointer which is passed to the callbacks
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_parser *parser;
+ *   char buf[4096];
+ *   ssize_t n;
+ *
+ *   error = econf_newParser (&parser, "=", "#", &callbacks, NULL);
+ *   while (!error && (n = read (fd, buf, sizeof(buf))) > 0)
+ *     error = econf_parserFeed (parser, buf, n);
+ *   if (!error)
+ *     error = econf_parserFinish (parser);
+ *   econf_freeParser (parser);
+ * @endcode
+ *
+ */
+extern econf_err econf_newParser(econf_parser **result, const char *delim,
+				 const char *comment,
+				 const econf_parse_callbacks *callbacks,
+				 void *data);
+
+/** @brief Parse the next chunk of data.
+ *
+ * The chunk can end anywhere, also within a line. Complete lines are
+ * reported to the callbacks immediately.
+ *
+ * @param parser parser created by econf_newParser()
+ * @param buf data of the chunk
+ * @param length length of the chunk
+ * @return econf_err ECONF_SUCCESS or error code. After an error has been
+ *         returned, every further call returns the same error.
+ *
+ */
+extern econf_err econf_parserFeed(econf_parser *parser, const char *buf,
+				  size_t length);
+
+/** @brief Parse the last line if it has not been terminated by a newline.
+ *
+ * No data can be fed after this call.
+ *
+ * @param parser parser created by econf_newParser()
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_parserFinish(econf_parser *parser);
+
+/** @brief Free a parser created by econf_newParser().
+ *
+ * @param parser parser which has to be freed
+ * @return void
+ *
+ */
+extern void econf_freeParser(econf_parser *parser);
+
 /** @brief Free an complete econf_ext_value struct.
  *
  * @param to_free struct which has to be freed
@@ -70,6 +345,265 @@ extern econf_err econf_getExtValue(econf_file *kf, const char *group,
  */
 extern void econf_freeExtValue(econf_ext_value *to_free);
 
+/** @brief Statistics of one file which has been read with ECONF_OPT_STATS.
+ */
+struct econf_file_stats {
+  /** Path of the file. */
+  const char *path;
+  /** Size of the file. */
+  uint64_t bytes;
+  /** Number of lines. */
+  uint64_t lines;
+  /** Number of entries after joining entries with the same name. */
+  uint64_t entries;
+  /** Number of allocations while the file has been read. */
+  uint64_t allocations;
+  /** Nanoseconds for opening and parsing the file. */
+  uint64_t parse_ns;
+  /** Nanoseconds for joining entries (ECONF_OPT_JOIN_SAME_ENTRIES). */
+  uint64_t join_ns;
+};
+
+typedef struct econf_file_stats econf_file_stats;
+
+/** @brief Statistics of loading an econf_file with ECONF_OPT_STATS.
+ *
+ * The counters are the sums of all files. file_stats is borrowed from
+ * the econf_file object and is only valid until the object is freed.
+ */
+struct econf_stats {
+  /** Number of files which have been read. */
+  uint64_t files;
+  /** Sum of the sizes of all files. */
+  uint64_t bytes;
+  /** Sum of the lines of all files. */
+  uint64_t lines;
+  /** Sum of the entries of all files before merging. */
+  uint64_t entries;
+  /** Number of allocations while loading, including merging. */
+  uint64_t allocations;
+  /** Nanoseconds for scanning the directories and the remaining work of
+      econf_readDirsWithOptions() which is not part of another phase. */
+  uint64_t scan_ns;
+  /** Nanoseconds for opening and parsing all files. */
+  uint64_t parse_ns;
+  /** Nanoseconds for joining entries with the same name. */
+  uint64_t join_ns;
+  /** Nanoseconds for merging the files. */
+  uint64_t merge_ns;
+  /** Nanoseconds for the whole call. */
+  uint64_t total_ns;
+  /** Statistics of every file in the order the files have been read. */
+  const econf_file_stats *file_stats;
+  /** Number of elements in file_stats. */
+  size_t file_stats_length;
+};
+
+typedef struct econf_stats econf_stats;
+
+/** @brief Statistics about loading kf by econf_readFileWithOptions() or
+ *         econf_readDirsWithOptions() with ECONF_OPT_STATS.
+ *
+ * @param kf given/parsed data
+ * @param stats Filled with the statistics.
+ * @return econf_err ECONF_SUCCESS or ECONF_ERROR if kf has not been
+ *         loaded with ECONF_OPT_STATS
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_options *options = NULL;
+ *   econf_file *key_file = NULL;
+ *   econf_stats stats;
+ *
+ *   econf_newOptions (&options);
+ *   econf_setOpt (options, ECONF_OPT_STATS, true);
+ *   econf_readDirsWithOptions (&key_file, "/usr/etc", "/etc", "example",
+ *                              "conf", "=", "#", options);
+ *   if (econf_getStats (key_file, &stats) == ECONF_SUCCESS)
+ *     printf ("%lu files in %lu ns\n", (unsigned long) stats.files,
+ *             (unsigned long) stats.total_ns);
+ *
+ *   econf_free (key_file);
+ *   econf_freeOptions (options);
+ * @endcode
+ *
+ */
+extern econf_err econf_getStats(econf_file *kf, econf_stats *stats);
+
+/** @brief Number of lookups of one key, see econf_getLookups().
+ *
+ * The strings are borrowed from the econf_file object. They must not be
+ * freed and are only valid until the object is modified or freed.
+ */
+struct econf_lookup {
+  /** Group of the key or NULL if the key has no group. */
+  const char *group;
+  /** Key which has been looked up. */
+  const char *key;
+  /** Number of lookups by econf_get*Value() and econf_getExtValue*().
+      The counter of an existing key wraps after 2^32 lookups. */
+  uint64_t count;
+  /** false if the key does not exist in the file. */
+  bool found;
+};
+
+typedef struct econf_lookup econf_lookup;
+
+/** @brief Lookups of all keys of kf which has been loaded by
+ *         econf_readFileWithOptions() or econf_readDirsWithOptions() with
+ *         ECONF_OPT_PROFILE_LOOKUPS.
+ *
+ * The keys of the file come first, the most frequently read ones first.
+ * Keys which have never been read have a count of 0. They are followed
+ * by the keys which have been looked up but do not exist (found is
+ * false).
+ *
+ * @param kf given/parsed data
+ * @param lookups Array of the keys. It has to be freed with
+ *        econf_freeLookups().
+ * @param length Number of elements in lookups.
+ * @return econf_err ECONF_SUCCESS or ECONF_ERROR if the lookups of kf are
+ *         not profiled
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_lookup *lookups;
+ *   size_t length;
+ *
+ *   if (econf_getLookups (key_file, &lookups, &length) == ECONF_SUCCESS)
+ *     {
+ *       for (size_t i = 0; i < length; i++)
+ *         printf ("%s %s %lu%s\n", lookups[i].group ? lookups[i].group : "",
+ *                 lookups[i].key, (unsigned long) lookups[i].count,
+ *                 lookups[i].found ? "" : " (missing)");
+ *       econf_freeLookups (lookups);
+ *     }
+ * @endcode
+ *
+ */
+extern econf_err econf_getLookups(econf_file *kf, econf_lookup **lookups,
+				  size_t *length);
+
+/** @brief Free the array returned by econf_getLookups().
+ *
+ * @param lookups array of lookups
+ * @return void
+ *
+ */
+extern void econf_freeLookups(econf_lookup *lookups);
+
+/** @brief Heap memory of an econf_file, see econf_memoryUsage().
+ *
+ * The sizes are the sizes which have been requested from the allocator,
+ * without its overhead. Structures which are shared by merged files,
+ * like the table of the source paths, are counted in full.
+ */
+struct econf_memory_usage {
+  /** Number of entries including the deleted ones. */
+  size_t entry_count;
+  /** Bytes of the entries in use. */
+  size_t entries;
+  /** Bytes of allocated but unused entries (alloc_length - length). */
+  size_t slack;
+  /** Groups, keys and values including the terminating 0. */
+  size_t strings;
+  /** Comments before keys and after values. */
+  size_t comments;
+  /** Lines of values which have been split by econf_getExtValueView(). */
+  size_t caches;
+  /** Content of the files kept for writing them losslessly. */
+  size_t source;
+  /** Lookup index, which is built when the file is read. */
+  size_t index;
+  /** Everything else: the econf_file object, its path, the table of
+      source paths, statistics and lookup profile. */
+  size_t other;
+  /** Sum of all above. */
+  size_t total;
+  /** Size of the configuration attached by econf_attach(). It is shared
+      by all processes which have attached it and not part of total. */
+  size_t shared;
+};
+
+typedef struct econf_memory_usage econf_memory_usage;
+
+/** @brief Heap memory used by kf.
+ *
+ * @param kf given/parsed data
+ * @param usage Filled with the bytes used by the parts of kf.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_memory_usage usage;
+ *
+ *   if (econf_memoryUsage (key_file, &usage) == ECONF_SUCCESS)
+ *     printf ("%zu bytes, %zu per entry\n", usage.total,
+ *             usage.entry_count ? usage.total / usage.entry_count : 0);
+ * @endcode
+ *
+ */
+extern econf_err econf_memoryUsage(econf_file *kf, econf_memory_usage *usage);
+
+/** @brief Publish kf in a sealed memory file which other processes can
+ *         attach with econf_attach().
+ *
+ * The configuration is stored in a position independent format. It
+ * cannot be changed after it has been published; changes of kf are not
+ * visible in it. The file descriptor can be passed to other processes,
+ * e.g. by inheriting it or with SCM_RIGHTS over a UNIX socket.
+ * Only available on Linux (memfd_create()).
+ *
+ * @param kf given/parsed data
+ * @param fd File descriptor of the memory file. It has to be closed by
+ *        the caller. The close-on-exec flag is set.
+ * @return econf_err ECONF_SUCCESS or error code
+ *
+ */
+extern econf_err econf_publish(econf_file *kf, int *fd);
+
+/** @brief Map a configuration published by econf_publish() read-only.
+ *
+ * The strings of the returned object are not copied but are read from
+ * the mapping, which is shared by all processes which have attached the
+ * configuration. All getters can be used. Functions which would change
+ * the object, like econf_set*Value() or econf_deleteKey(), return
+ * ECONF_ERROR. The object has to be freed with econf_free(); fd can be
+ * closed right after this call. Only memory files which are sealed
+ * against writing and shrinking are accepted, so the mapping cannot
+ * change; regular files are rejected even if they contain a valid
+ * configuration.
+ *
+ * @param result The attached configuration.
+ * @param fd File descriptor of the published configuration.
+ * @return econf_err ECONF_SUCCESS or ECONF_ERROR if fd does not contain
+ *         a valid configuration or can still be changed
+ *
+ * Usage:
+ * @code
+ *   #include "libeconf_ext.h"
+ *
+ *   econf_file *key_file = NULL;
+ *   char *value;
+ *
+ *   if (econf_attach (&key_file, fd) == ECONF_SUCCESS)
+ *     {
+ *       close (fd);
+ *       econf_getStringValue (key_file, "group", "key", &value);
+ *       free (value);
+ *       econf_free (key_file);
+ *     }
+ * @endcode
+ *
+ */
+extern econf_err econf_attach(econf_file **result, int fd);
+
 #ifdef __cplusplus
 }
 #endif  
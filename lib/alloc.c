@@ -0,0 +1,135 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *libc_allocate(size_t size, void *data __attribute__((unused))) {
+  return malloc(size);
+}
+
+static void *libc_reallocate(void *ptr, size_t size,
+			     void *data __attribute__((unused))) {
+  return realloc(ptr, size);
+}
+
+static void libc_release(void *ptr, void *data __attribute__((unused))) {
+  free(ptr);
+}
+
+/* Calls of allocate and reallocate by this thread */
+static _Thread_local uint64_t allocations;
+
+econf_allocator alloc_hooks = {
+  .allocate = libc_allocate,
+  .reallocate = libc_reallocate,
+  .release = libc_release,
+};
+
+econf_err econf_setAllocator(const econf_allocator *allocator) {
+  if (allocator == NULL) {
+    alloc_hooks = (econf_allocator) {
+      .allocate = libc_allocate,
+      .reallocate = libc_reallocate,
+      .release = libc_release,
+    };
+    return ECONF_SUCCESS;
+  }
+  if (allocator->allocate == NULL || allocator->reallocate == NULL ||
+      allocator->release == NULL)
+    return ECONF_ERROR;
+  alloc_hooks = *allocator;
+  return ECONF_SUCCESS;
+}
+
+/* The hooks are never called with size 0 or a NULL pointer to release */
+void *alloc_malloc(size_t size) {
+  allocations++;
+  return alloc_hooks.allocate(size ? size : 1, alloc_hooks.data);
+}
+
+void *alloc_realloc(void *ptr, size_t size) {
+  allocations++;
+  return alloc_hooks.reallocate(ptr, size ? size : 1, alloc_hooks.data);
+}
+
+void alloc_free(void *ptr) {
+  if (ptr)
+    alloc_hooks.release(ptr, alloc_hooks.data);
+}
+
+void *alloc_calloc(size_t nmemb, size_t size) {
+  if (size && nmemb > SIZE_MAX / size)
+    return NULL;
+  void *ptr = alloc_malloc(nmemb * size);
+  if (ptr)
+    memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+char *alloc_strdup(const char *string) {
+  size_t length = strlen(string) + 1;
+  char *copy = alloc_malloc(length);
+  if (copy)
+    memcpy(copy, string, length);
+  return copy;
+}
+
+char *alloc_strndup(const char *string, size_t length) {
+  length = strnlen(string, length);
+  char *copy = alloc_malloc(length + 1);
+  if (copy) {
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+  }
+  return copy;
+}
+
+int alloc_asprintf(char **result, const char *format, ...) {
+  va_list ap;
+
+  va_start(ap, format);
+  int length = vsnprintf(NULL, 0, format, ap);
+  va_end(ap);
+  if (length < 0)
+    return -1;
+
+  char *string = alloc_malloc((size_t) length + 1);
+  if (string == NULL)
+    return -1;
+  va_start(ap, format);
+  vsnprintf(string, (size_t) length + 1, format, ap);
+  va_end(ap);
+
+  *result = string;
+  return length;
+}
+
+uint64_t alloc_count(void) {
+  return allocations;
+}
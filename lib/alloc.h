@@ -0,0 +1,46 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- alloc.h --- */
+
+#include "libeconf.h"
+
+/* All memory of the library is allocated by the functions installed
+   with econf_setAllocator(). Only memory which is allocated by the C
+   library itself, e.g. by scandir(), is released with free().  */
+extern econf_allocator alloc_hooks;
+
+/* Same as malloc(), realloc(), free(), calloc(), strdup(), strndup()
+   and asprintf() of the C library */
+void *alloc_malloc(size_t size);
+void *alloc_realloc(void *ptr, size_t size);
+void alloc_free(void *ptr);
+void *alloc_calloc(size_t nmemb, size_t size);
+char *alloc_strdup(const char *string);
+char *alloc_strndup(const char *string, size_t length);
+int alloc_asprintf(char **result, const char *format, ...)
+  __attribute__((format(printf, 2, 3)));
+
+/* Number of allocations of the calling thread, see econf_stats  */
+uint64_t alloc_count(void);
@@ -0,0 +1,481 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "libeconf_ext.h"
+#include "libeconf_client.h"
+#include "alloc.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Number of requests which are buffered at once by econf_clientBatch().
+   It only limits the memory of the buffers: econfd stops reading from a
+   client whose responses are not read, so the responses are read while
+   the requests of a window are sent, see client_exchange().  */
+#define CLIENT_WINDOW 1024
+
+/* Size of the frame header: length and error of a response */
+#define RESPONSE_HEADER (2 * sizeof(uint32_t))
+
+struct econf_client {
+  /* Socket, -1 after an error of the connection */
+  int fd;
+  /* Received data which has not been parsed yet */
+  char *input;
+  size_t input_start, input_length, input_alloc_length;
+  /* File descriptor passed with the last response, -1 if none */
+  int passed_fd;
+  /* Requests which are sent with the next write */
+  char *output;
+  size_t output_length, output_alloc_length;
+};
+
+static void
+client_fail(econf_client *client)
+{
+  if (client->fd >= 0)
+    close(client->fd);
+  client->fd = -1;
+}
+
+econf_err
+econf_clientConnect(econf_client **result, const char *socket_path)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+  if (result == NULL)
+    return ECONF_ERROR;
+  if (socket_path == NULL)
+    socket_path = ECONFD_SOCKET;
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+    return ECONF_ERROR;
+  strcpy(addr.sun_path, socket_path);
+
+  econf_client *client = alloc_calloc(1, sizeof(econf_client));
+  if (client == NULL)
+    return ECONF_NOMEM;
+  client->passed_fd = -1;
+  client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (client->fd < 0) {
+    alloc_free(client);
+    return ECONF_ERROR;
+  }
+  int ret;
+  while ((ret = connect(client->fd, (struct sockaddr *) &addr, sizeof(addr))) < 0 &&
+	 errno == EINTR)
+    ;
+  if (ret < 0) {
+    econf_clientDisconnect(client);
+    return ECONF_NOFILE;
+  }
+  *result = client;
+  return ECONF_SUCCESS;
+}
+
+void
+econf_clientDisconnect(econf_client *client)
+{
+  if (client == NULL)
+    return;
+  client_fail(client);
+  if (client->passed_fd >= 0)
+    close(client->passed_fd);
+  alloc_free(client->input);
+  alloc_free(client->output);
+  alloc_free(client);
+}
+
+// Length of the request frame without the length field, 0 if the
+// request cannot be sent.
+static size_t
+request_length(econfd_request_type type, const char *project,
+	       const char *group, const char *key)
+{
+  if (type > ECONFD_GET_SNAPSHOT || project == NULL || key == NULL)
+    return 0;
+  size_t length = 1 + strlen(project) + 1 + (group ? strlen(group) : 0) + 1 +
+    strlen(key) + 1;
+  return length > ECONFD_MAX_REQUEST ? 0 : length;
+}
+
+static econf_err
+append_request(econf_client *client, size_t length, econfd_request_type type,
+	       const char *project, const char *group, const char *key)
+{
+  size_t needed = client->output_length + sizeof(uint32_t) + length;
+  if (needed > client->output_alloc_length) {
+    size_t alloc_length = client->output_alloc_length ?
+      client->output_alloc_length : 4096;
+    while (alloc_length < needed)
+      alloc_length *= 2;
+    char *tmp = alloc_realloc(client->output, alloc_length);
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    client->output = tmp;
+    client->output_alloc_length = alloc_length;
+  }
+
+  char *cp = client->output + client->output_length;
+  uint32_t frame_length = length;
+  memcpy(cp, &frame_length, sizeof(frame_length));
+  cp += sizeof(frame_length);
+  *cp++ = type;
+  cp = stpcpy(cp, project) + 1;
+  cp = stpcpy(cp, group ? group : "") + 1;
+  stpcpy(cp, key);
+  client->output_length = needed;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+client_flush(econf_client *client)
+{
+  size_t written = 0;
+  while (written < client->output_length) {
+    ssize_t n = send(client->fd, client->output + written,
+		     client->output_length - written, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+	continue;
+      client_fail(client);
+      return ECONF_ERROR;
+    }
+    written += n;
+  }
+  client->output_length = 0;
+  return ECONF_SUCCESS;
+}
+
+// Receive more data. A file descriptor passed with it is kept in
+// client->passed_fd.
+static econf_err
+client_receive(econf_client *client)
+{
+  if (client->input_start) {
+    memmove(client->input, client->input + client->input_start,
+	    client->input_length);
+    client->input_start = 0;
+  }
+  if (client->input_length == client->input_alloc_length) {
+    size_t alloc_length = client->input_alloc_length ?
+      client->input_alloc_length * 2 : 65536;
+    char *tmp = alloc_realloc(client->input, alloc_length);
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    client->input = tmp;
+    client->input_alloc_length = alloc_length;
+  }
+
+  struct iovec iov = {
+    .iov_base = client->input + client->input_length,
+    .iov_len = client->input_alloc_length - client->input_length
+  };
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct msghdr msg = {
+    .msg_iov = &iov,
+    .msg_iovlen = 1,
+    .msg_control = control.buffer,
+    .msg_controllen = sizeof(control.buffer)
+  };
+  ssize_t n;
+  while ((n = recvmsg(client->fd, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+    ;
+  if (n <= 0) {
+    client_fail(client);
+    return ECONF_ERROR;
+  }
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+	cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      if (client->passed_fd >= 0)
+	close(client->passed_fd);
+      memcpy(&client->passed_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  client->input_length += n;
+  return ECONF_SUCCESS;
+}
+
+// Take the next response from the input buffer. *complete is false if
+// it has not been received completely yet. value points into the input
+// buffer and is valid until the next receive.
+static econf_err
+client_frame(econf_client *client, bool *complete, econf_err *error,
+	     const char **value, size_t *length)
+{
+  *complete = false;
+  if (client->input_length < RESPONSE_HEADER)
+    return ECONF_SUCCESS;
+
+  const char *frame = client->input + client->input_start;
+  uint32_t frame_length, frame_error;
+  memcpy(&frame_length, frame, sizeof(frame_length));
+  if (frame_length < sizeof(frame_error) ||
+      frame_length > ECONFD_MAX_RESPONSE) {
+    client_fail(client);
+    return ECONF_ERROR;
+  }
+  if (client->input_length < sizeof(frame_length) + frame_length)
+    return ECONF_SUCCESS;
+
+  memcpy(&frame_error, frame + sizeof(frame_length), sizeof(frame_error));
+  *error = frame_error;
+  *value = frame + RESPONSE_HEADER;
+  *length = frame_length - sizeof(frame_error);
+  client->input_start += sizeof(frame_length) + frame_length;
+  client->input_length -= sizeof(frame_length) + frame_length;
+  *complete = true;
+  return ECONF_SUCCESS;
+}
+
+// Read the next response, see client_frame().
+static econf_err
+client_response(econf_client *client, econf_err *error, const char **value,
+		size_t *length)
+{
+  econf_err ret;
+  bool complete;
+  while (!(ret = client_frame(client, &complete, error, value, length)) &&
+	 !complete) {
+    if ((ret = client_receive(client)))
+      return ret;
+  }
+  return ret;
+}
+
+static econf_err
+decode_value(econf_client_request *request, const char *value, size_t length)
+{
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+  } number;
+
+  if (request->type == ECONFD_GET_STRING) {
+    if (length == 0 || value[length - 1] != '\0')
+      return ECONF_ERROR;
+    request->value.s = alloc_strdup(value);
+    return request->value.s ? ECONF_SUCCESS : ECONF_NOMEM;
+  }
+  if (length != sizeof(number))
+    return ECONF_ERROR;
+  memcpy(&number, value, sizeof(number));
+  switch (request->type) {
+  case ECONFD_GET_INT:
+    request->value.i = number.i;
+    break;
+  case ECONFD_GET_INT64:
+    request->value.i64 = number.i;
+    break;
+  case ECONFD_GET_UINT:
+    request->value.u = number.u;
+    break;
+  case ECONFD_GET_UINT64:
+    request->value.u64 = number.u;
+    break;
+  case ECONFD_GET_FLOAT:
+    request->value.f = number.d;
+    break;
+  case ECONFD_GET_DOUBLE:
+    request->value.d = number.d;
+    break;
+  case ECONFD_GET_BOOL:
+    request->value.b = number.u != 0;
+    break;
+  default:
+    return ECONF_ERROR;
+  }
+  return ECONF_SUCCESS;
+}
+
+// Send the buffered requests and read the responses of requests
+// [start, end) at the same time. Requests with an error have not been
+// sent. If the requests were sent first, econfd could stop reading them
+// while its responses fill the socket buffer and both sides would wait
+// for each other.
+static econf_err
+client_exchange(econf_client *client, econf_client_request *requests,
+		size_t start, size_t end)
+{
+  size_t written = 0, next = start;
+  econf_err error;
+
+  for (;;) {
+    /* Take all complete responses from the input */
+    while (next < end) {
+      econf_client_request *r = &requests[next];
+      const char *value;
+      size_t value_length;
+      bool complete;
+      if (r->error) {
+	next++;
+	continue;
+      }
+      if ((error = client_frame(client, &complete, &r->error, &value,
+				&value_length)))
+	return error;
+      if (!complete)
+	break;
+      if (r->error == ECONF_SUCCESS &&
+	  (r->error = decode_value(r, value, value_length)) == ECONF_ERROR) {
+	client_fail(client);
+	return ECONF_ERROR;
+      }
+      next++;
+    }
+    if (next == end)
+      break;
+
+    struct pollfd pfd = {
+      .fd = client->fd,
+      .events = POLLIN | (written < client->output_length ? POLLOUT : 0)
+    };
+    if (poll(&pfd, 1, -1) < 0) {
+      if (errno == EINTR)
+	continue;
+      client_fail(client);
+      return ECONF_ERROR;
+    }
+    if ((pfd.revents & POLLOUT) && written < client->output_length) {
+      ssize_t n = send(client->fd, client->output + written,
+		       client->output_length - written,
+		       MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n >= 0)
+	written += n;
+      else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+	client_fail(client);
+	return ECONF_ERROR;
+      }
+    }
+    if ((pfd.revents & (POLLIN | POLLHUP | POLLERR)) &&
+	(error = client_receive(client)))
+      return error;
+  }
+  client->output_length = 0;
+  return ECONF_SUCCESS;
+}
+
+econf_err
+econf_clientBatch(econf_client *client, econf_client_request *requests,
+		  size_t length)
+{
+  econf_err error;
+
+  if (client == NULL || (requests == NULL && length))
+    return ECONF_ERROR;
+  if (client->fd < 0)
+    return ECONF_ERROR;
+
+  for (size_t start = 0; start < length;) {
+    size_t end = start, sent = 0;
+    for (; end < length && sent < CLIENT_WINDOW; end++) {
+      econf_client_request *r = &requests[end];
+      size_t frame_length = r->type == ECONFD_GET_SNAPSHOT ? 0 :
+	request_length(r->type, r->project, r->group, r->key);
+      memset(&r->value, 0, sizeof(r->value));
+      if (frame_length == 0) {
+	r->error = ECONF_ERROR;
+	continue;
+      }
+      if ((error = append_request(client, frame_length, r->type, r->project,
+				  r->group, r->key))) {
+	client->output_length = 0;
+	return error;
+      }
+      r->error = ECONF_SUCCESS;
+      sent++;
+    }
+    if ((error = client_exchange(client, requests, start, end)))
+      return error;
+    start = end;
+  }
+  return ECONF_SUCCESS;
+}
+
+/* The econf_clientGet*Value functions are identical except for result
+   value type, so let's create them via a macro. */
+#define econf_clientGetValue(FCT_TYPE, TYPE, REQUEST_TYPE, MEMBER)	\
+econf_err econf_clientGet ## FCT_TYPE ## Value(econf_client *client,	\
+			     const char *project, const char *group,	\
+			     const char *key, TYPE *result) {		\
+  econf_client_request request = {					\
+    .type = REQUEST_TYPE, .project = project, .group = group, .key = key \
+  };									\
+  econf_err error = econf_clientBatch(client, &request, 1);		\
+  if (error)								\
+    return error;							\
+  if (request.error == ECONF_SUCCESS)					\
+    *result = request.value.MEMBER;					\
+  return request.error;							\
+}
+
+econf_clientGetValue(Int, int32_t, ECONFD_GET_INT, i)
+econf_clientGetValue(Int64, int64_t, ECONFD_GET_INT64, i64)
+econf_clientGetValue(UInt, uint32_t, ECONFD_GET_UINT, u)
+econf_clientGetValue(UInt64, uint64_t, ECONFD_GET_UINT64, u64)
+econf_clientGetValue(Float, float, ECONFD_GET_FLOAT, f)
+econf_clientGetValue(Double, double, ECONFD_GET_DOUBLE, d)
+econf_clientGetValue(String, char *, ECONFD_GET_STRING, s)
+econf_clientGetValue(Bool, bool, ECONFD_GET_BOOL, b)
+
+econf_err
+econf_clientGetSnapshot(econf_client *client, const char *project,
+			econf_file **result)
+{
+  econf_err error, response_error;
+  const char *value;
+  size_t value_length;
+
+  if (client == NULL || result == NULL || client->fd < 0)
+    return ECONF_ERROR;
+  size_t length = request_length(ECONFD_GET_SNAPSHOT, project, NULL, "");
+  if (length == 0)
+    return ECONF_ERROR;
+  if ((error = append_request(client, length, ECONFD_GET_SNAPSHOT, project,
+			      NULL, "")) ||
+      (error = client_flush(client)) ||
+      (error = client_response(client, &response_error, &value, &value_length)))
+    return error;
+
+  int fd = client->passed_fd;
+  client->passed_fd = -1;
+  if (response_error) {
+    if (fd >= 0)
+      close(fd);
+    return response_error;
+  }
+  if (fd < 0)
+    return ECONF_ERROR;
+  error = econf_attach(result, fd);
+  close(fd);
+  return error;
+}
@@ -34,10 +34,9 @@
 
 /* NULL value */
 #define KEY_FILE_NULL_VALUE "_none_"
-#define KEY_FILE_NULL_VALUE_HASH hashstring(KEY_FILE_NULL_VALUE)
 
-/* Bool values */
-#define YES hashstring("yes")
-#define NO hashstring("no")
-#define TRUE hashstring("true")
-#define FALSE hashstring("false")
+/* Bool values, compared case insensitive */
+#define YES "yes"
+#define NO "no"
+#define TRUE "true"
+#define FALSE "false"
@@ -27,6 +27,7 @@
 
 #include <string.h>
 #include "libeconf.h"
+#include "alloc.h"
 
 #define econf_getValueDef(FCT_TYPE, TYPE, STRDUP)				\
 econf_err econf_get ## FCT_TYPE ## ValueDef(econf_file *ef, const char *group, \
@@ -47,5 +48,5 @@ econf_getValueDef(UInt, uint32_t, )
 econf_getValueDef(UInt64, uint64_t, )
 econf_getValueDef(Float, float, )
 econf_getValueDef(Double, double, )
-econf_getValueDef(String, char *, strdup)
+econf_getValueDef(String, char *, alloc_strdup)
 econf_getValueDef(Bool, bool, )
@@ -22,9 +22,17 @@
 */
 
 #include "libeconf.h"
+#include "alloc.h"
+#include "libeconf_ext.h"
 #include "defines.h"
 #include "getfilecontents.h"
 #include "helpers.h"
+#include "keyindex.h"
+#include "options.h"
+#include "probes.h"
+#include "sources.h"
+#include "scanner.h"
+#include "stats.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -51,8 +59,9 @@ join_same_entries(econf_file *ef)
 	    strlen(ef->file_entry[j].value) == 0)
 	{
 	  /* reset entry */
-	  free(ef->file_entry[i].value);
-	  ef->file_entry[i].value = strdup("");
+	  alloc_free(ef->file_entry[i].value);
+	  ef->file_entry[i].value = alloc_strdup("");
+	  value_cache_reset(&ef->file_entry[i].cache);
 	} else {
 	  /* appending value */
 	  post = ef->file_entry[j].value;
@@ -62,11 +71,12 @@ join_same_entries(econf_file *ef)
 	  {
 	    /* removing leading spaces */
 	    while(isspace(*post)) post++;
-	    ret = asprintf(&(ef->file_entry[i].value), "%s\n%s", pre,
+	    ret = alloc_asprintf(&(ef->file_entry[i].value), "%s\n%s", pre,
 			   post);
 	    if(ret<0)
 	      return ECONF_NOMEM;
-	    free(pre);
+	    alloc_free(pre);
+	    value_cache_reset(&ef->file_entry[i].cache);
 	  }
 	}
 
@@ -76,18 +86,18 @@ join_same_entries(econf_file *ef)
 	{
 	  post = ef->file_entry[j].comment_before_key;
           pre = ef->file_entry[i].comment_before_key;
-	  int ret = asprintf(&(ef->file_entry[i].comment_before_key),
+	  int ret = alloc_asprintf(&(ef->file_entry[i].comment_before_key),
 			     "%s\n%s", pre, post);
 	  if(ret<0)
 	    return ECONF_NOMEM;
-	  free(pre);
+	  alloc_free(pre);
 	}
 
 	if (ef->file_entry[j].value == NULL ||
 	    strlen(ef->file_entry[j].value) == 0)
 	{
 	  /* reset after value comment */
-	  free(ef->file_entry[i].comment_after_value);
+	  alloc_free(ef->file_entry[i].comment_after_value);
 	  ef->file_entry[i].comment_after_value = NULL;
 	} else {
 	  /* appending after value comment */
@@ -100,13 +110,13 @@ join_same_entries(econf_file *ef)
             while(isspace(*post)) post++;
             if (pre == NULL)
 	    {
-	      ef->file_entry[i].comment_after_value = strdup(post);
+	      ef->file_entry[i].comment_after_value = alloc_strdup(post);
 	    } else {
-	      int ret = asprintf(&(ef->file_entry[i].comment_after_value),
+	      int ret = alloc_asprintf(&(ef->file_entry[i].comment_after_value),
 				 "%s\n%s", pre, post);
 	      if(ret<0)
 		return ECONF_NOMEM;
-	      free(pre);
+	      alloc_free(pre);
 	    }
 	  }
 	}
@@ -116,12 +126,26 @@ join_same_entries(econf_file *ef)
   return ECONF_SUCCESS;
 }
 
+/* State of read_file() while the file is parsed */
+struct read_state {
+  econf_file *ef;
+  /* Source of all entries, see sources.h */
+  size_t source;
+  /* Length and allocated size of the value of the last entry. Lines
+     are appended to it in amortized constant time. */
+  size_t value_length, value_alloc_length;
+};
+
 static econf_err
-store (econf_file *ef, const char *group, const char *key,
+store (struct read_state *state, const char *group, const char *key,
        const char *value, const uint64_t line_number,
        const char *comment_before_key, const char *comment_after_value,
        const bool append_entry)
 {
+  econf_file *ef = state->ef;
+
+  PROBE5(store, ef->path, line_number, group, key, append_entry);
+
   if (append_entry)
   {
     /* Appending next line to the last entry. */
@@ -130,11 +154,24 @@ store (econf_file *ef, const char *group, const char *key,
       return ECONF_MISSING_DELIMITER;
     }
     char *content = ef->file_entry[ef->length-1].value;
-    int ret = asprintf(&(ef->file_entry[ef->length-1].value), "%s\n%s", content,
-	     value);
-    if(ret<0)
-      return ECONF_NOMEM;
-    free(content);
+    size_t length = strlen(value);
+    size_t needed = state->value_length + length + 2;
+    if (needed > state->value_alloc_length)
+    {
+      size_t alloc_length = state->value_alloc_length * 2;
+      if (alloc_length < needed)
+	alloc_length = needed;
+      content = alloc_realloc(content, alloc_length);
+      if (content == NULL)
+	return ECONF_NOMEM;
+      ef->file_entry[ef->length-1].value = content;
+      state->value_alloc_length = alloc_length;
+    }
+    content[state->value_length++] = '\n';
+    memcpy(content + state->value_length, value, length + 1);
+    state->value_length += length;
+    int ret;
+    value_cache_reset(&ef->file_entry[ef->length-1].cache);
     /* Points to the end of the array. This is needed for the next entry. */
     ef->file_entry[ef->length-1].line_number = line_number;
 
@@ -150,11 +187,11 @@ store (econf_file *ef, const char *group, const char *key,
       if (ef->file_entry[ef->length-1].comment_after_value)
       {
 	content = ef->file_entry[ef->length-1].comment_after_value;
-	ret = asprintf(&(ef->file_entry[ef->length-1].comment_after_value), "%s\n%s", content,
+	ret = alloc_asprintf(&(ef->file_entry[ef->length-1].comment_after_value), "%s\n%s", content,
 		       comment_after_value);
-	free(content);
+	alloc_free(content);
       } else {
-	ret = asprintf(&(ef->file_entry[ef->length-1].comment_after_value), "\n%s",
+	ret = alloc_asprintf(&(ef->file_entry[ef->length-1].comment_after_value), "\n%s",
 		       comment_after_value);
       }
       if(ret<0)
@@ -165,40 +202,39 @@ store (econf_file *ef, const char *group, const char *key,
   }
 
   /* not appending -> new entry */
-  if (ef->alloc_length == ef->length) {
-    struct file_entry *tmp;
-
-    tmp = realloc(ef->file_entry, (ef->length + 1) * sizeof(struct file_entry));
-    if (!tmp)
-      return ECONF_NOMEM;
-    ef->file_entry = tmp;
-    ef->length++;
-    ef->alloc_length = ef->length;
-  }
+  econf_err error = key_file_reserve(ef, ef->length + 1);
+  if (error)
+    return error;
+  ef->length++;
 
   ef->file_entry[ef->length-1].line_number = line_number;
+  ef->file_entry[ef->length-1].source = state->source;
+  ef->file_entry[ef->length-1].cache.type = VALUE_CACHE_NONE;
 
   if (group)
-    ef->file_entry[ef->length-1].group = strdup(group);
+    ef->file_entry[ef->length-1].group = alloc_strdup(group);
   else
-    ef->file_entry[ef->length-1].group = strdup(KEY_FILE_NULL_VALUE);
+    ef->file_entry[ef->length-1].group = alloc_strdup(KEY_FILE_NULL_VALUE);
 
   if (key)
-    ef->file_entry[ef->length-1].key = strdup(key);
+    ef->file_entry[ef->length-1].key = alloc_strdup(key);
   else
-    ef->file_entry[ef->length-1].key = strdup(KEY_FILE_NULL_VALUE);
+    ef->file_entry[ef->length-1].key = alloc_strdup(KEY_FILE_NULL_VALUE);
 
+  /* A key without value gets an empty one if lines are appended */
+  state->value_length = value ? strlen(value) : 0;
+  state->value_alloc_length = value ? state->value_length + 1 : 0;
   if (value)
-    ef->file_entry[ef->length-1].value = strdup(value);
+    ef->file_entry[ef->length-1].value = alloc_strdup(value);
   else
     ef->file_entry[ef->length-1].value = NULL;
 
   if (comment_before_key)
-    ef->file_entry[ef->length-1].comment_before_key = strdup(comment_before_key);
+    ef->file_entry[ef->length-1].comment_before_key = alloc_strdup(comment_before_key);
   else
     ef->file_entry[ef->length-1].comment_before_key = NULL;
   if (comment_after_value)
-    ef->file_entry[ef->length-1].comment_after_value = strdup(comment_after_value);
+    ef->file_entry[ef->length-1].comment_after_value = alloc_strdup(comment_after_value);
   else
     ef->file_entry[ef->length-1].comment_after_value = NULL;
 
@@ -221,224 +257,239 @@ check_delim(const char *str, bool *has_wsp, bool *has_nonwsp)
   }
 }
 
-static void free_buffer(char **buffer)
+/* Append text to *comment separated by a newline */
+static econf_err
+append_comment(char **comment, const char *text)
 {
-    free(*buffer);
+  if (*comment == NULL) {
+    *comment = alloc_strdup(text);
+    return *comment ? ECONF_SUCCESS : ECONF_NOMEM;
+  }
+  char *content = *comment;
+  if (alloc_asprintf(comment, "%s\n%s", content, text) < 0) {
+    *comment = content;
+    return ECONF_NOMEM;
+  }
+  alloc_free(content);
+  return ECONF_SUCCESS;
 }
 
-/* Read the file line by line and parse for comments, keys and values */
-econf_err
-read_file(econf_file *ef, const char *file,
-	  const char *delim, const char *comment)
+struct econf_parser {
+  char *delim;
+  char *comment;
+  bool has_wsp, has_nonwsp;
+  /* OPT_DISCARD_COMMENTS and OPT_NO_MULTILINE, see options.h */
+  unsigned int flags;
+  /* Variant of parse_line() which has been compiled for flags */
+  econf_err (*parse_line)(econf_parser *parser, char *buf, size_t length);
+  struct scanner scanner;
+  econf_parse_callbacks callbacks;
+  void *data;
+  char *current_group;
+  char *current_comment_before_key;
+  char *current_comment_after_value;
+  uint64_t line, last_entry_line;
+  /* Byte offset of the next line */
+  size_t offset;
+  /* Incomplete line which has been fed so far */
+  char *buf;
+  size_t buf_length, buf_alloc_length;
+  /* First error which has occurred. Parsing stops there. */
+  econf_err error;
+  bool finished;
+};
+
+/* The parser is compiled once for every combination of these flags.
+   They are constant in every variant, so the compiler removes the code
+   which is not needed.  */
+#define PARSE_FLAGS (OPT_DISCARD_COMMENTS | OPT_NO_MULTILINE)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* Report a comment which starts at p and cut it from the line */
+static ALWAYS_INLINE econf_err
+cut_comment(econf_parser *parser, char *name, char *p,
+	    const unsigned int flags)
 {
-  char buf[BUFSIZ];
-  char *current_group = NULL;
-  char *current_comment_before_key = NULL;
-  char *current_comment_after_value = NULL;
   econf_err retval = ECONF_SUCCESS;
-  uint64_t line = 0;
-  bool has_wsp, has_nonwsp;
-  FILE *kf = fopen(file, "rbe");
 
-  if (kf == NULL)
-    return ECONF_NOFILE;
-
-  if (last_scanned_filename != NULL)
-    free(last_scanned_filename);
-  last_scanned_filename = strdup(file);
-  if (last_scanned_filename == NULL) {
-    fclose (kf);
-    return ECONF_NOMEM;
-  }
-
-  check_delim(delim, &has_wsp, &has_nonwsp);
-
-  ef->path = strdup (file);
-  if (ef->path == NULL) {
-    fclose (kf);
-    return ECONF_NOMEM;
+  /* Discarded comments are only reported to the callback */
+  if (!(flags & OPT_DISCARD_COMMENTS)) {
+    if(p==name)
+    {
+      /* Comment is defined in the line before the key/value line */
+      retval = append_comment(&parser->current_comment_before_key, p+1);
+    } else {
+      /* Comment is defined after the key/value in the same line */
+      retval = append_comment(&parser->current_comment_after_value, p+1);
+    }
   }
-  ef->delimiter = *delim;
-
-  while (fgets(buf, sizeof(buf), kf)) {
-    char *p, *name, *data = NULL;
-    bool quote_seen = false, delim_seen = false;
-    char *org_buf __attribute__ ((__cleanup__(free_buffer))) = strdup(buf);
-
-    line++;
-    last_scanned_line_nr = line;
-
-    /* Remove trailing newline character */
-    size_t n = strlen(buf);
-    if (n && *(buf + n - 1) == '\n')
-      *(buf + n - 1) = '\0';
-
-    if (!*buf)
-      continue; /* empty line */
-
-    /* ignore space at begin of the line */
-    name = buf;
-    while (*name && isspace((unsigned)*name))
-      name++;
+  if (!retval && parser->callbacks.on_comment)
+    retval = parser->callbacks.on_comment(parser->data, p+1, p != name,
+					  parser->line);
+  *p = '\0';
+  return retval;
+}
 
-    /* go through all comment characters and check, if one of could be found */
-    for (size_t i = 0; i < strlen(comment); i++) {
-      p = strchr(name, comment[i]);
-      if (p)
-      {
-	if(p==name)
-	{
-	  /* Comment is defined in the line before the key/value line */
-	  if (current_comment_before_key)
-          {
-	    /* appending */
-	    char *content = current_comment_before_key;
-	    int ret = asprintf(&current_comment_before_key, "%s\n%s", content,
-			       p+1);
-	    if(ret<0)
-	      return ECONF_NOMEM;
-	    free(content);
-	  } else {
-	    current_comment_before_key = strdup(p+1);
-	  }
-	} else {
-	  /* Comment is defined after the key/value in the same line */
-	  if (current_comment_after_value)
-	  {
-	    /* appending */
-	    char *content = current_comment_after_value;
-	    int ret = asprintf(&current_comment_after_value, "%s\n%s", content,
-			       p+1);
-	    if(ret<0)
-	      return ECONF_NOMEM;
-	    free(content);
-	  } else {
-	    current_comment_after_value = strdup(p+1);
-	  }
+/* Parse one line for comments, keys and values. buf has to be
+   terminated by a 0 byte and is modified. */
+static ALWAYS_INLINE econf_err
+parse_line(econf_parser *parser, char *buf, size_t length,
+	   const unsigned int flags)
+{
+  const econf_parse_callbacks *callbacks = &parser->callbacks;
+  const struct scanner *scanner = &parser->scanner;
+  char *p, *name, *data, *end, *name_end = NULL, name_end_char = '\0';
+  bool quote_seen = false, delim_seen = false;
+  size_t line_start = parser->offset, line_end = parser->offset + length;
+  econf_err retval;
+
+  parser->offset = line_end;
+  parser->line++;
+  last_scanned_line_nr = parser->line;
+
+  if (callbacks->on_line &&
+      (retval = callbacks->on_line(parser->data, buf, length, parser->line)))
+    return retval;
+
+  /* Remove trailing newline character. A 0 byte ends the line, too. */
+  end = buf + strnlen(buf, length);
+  if (end > buf && *(end - 1) == '\n')
+    *--end = '\0';
+
+  if (end == buf)
+    return ECONF_SUCCESS; /* empty line */
+
+  /* ignore space at begin of the line */
+  name = buf;
+  while (name < end && scanner_is(scanner, *name, SCAN_SPACE))
+    name++;
+
+  /* go through all comment characters and check, if one of could be found */
+  size_t pos = scanner_find(scanner, name, end - name, SCAN_COMMENT);
+  if (pos < (size_t) (end - name)) {
+    if (parser->comment[1] == '\0') {
+      if ((retval = cut_comment(parser, name, name + pos, flags)))
+	return retval;
+      end = name + pos;
+    } else {
+      /* The comment characters are handled in the given order */
+      for (const char *c = parser->comment; *c; c++) {
+	p = memchr(name, *c, end - name);
+	if (p) {
+	  if ((retval = cut_comment(parser, name, p, flags)))
+	    return retval;
+	  end = p;
 	}
-	*p = '\0';
-      }
-    }
-
-    if (!*buf)
-      continue; /* result is empty line */
-
-    /* check for groups */
-    if (name[0] == '[') {
-      p = name + strlen(name) - 1;
-      /* XXX Remove [] around group name */
-      while (isspace (*p)) p--;
-      if (*p != ']') {
-	if (strchr(name,']') == NULL)
-	  retval = ECONF_MISSING_BRACKET;
-	else
-	  retval = ECONF_TEXT_AFTER_SECTION;
-	goto out;
       }
-      p++;
-      *p = '\0';
-      if(strlen(name) <= 2) /* empty string = "[]" */
-      {
-	retval = ECONF_EMPTY_SECTION_NAME;
-	goto out;
-      }
-      if (current_group)
-	free (current_group);
-      current_group = strdup (name);
-      continue;
     }
+  }
 
-    /* go to the end of the name */
-    data = name;
-    while (*data && !(isspace((unsigned)*data) ||
-		      strchr(delim, *data) != NULL))
-      data++;
-    if (data > name && *data) {
-      if (has_wsp && has_nonwsp)
-      {
-	/*
-	 * delim contains both whitespace and non-whitespace characters.
-	 * In this case delim_seen has the special meaning "non-whitespace
-	 * delim seen". See comment below.
-	 */
-	delim_seen = !isspace((unsigned)*data) &&
-	  strchr(delim, *data) != NULL;
-      }
-      else
-      {
-	delim_seen = strchr(delim, *data) != NULL;
-      }
-      *data++ = '\0';
+  if (end == buf)
+    return ECONF_SUCCESS; /* result is empty line */
+
+  /* check for groups */
+  if (name[0] == '[') {
+    p = end - 1;
+    /* XXX Remove [] around group name */
+    while (scanner_is(scanner, *p, SCAN_SPACE)) p--;
+    if (*p != ']') {
+      if (memchr(name, ']', end - name) == NULL)
+	return ECONF_MISSING_BRACKET;
+      return ECONF_TEXT_AFTER_SECTION;
     }
+    p++;
+    *p = '\0';
+    if(p - name <= 2) /* empty string = "[]" */
+      return ECONF_EMPTY_SECTION_NAME;
+    if (parser->current_group)
+      alloc_free (parser->current_group);
+    parser->current_group = alloc_strdup (name);
+    if (parser->current_group == NULL)
+      return ECONF_NOMEM;
+    if (callbacks->on_group)
+      return callbacks->on_group(parser->data, parser->current_group,
+				 parser->line);
+    return ECONF_SUCCESS;
+  }
 
-    /* Checking and adding multiline entries which are
-     * not defined by a beginning quote in the line before.
-     */
-    bool found_delim = delim_seen;
-    if (!found_delim)
+  /* go to the end of the name */
+  data = name + scanner_find(scanner, name, end - name,
+			     SCAN_SPACE | SCAN_DELIM);
+  if (data > name && data < end) {
+    if (parser->has_wsp && parser->has_nonwsp)
     {
-      /* searching the rest of the string for delimiters */
-      char *c = data;
-      while (*c && !(strchr(delim, *c) != NULL))
-	c++;
-      if (*c)
-	found_delim = true;
+      /*
+       * delim contains both whitespace and non-whitespace characters.
+       * In this case delim_seen has the special meaning "non-whitespace
+       * delim seen". See comment below.
+       */
+      delim_seen = !scanner_is(scanner, *data, SCAN_SPACE) &&
+	scanner_is(scanner, *data, SCAN_DELIM);
     }
-    if (!found_delim &&
-        /* Entry has already been found */	
-	ef->length > 0 &&
-	/* The Entry must be the next line. Otherwise it is a new one */
-	ef->file_entry[ef->length-1].line_number+1 == line)
+    else
     {
-      /* removing comments */
-      for (size_t i = 0; i < strlen(comment); i++) {
-	char *pt = strchr(org_buf, comment[i]);
-	if (pt)
-	  *pt = '\0';
-      }
-      /* removing \n at the end of the line */
-      if( org_buf[strlen(org_buf)-1] == '\n' )
-        org_buf[strlen(org_buf)-1] = 0;
-      retval = store(ef, current_group, name, org_buf, line,
-		     current_comment_before_key, current_comment_after_value,
-		     true /* appending entry */);
-      free(current_comment_before_key);
-      current_comment_before_key = NULL;
-      free(current_comment_after_value);
-      current_comment_after_value = NULL;
-      if (retval)
-	goto out;
-      continue;
+      delim_seen = scanner_is(scanner, *data, SCAN_DELIM);
     }
-    
+    /* Remember the character for a continuation line */
+    name_end = data;
+    name_end_char = *data;
+    *data++ = '\0';
+  }
+
+  econf_parse_entry entry = {
+    .group = parser->current_group,
+    .comment_before_key = parser->current_comment_before_key,
+    .comment_after_value = parser->current_comment_after_value,
+    .line_number = parser->line,
+    .line_start = line_start,
+    .line_end = line_end,
+  };
+
+  /* Checking and adding multiline entries which are
+   * not defined by a beginning quote in the line before.
+   * The rest of the string is searched for delimiters.
+   */
+  if (!(flags & OPT_NO_MULTILINE) && !delim_seen &&
+      scanner_find(scanner, data, end - data, SCAN_DELIM) == (size_t) (end - data) &&
+      /* Entry has already been found */
+      parser->last_entry_line > 0 &&
+      /* The Entry must be the next line. Otherwise it is a new one */
+      parser->last_entry_line+1 == parser->line)
+  {
+    /* The whole line without comments and newline is the value. Comments
+       and the newline have already been removed from buf, so only the
+       end of the name has to be restored. */
+    if (name_end)
+      *name_end = name_end_char;
+    entry.value = buf;
+    entry.continuation = true;
+  } else {
     /* Go on. It is not an multiline entry */
-    
-    if (!*name || data == name)
-      continue;
 
-    if (*data == '\0')
+    if (name == end || data == name)
+      return ECONF_SUCCESS;
+
+    if (data == end)
       /* No seperator -> return NULL pointer, there is no value,
 	 not even an empty key */
       data = NULL;
     else {
       /* go to the begin of the value */
-      while (*data && isspace((unsigned)*data))
+      while (data < end && scanner_is(scanner, *data, SCAN_SPACE))
 	data++;
-      if (!has_wsp && !delim_seen) {
+      if (!parser->has_wsp && !delim_seen) {
 	/*
 	 * If delim consists only of non-whitespace characters,
 	 * require at least one delimiter, and skip more whitespace
 	 * after it.
 	 */
-	if (!*data || strchr(delim, *data) == NULL) {
-	  retval = ECONF_MISSING_DELIMITER;
-	  goto out;
-	}
+	if (data == end || !scanner_is(scanner, *data, SCAN_DELIM))
+	  return ECONF_MISSING_DELIMITER;
 	data++;
-	while (*data && isspace((unsigned)*data))
+	while (data < end && scanner_is(scanner, *data, SCAN_SPACE))
 	  data++;
-      } else if (has_wsp && has_nonwsp && !delim_seen &&
-		 *data && strchr(delim, *data) != NULL) {
+      } else if (parser->has_wsp && parser->has_nonwsp && !delim_seen &&
+		 data < end && scanner_is(scanner, *data, SCAN_DELIM)) {
 	/*
 	 * If delim contains both whitespace and non-whitespace characters,
 	 * use any combination of one non-whitespace delimiter and
@@ -452,7 +503,7 @@ read_file(econf_file *ef, const char *file,
 	 * key==value -> "=value"
 	 */
 	data++;
-	while (*data && isspace((unsigned)*data))
+	while (data < end && scanner_is(scanner, *data, SCAN_SPACE))
 	  data++;
       }
       if (*data == '"') {
@@ -461,10 +512,10 @@ read_file(econf_file *ef, const char *file,
       }
 
       /* remove space at the end of the value */
-      p = data + strlen(data);
+      p = end;
       if (p > data)
 	p--;
-      while (p > data && (isspace((unsigned)*p)))
+      while (p > data && scanner_is(scanner, *p, SCAN_SPACE))
 	p--;
       /* Strip double quotes only if both leading and trainling quote exist. */
       if (p > data && quote_seen) {
@@ -473,33 +524,318 @@ read_file(econf_file *ef, const char *file,
 	else
 	  data--;
       }
-      if (*(p + 1) != '\0')
-	*(p + 1) = '\0';
+      /* p is the last character of the value if it is not empty */
+      if (p < end)
+	p++;
+      *p = '\0';
+
+      entry.value_start = line_start + (size_t) (data - buf);
+      entry.value_end = entry.value_start + (size_t) (p - data);
     }
 
-    retval = store(ef, current_group, name, data, line,
-		   current_comment_before_key, current_comment_after_value,
-		   false /* new entry */);
-    free(current_comment_before_key);
-    current_comment_before_key = NULL;
-    free(current_comment_after_value);
-    current_comment_after_value = NULL;    
-    if (retval)
-      goto out;
+    entry.key = name;
+    entry.value = data;
   }
 
- out:
+  retval = ECONF_SUCCESS;
+  if (callbacks->on_entry)
+    retval = callbacks->on_entry(parser->data, &entry);
+  parser->last_entry_line = parser->line;
+  if (!(flags & OPT_DISCARD_COMMENTS)) {
+    alloc_free(parser->current_comment_before_key);
+    parser->current_comment_before_key = NULL;
+    alloc_free(parser->current_comment_after_value);
+    parser->current_comment_after_value = NULL;
+  }
+  return retval;
+}
+
+#define PARSE_LINE_VARIANT(name, flags)					\
+  static econf_err name(econf_parser *parser, char *buf, size_t length)	\
+  {									\
+    return parse_line(parser, buf, length, flags);			\
+  }
+
+PARSE_LINE_VARIANT(parse_line_full, 0)
+PARSE_LINE_VARIANT(parse_line_discard_comments, OPT_DISCARD_COMMENTS)
+PARSE_LINE_VARIANT(parse_line_no_multiline, OPT_NO_MULTILINE)
+PARSE_LINE_VARIANT(parse_line_lean, OPT_DISCARD_COMMENTS | OPT_NO_MULTILINE)
+
+/* Indexed by the PARSE_FLAGS of the parser */
+static econf_err (*const parse_line_variants[])(econf_parser *, char *,
+						  size_t) = {
+  [0] = parse_line_full,
+  [OPT_DISCARD_COMMENTS] = parse_line_discard_comments,
+  [OPT_NO_MULTILINE] = parse_line_no_multiline,
+  [OPT_DISCARD_COMMENTS | OPT_NO_MULTILINE] = parse_line_lean,
+};
+
+/* Parse the buffered line and start a new one */
+static econf_err
+parse_buffer(econf_parser *parser)
+{
+  parser->buf[parser->buf_length] = '\0';
+  econf_err error = parser->parse_line(parser, parser->buf,
+				       parser->buf_length);
+  parser->buf_length = 0;
+  return error;
+}
+
+/* Create a parser which uses the variant of parse_line() for flags */
+static econf_err
+new_parser(econf_parser **result, const char *delim, const char *comment,
+	   unsigned int flags, const econf_parse_callbacks *callbacks,
+	   void *data)
+{
+  if (result == NULL || delim == NULL || callbacks == NULL)
+    return ECONF_ERROR;
+  if (comment == NULL || !*comment)
+    comment = "#";
+
+  econf_parser *parser = alloc_calloc(1, sizeof(econf_parser));
+  if (parser == NULL)
+    return ECONF_NOMEM;
+  parser->delim = alloc_strdup(delim);
+  parser->comment = alloc_strdup(comment);
+  if (parser->delim == NULL || parser->comment == NULL) {
+    econf_freeParser(parser);
+    return ECONF_NOMEM;
+  }
+  check_delim(delim, &parser->has_wsp, &parser->has_nonwsp);
+  scanner_init(&parser->scanner, delim, comment);
+  parser->callbacks = *callbacks;
+  parser->data = data;
+  parser->flags = flags & PARSE_FLAGS;
+  parser->parse_line = parse_line_variants[parser->flags];
+
+  *result = parser;
+  return ECONF_SUCCESS;
+}
+
+econf_err
+econf_newParser(econf_parser **result, const char *delim, const char *comment,
+		const econf_parse_callbacks *callbacks, void *data)
+{
+  return new_parser(result, delim, comment, 0, callbacks, data);
+}
+
+econf_err
+econf_parserFeed(econf_parser *parser, const char *buf, size_t length)
+{
+  if (parser == NULL || (buf == NULL && length) || parser->finished)
+    return ECONF_ERROR;
+
+  while (length && !parser->error) {
+    const char *newline = memchr(buf, '\n', length);
+    size_t n = newline ? (size_t) (newline - buf) + 1 : length;
+
+    /* Keep space for the terminating 0 byte */
+    if (parser->buf_length + n >= parser->buf_alloc_length) {
+      size_t alloc_length = parser->buf_alloc_length ?
+	parser->buf_alloc_length * 2 : BUFSIZ;
+      while (alloc_length <= parser->buf_length + n)
+	alloc_length *= 2;
+      char *tmp = alloc_realloc(parser->buf, alloc_length);
+      if (tmp == NULL)
+	return parser->error = ECONF_NOMEM;
+      parser->buf = tmp;
+      parser->buf_alloc_length = alloc_length;
+    }
+    memcpy(parser->buf + parser->buf_length, buf, n);
+    parser->buf_length += n;
+    buf += n;
+    length -= n;
+
+    if (newline)
+      parser->error = parse_buffer(parser);
+  }
+
+  return parser->error;
+}
+
+econf_err
+econf_parserFinish(econf_parser *parser)
+{
+  if (parser == NULL)
+    return ECONF_ERROR;
+
+  /* The last line does not need to end with a newline */
+  if (!parser->finished && !parser->error && parser->buf_length)
+    parser->error = parse_buffer(parser);
+  parser->finished = true;
+
+  return parser->error;
+}
+
+void
+econf_freeParser(econf_parser *parser)
+{
+  if (parser == NULL)
+    return;
+  alloc_free(parser->delim);
+  alloc_free(parser->comment);
+  alloc_free(parser->current_group);
+  alloc_free(parser->current_comment_before_key);
+  alloc_free(parser->current_comment_after_value);
+  alloc_free(parser->buf);
+  alloc_free(parser);
+}
+
+/* Read the file in chunks and feed them to a parser. The number of
+   bytes and lines is stored in stats if it is not NULL.  */
+static econf_err
+parse_file(const char *file_name, const char *delim, const char *comment,
+	   unsigned int flags, const econf_parse_callbacks *callbacks,
+	   void *data, econf_file_stats *stats)
+{
+  char buf[BUFSIZ];
+  size_t n;
+  econf_parser *parser;
+  econf_err retval;
+
+  if (file_name == NULL)
+    return ECONF_ERROR;
+  if ((retval = new_parser(&parser, delim, comment, flags, callbacks, data)))
+    return retval;
+
+  uint64_t start = PROBE_TIME();
+  FILE *kf = fopen(file_name, "rbe");
+  if (kf == NULL) {
+    econf_freeParser(parser);
+    return ECONF_NOFILE;
+  }
+  PROBE1(file__open, file_name);
+
+  if (last_scanned_filename != NULL)
+    alloc_free(last_scanned_filename);
+  last_scanned_filename = alloc_strdup(file_name);
+  if (last_scanned_filename == NULL) {
+    fclose (kf);
+    econf_freeParser(parser);
+    return ECONF_NOMEM;
+  }
+
+  while ((n = fread(buf, 1, sizeof(buf), kf)) > 0) {
+    if (stats)
+      stats->bytes += n;
+    if ((retval = econf_parserFeed(parser, buf, n)))
+      break;
+  }
+  if (!retval)
+    retval = econf_parserFinish(parser);
+  if (stats)
+    stats->lines = parser->line;
+
   fclose (kf);
-  if (current_group)
-    free (current_group);
-  if (current_comment_before_key)
-    free(current_comment_before_key);
-  if (current_comment_after_value)
-    free(current_comment_after_value);
-
-  if(getenv("ECONF_JOIN_SAME_ENTRIES"))
+  PROBE4(file__close, file_name, parser->line, retval, PROBE_TIME() - start);
+  econf_freeParser(parser);
+  return retval;
+}
+
+econf_err
+econf_parseFile(const char *file_name, const char *delim, const char *comment,
+		const econf_parse_callbacks *callbacks, void *data)
+{
+  return parse_file(file_name, delim, comment, 0, callbacks, data, NULL);
+}
+
+/* Keep the content of the file for writing it again losslessly */
+static econf_err
+read_on_line(void *data, const char *line, size_t length,
+	     uint64_t line_number __attribute__((unused)))
+{
+  econf_file *ef = ((struct read_state *) data)->ef;
+
+  if (ef->source_length + length > ef->source_alloc_length) {
+    size_t alloc_length = ef->source_alloc_length ? ef->source_alloc_length * 2
+						   : BUFSIZ;
+    while (alloc_length < ef->source_length + length)
+      alloc_length *= 2;
+    char *tmp = alloc_realloc(ef->source, alloc_length);
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    ef->source = tmp;
+    ef->source_alloc_length = alloc_length;
+  }
+  memcpy(ef->source + ef->source_length, line, length);
+  ef->source_length += length;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+read_on_entry(void *data, const econf_parse_entry *entry)
+{
+  struct read_state *state = data;
+  econf_file *ef = state->ef;
+  econf_err error = store(state, entry->group, entry->key, entry->value,
+			  entry->line_number, entry->comment_before_key,
+			  entry->comment_after_value, entry->continuation);
+  if (error)
+    return error;
+
+  struct file_entry *fe = &ef->file_entry[ef->length-1];
+  if (entry->continuation) {
+    /* The value cannot be replaced in place anymore */
+    fe->value_start = fe->value_end = 0;
+  } else {
+    fe->span_start = entry->line_start;
+    fe->value_start = entry->value_start;
+    fe->value_end = entry->value_end;
+  }
+  fe->span_end = entry->line_end;
+  return ECONF_SUCCESS;
+}
+
+/* Fill the econf_file struct with the entries reported by the parser */
+econf_err
+read_file(econf_file *ef, const char *file,
+	  const char *delim, const char *comment,
+	  const econf_options *options)
+{
+  static const econf_parse_callbacks callbacks = {
+    .on_line = read_on_line,
+    .on_entry = read_on_entry,
+  };
+  /* Without comments the file cannot be written losslessly, so its
+     content is not kept.  */
+  static const econf_parse_callbacks callbacks_without_source = {
+    .on_entry = read_on_entry,
+  };
+  unsigned int flags = options_flags(options);
+  econf_file_stats fs = { .path = file };
+  uint64_t allocations = alloc_count();
+  uint64_t start = (flags & OPT_STATS) ? stats_now() : 0;
+
+  ef->path = alloc_strdup (file);
+  if (ef->path == NULL)
+    return ECONF_NOMEM;
+  ef->delimiter = *delim;
+
+  struct read_state state = { .ef = ef };
+  econf_err retval = source_table_add(ef, file, &state.source);
+  if (retval)
+    return retval;
+  retval = parse_file(file, delim, comment, flags,
+		      (flags & OPT_DISCARD_COMMENTS) ? &callbacks_without_source
+						     : &callbacks,
+		      &state, (flags & OPT_STATS) ? &fs : NULL);
+  if (flags & OPT_STATS)
+    fs.parse_ns = stats_now() - start;
+
+  if(flags & OPT_JOIN_SAME_ENTRIES)
   {
+    start = (flags & OPT_STATS) ? stats_now() : 0;
     join_same_entries(ef);
+    if (flags & OPT_STATS)
+      fs.join_ns = stats_now() - start;
+  }
+  if (!retval)
+    retval = index_build(ef);
+
+  if (!retval && (flags & OPT_STATS)) {
+    fs.entries = ef->length;
+    fs.allocations = alloc_count() - allocations;
+    retval = stats_add_file(ef, &fs);
   }
 
   return retval;
@@ -508,5 +844,5 @@ read_file(econf_file *ef, const char *file,
 void last_scanned_file(char **filename, uint64_t *line_nr)
 {
   *line_nr = last_scanned_line_nr;
-  *filename = last_scanned_filename ? strdup(last_scanned_filename) : NULL;
+  *filename = last_scanned_filename ? alloc_strdup(last_scanned_filename) : NULL;
 }
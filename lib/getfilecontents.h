@@ -26,8 +26,10 @@
 #include "libeconf.h"
 #include "keyfile.h"
 
-/* Fill the econf_file struct with values from the given file */
+/* Fill the econf_file struct with values from the given file. options
+   can be NULL for the default options.  */
 extern econf_err read_file(econf_file *read_file, const char *file,
-			   const char *delim, const char *comment);
+			   const char *delim, const char *comment,
+			   const econf_options *options);
 
 extern void last_scanned_file(char **filename, uint64_t *line_nr);
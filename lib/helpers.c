@@ -22,8 +22,12 @@
 */
 
 #include "libeconf.h"
+#include "alloc.h"
 #include "defines.h"
 #include "helpers.h"
+#include "keyindex.h"
+#include "lookups.h"
+#include "probes.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -35,18 +39,22 @@
 char *combine_strings(const char *string_one, const char *string_two,
                       const char delimiter) {
   size_t combined_len = strlen(string_one) + strlen(string_two) + 2;
-  char *combined = malloc(combined_len);
+  char *combined = alloc_malloc(combined_len);
   snprintf(combined, combined_len, "%s%c%s", string_one, delimiter, string_two);
   return combined;
 }
 
 // Set null value defined in include/defines.h
 void initialize(econf_file *key_file, size_t num) {
-  key_file->file_entry[num].group = strdup(KEY_FILE_NULL_VALUE);
-  key_file->file_entry[num].key = strdup(KEY_FILE_NULL_VALUE);
-  key_file->file_entry[num].value = strdup(KEY_FILE_NULL_VALUE);
+  key_file->file_entry[num].group = alloc_strdup(KEY_FILE_NULL_VALUE);
+  key_file->file_entry[num].key = alloc_strdup(KEY_FILE_NULL_VALUE);
+  key_file->file_entry[num].value = alloc_strdup(KEY_FILE_NULL_VALUE);
   key_file->file_entry[num].comment_before_key = NULL;
   key_file->file_entry[num].comment_after_value = NULL;
+  key_file->file_entry[num].deleted = false;
+  key_file->file_entry[num].lookups = 0;
+  key_file->file_entry[num].cache.type = VALUE_CACHE_NONE;
+  key_file->file_entry[num].cache.lines = NULL;
 }
 
 // Remove whitespace from beginning and end, append string terminator
@@ -80,9 +88,9 @@ char *get_absolute_path(const char *path, econf_err *error) {
 	*error = ECONF_NOFILE;
       return NULL;
     }
-    absolute_path = strdup(buffer);
+    absolute_path = alloc_strdup(buffer);
   } else {
-    absolute_path = strdup(path);
+    absolute_path = alloc_strdup(path);
   }
   if (absolute_path == NULL && error)
     *error = ECONF_NOMEM;
@@ -105,7 +113,7 @@ char *stripbrackets(char *string) {
 char *addbrackets(const char *string) {
   size_t length = strlen(string);
   if (!(*string == '[' && string[length - 1] == ']')) {
-    char *buffer = malloc(length + 3);
+    char *buffer = alloc_malloc(length + 3);
     if (buffer == NULL)
       return NULL;
     char *cp = buffer;
@@ -115,7 +123,7 @@ char *addbrackets(const char *string) {
     *cp = '\0';
     return buffer;
   }
-  return strdup(string);
+  return alloc_strdup(string);
 }
 
 // Turn the given string into lower case
@@ -139,53 +147,73 @@ size_t hashstring(const char *string) {
 }
 
 // Look for matching key
-econf_err find_key(econf_file key_file, const char *group, const char *key, size_t *num) {
-  char *grp = (!group || !*group) ? strdup(KEY_FILE_NULL_VALUE) :
-               addbrackets(group);
-  if (grp == NULL)
-    return  ECONF_NOMEM;
-  if (!key || !*key) {
-    free(grp);
+econf_err find_key(econf_file *key_file, const char *group, const char *key, size_t *num) {
+  if (!key || !*key)
     return ECONF_ERROR;
+  return index_find_key(key_file, group, key, num);
+}
+
+// Look for a key whose value is read by the caller. The lookup is counted
+// if the lookups of key_file are profiled. Only these lookups fire the
+// lookup probes, not the ones of the setters and of merging.
+econf_err lookup_key(econf_file *key_file, const char *group, const char *key,
+		     size_t *num) {
+  econf_err error = find_key(key_file, group, key, num);
+  if (error == ECONF_SUCCESS)
+    PROBE3(lookup__hit, group, key, *num);
+  else if (error == ECONF_NOKEY)
+    PROBE2(lookup__miss, group, key);
+  if (key_file->lookups) {
+    if (error == ECONF_SUCCESS)
+      atomic_fetch_add_explicit(&key_file->file_entry[*num].lookups, 1,
+				memory_order_relaxed);
+    else if (error == ECONF_NOKEY)
+      lookups_add_miss(key_file->lookups, group, key);
   }
-  for (size_t i = 0; i < key_file.length; i++) {
-    if (!strcmp(key_file.file_entry[i].group, grp) &&
-        !strcmp(key_file.file_entry[i].key, key)) {
-      free(grp);
-      *num = i;
-      return ECONF_SUCCESS;
-    }
-  }
-  // Key not found
-  free(grp);
-  return ECONF_NOKEY;
+  return error;
 }
 
-// Append a new key to an existing econf_file
-// TODO: If the group is already known the new key should be appended
-// at the end of that group not at the end of the file.
+// Append a new key to an existing econf_file. The entry is stored at the
+// end of the file. If its group already exists somewhere before, the file
+// is marked as unordered and key_file_normalize() moves the entry to the
+// end of its group before the entries are written or merged.
 static econf_err
 new_key (econf_file *key_file, const char *group, const char *key) {
   econf_err error;
-  char *grp = (!group || !*group) ? strdup(KEY_FILE_NULL_VALUE) :
+  char *grp = (!group || !*group) ? alloc_strdup(KEY_FILE_NULL_VALUE) :
                addbrackets(group);
   if (grp == NULL)
     return ECONF_NOMEM;
   if (key_file == NULL || key == NULL)
     {
-      free(grp);
+      alloc_free(grp);
       return ECONF_ERROR;
     }
   if ((error = key_file_append(key_file))) {
-    free(grp);
+    alloc_free(grp);
     return error;
   }
-  if ((error = setGroup(key_file, key_file->length - 1, grp))) {
-    free(grp);
+  size_t num = key_file->length - 1;
+  error = setGroup(key_file, num, grp);
+  alloc_free(grp);
+  if (error || (error = setKey(key_file, num, key)) ||
+      (error = index_add_entry(key_file, num))) {
+    /* The entry is not part of the index, remove it again */
+    struct file_entry *fe = &key_file->file_entry[num];
+    alloc_free(fe->group);
+    alloc_free(fe->key);
+    alloc_free(fe->value);
+    fe->group = fe->key = fe->value = NULL;
+    key_file->length--;
     return error;
   }
-  free(grp);
-  return setKey(key_file, key_file->length - 1, key);
+
+  struct group_index *gi;
+  if (key_file->index &&
+      index_find_group(key_file, group, &gi) == ECONF_SUCCESS &&
+      gi->length > 1 && gi->entries[gi->length - 2] != num - 1)
+    key_file->unordered = true;
+  return ECONF_SUCCESS;
 }
 
 // Set value for the given group, key combination. If the combination
@@ -196,8 +224,12 @@ econf_err setKeyValue(econf_err (*function) (econf_file*, size_t, const void*),
 		      econf_file *kf, const char *group, const char *key,
 		      const void *value)
 {
+  /* An attached configuration cannot be changed, see shared.h */
+  if (kf->shared)
+    return ECONF_ERROR;
+
   size_t num;
-  econf_err error = find_key(*kf, group, key, &num);
+  econf_err error = find_key(kf, group, key, &num);
   if (error) {
     if (error != ECONF_NOKEY) {
       return error;
@@ -212,20 +244,29 @@ econf_err setKeyValue(econf_err (*function) (econf_file*, size_t, const void*),
 
 struct file_entry cpy_file_entry(struct file_entry fe) {
   struct file_entry copied_fe;
-  copied_fe.group = strdup(fe.group);
-  copied_fe.key = strdup(fe.key);
+  copied_fe.group = alloc_strdup(fe.group);
+  copied_fe.key = alloc_strdup(fe.key);
   if (fe.value)
-    copied_fe.value = strdup(fe.value);
+    copied_fe.value = alloc_strdup(fe.value);
   else
     copied_fe.value = NULL;
   if (fe.comment_before_key)
-    copied_fe.comment_before_key = strdup(fe.comment_before_key);
+    copied_fe.comment_before_key = alloc_strdup(fe.comment_before_key);
   else
     copied_fe.comment_before_key = NULL;
   if (fe.comment_after_value)
-    copied_fe.comment_after_value = strdup(fe.comment_after_value);
+    copied_fe.comment_after_value = alloc_strdup(fe.comment_after_value);
   else
     copied_fe.comment_after_value = NULL;  
   copied_fe.line_number = fe.line_number;
+  copied_fe.source = fe.source;
+  copied_fe.deleted = false;
+  copied_fe.lookups = 0;
+  /* The copy does not belong to the source of fe */
+  copied_fe.span_start = copied_fe.span_end = 0;
+  copied_fe.value_start = copied_fe.value_end = 0;
+  copied_fe.modified = false;
+  copied_fe.cache.lines = NULL;
+  value_cache_copy(&copied_fe.cache, &fe.cache);
   return copied_fe;
 }
@@ -61,8 +61,13 @@ size_t hashstring(const char *str);
 
 /* Look for a matching key in the given econf_file.
    If the key is found num will point to the number of the array which contains
-   the key, if not it will point to -1.  */
-econf_err find_key(econf_file key_file, const char *group, const char *key, size_t *num);
+   the key. Returns ECONF_NOKEY if the key does not exist.  */
+econf_err find_key(econf_file *key_file, const char *group, const char *key, size_t *num);
+
+/* Same as find_key() for reading the value. The lookup is counted if the
+   lookups are profiled, see lookups.h.  */
+econf_err lookup_key(econf_file *key_file, const char *group, const char *key,
+		     size_t *num);
 
 /* Set value for the given group, key combination. If the combination
    does not exist it is created.  */
@@ -22,16 +22,20 @@
 */
 
 #include "libeconf.h"
+#include "alloc.h"
 #include "defines.h"
 #include "helpers.h"
 #include "keyfile.h"
+#include "keyindex.h"
 
 #include <errno.h>
 #include <float.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 
 void print_key_file(const econf_file key_file)
 {
@@ -41,6 +45,8 @@ void print_key_file(const econf_file key_file)
   printf("values:\n");
   for(size_t i = 0; i < key_file.length; i++)
   {
+    if (key_file.file_entry[i].deleted)
+      continue;
     printf("  group: %s ; key: %s ; value: %s\n",
 	   key_file.file_entry[i].group,
 	   key_file.file_entry[i].key,
@@ -50,53 +56,229 @@ void print_key_file(const econf_file key_file)
 }
 
 
+econf_err key_file_reserve(econf_file *kf, size_t length) {
+  if (length <= kf->alloc_length)
+    return ECONF_SUCCESS;
+
+  size_t alloc_length = kf->alloc_length * 2;
+  if (alloc_length < KEY_FILE_DEFAULT_LENGTH)
+    alloc_length = KEY_FILE_DEFAULT_LENGTH;
+  if (alloc_length < length)
+    alloc_length = length;
+
+  struct file_entry *tmp =
+    alloc_realloc(kf->file_entry, alloc_length * sizeof(struct file_entry));
+  if (tmp == NULL)
+    return ECONF_NOMEM;
+  memset(tmp + kf->alloc_length, 0,
+	 (alloc_length - kf->alloc_length) * sizeof(struct file_entry));
+  kf->file_entry = tmp;
+  kf->alloc_length = alloc_length;
+  return ECONF_SUCCESS;
+}
+
 econf_err key_file_append(econf_file *kf) {
-  /* XXX check return values and for NULL pointers */
-  if(kf->length++ >= kf->alloc_length) {
-    kf->alloc_length++;
-    kf->file_entry =
-      realloc(kf->file_entry, (kf->alloc_length) * sizeof(struct file_entry));
-    initialize(kf, kf->alloc_length - 1);
-  }
+  econf_err error = key_file_reserve(kf, kf->length + 1);
+  if (error)
+    return error;
+  initialize(kf, kf->length++);
   return ECONF_SUCCESS;
 }
 
-/* --- GETTERS --- */
+// Copy the entries which have not been deleted group by group into a new
+// array of alloc_length elements and index it.
+static econf_err key_file_repack(econf_file *kf, size_t alloc_length) {
+  struct econf_index *idx = kf->index;
+  econf_err error;
 
-/* XXX all get*ValueNum functions are missing error handling */
-econf_err getIntValueNum(econf_file key_file, size_t num, int32_t *result) {
-  *result = strtol(key_file.file_entry[num].value, NULL, 10);
+  if (idx == NULL)
+    return ECONF_ERROR;
+
+  struct file_entry *fe = alloc_calloc(alloc_length, sizeof(struct file_entry));
+  if (fe == NULL)
+    return ECONF_NOMEM;
+
+  /* Remember where the deleted entries have been in source */
+  if (kf->source && kf->deleted) {
+    struct source_span *spans =
+      alloc_realloc(kf->removed_spans, (kf->removed_spans_length + kf->deleted) *
+	      sizeof(struct source_span));
+    if (spans == NULL) {
+      alloc_free(fe);
+      return ECONF_NOMEM;
+    }
+    kf->removed_spans = spans;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < idx->groups_length; i++)
+    for (size_t j = 0; j < idx->groups[i].length; j++) {
+      struct file_entry *entry = &kf->file_entry[idx->groups[i].entries[j]];
+      if (!entry->deleted)
+	fe[n++] = *entry;
+    }
+
+  /* All entry numbers change. The new array is indexed first, so kf is
+     left unchanged if that fails.  */
+  struct file_entry *old_fe = kf->file_entry;
+  size_t old_length = kf->length, old_alloc_length = kf->alloc_length;
+  kf->file_entry = fe;
+  kf->length = n;
+  kf->alloc_length = alloc_length;
+  kf->index = NULL;
+  if ((error = index_build(kf))) {
+    kf->file_entry = old_fe;
+    kf->length = old_length;
+    kf->alloc_length = old_alloc_length;
+    kf->index = idx;
+    alloc_free(fe);
+    return error;
+  }
+
+  for (size_t i = 0; i < idx->groups_length; i++)
+    for (size_t j = 0; j < idx->groups[i].length; j++) {
+      struct file_entry *entry = &old_fe[idx->groups[i].entries[j]];
+      if (!entry->deleted)
+	continue;
+      if (kf->source && entry->span_end) {
+	kf->removed_spans[kf->removed_spans_length].start = entry->span_start;
+	kf->removed_spans[kf->removed_spans_length++].end = entry->span_end;
+      }
+      alloc_free(entry->group);
+      alloc_free(entry->key);
+    }
+  alloc_free(old_fe);
+  index_destroy(idx);
+  kf->unordered = false;
+  kf->deleted = 0;
   return ECONF_SUCCESS;
 }
 
-econf_err getInt64ValueNum(econf_file key_file, size_t num, int64_t *result) {
-  *result = strtoll(key_file.file_entry[num].value, NULL, 10);
-  return ECONF_SUCCESS;
+econf_err key_file_normalize(econf_file *kf) {
+  if (!kf->unordered && !kf->deleted)
+    return ECONF_SUCCESS;
+  return key_file_repack(kf, kf->alloc_length);
 }
 
-econf_err getUIntValueNum(econf_file key_file, size_t num, uint32_t *result) {
-  *result = strtoul(key_file.file_entry[num].value, NULL, 10);
-  return ECONF_SUCCESS;
+econf_err key_file_compact(econf_file *kf) {
+  size_t length = kf->length - kf->deleted;
+  if (length < KEY_FILE_DEFAULT_LENGTH)
+    length = KEY_FILE_DEFAULT_LENGTH;
+  if (!kf->unordered && !kf->deleted && length >= kf->alloc_length)
+    return ECONF_SUCCESS;
+  return key_file_repack(kf, length);
 }
 
-econf_err getUInt64ValueNum(econf_file key_file, size_t num, uint64_t *result) {
-  *result = strtoull(key_file.file_entry[num].value, NULL, 10);
-  return ECONF_SUCCESS;
+void value_cache_reset(struct value_cache *cache) {
+  cache->type = VALUE_CACHE_NONE;
+  alloc_free(cache->lines);
+  cache->lines = NULL;
 }
 
-econf_err getFloatValueNum(econf_file key_file, size_t num, float *result) {
-  *result = strtof(key_file.file_entry[num].value, NULL);
-  return ECONF_SUCCESS;
+void value_cache_copy(struct value_cache *to, const struct value_cache *from) {
+  enum value_cache_type type =
+    atomic_load_explicit(&from->type, memory_order_acquire);
+
+  value_cache_reset(to);
+  switch (type) {
+  case VALUE_CACHE_NONE:
+  case VALUE_CACHE_BUSY:
+    return;
+  case VALUE_CACHE_INT: to->i32 = from->i32; break;
+  case VALUE_CACHE_INT64: to->i64 = from->i64; break;
+  case VALUE_CACHE_UINT: to->u32 = from->u32; break;
+  case VALUE_CACHE_UINT64: to->u64 = from->u64; break;
+  case VALUE_CACHE_FLOAT: to->f = from->f; break;
+  case VALUE_CACHE_DOUBLE: to->d = from->d; break;
+  case VALUE_CACHE_BOOL: to->b = from->b; break;
+  }
+  to->type = type;
 }
 
-econf_err getDoubleValueNum(econf_file key_file, size_t num, double *result) {
-  *result = strtod(key_file.file_entry[num].value, NULL);
+econf_err key_file_delete(econf_file *kf, size_t num) {
+  struct file_entry *fe = &kf->file_entry[num];
+
+  /* An attached configuration cannot be changed, see shared.h */
+  if (kf->shared)
+    return ECONF_ERROR;
+
+  if (fe->deleted)
+    return ECONF_SUCCESS;
+
+  econf_err error = index_delete_entry(kf, num);
+  if (error)
+    return error;
+
+  alloc_free(fe->value);
+  alloc_free(fe->comment_before_key);
+  alloc_free(fe->comment_after_value);
+  fe->value = fe->comment_before_key = fe->comment_after_value = NULL;
+  value_cache_reset(&fe->cache);
+  fe->deleted = true;
+  kf->deleted++;
   return ECONF_SUCCESS;
 }
 
+/* --- GETTERS --- */
+
+/* Return true if the entry has a cached value of type. The value may be
+   read after a true return.  */
+static bool value_cache_get(struct file_entry *fe, enum value_cache_type type) {
+  return atomic_load_explicit(&fe->cache.type, memory_order_acquire) == type;
+}
+
+/* Try to claim the empty cache of the entry for storing a value. Only one
+   of several concurrent callers succeeds and has to call value_cache_put()
+   afterwards; the others just do not cache their result.  */
+static bool value_cache_claim(struct file_entry *fe) {
+  enum value_cache_type none = VALUE_CACHE_NONE;
+  return atomic_compare_exchange_strong_explicit(&fe->cache.type, &none,
+						 VALUE_CACHE_BUSY,
+						 memory_order_acquire,
+						 memory_order_relaxed);
+}
+
+/* Publish the value stored into the claimed cache.  */
+static void value_cache_put(struct file_entry *fe, enum value_cache_type type) {
+  atomic_store_explicit(&fe->cache.type, type, memory_order_release);
+}
+
+/* Convert the value with CONVERT on the first call and return the cached
+   value afterwards. The conversion is not cached if the entry has been
+   cached as a different type already.  */
+/* XXX all get*ValueNum functions are missing error handling */
+#define econf_getValueNum(FCT_TYPE, TYPE, CACHE_TYPE, MEMBER, CONVERT) \
+econf_err get ## FCT_TYPE ## ValueNum(econf_file key_file, size_t num, TYPE *result) { \
+  struct file_entry *fe = &key_file.file_entry[num]; \
+\
+  if (value_cache_get(fe, CACHE_TYPE)) { \
+    *result = fe->cache.MEMBER; \
+    return ECONF_SUCCESS; \
+  } \
+  *result = CONVERT; \
+  if (value_cache_claim(fe)) { \
+    fe->cache.MEMBER = *result; \
+    value_cache_put(fe, CACHE_TYPE); \
+  } \
+  return ECONF_SUCCESS; \
+}
+
+econf_getValueNum(Int, int32_t, VALUE_CACHE_INT, i32,
+		  strtol(fe->value, NULL, 10))
+econf_getValueNum(Int64, int64_t, VALUE_CACHE_INT64, i64,
+		  strtoll(fe->value, NULL, 10))
+econf_getValueNum(UInt, uint32_t, VALUE_CACHE_UINT, u32,
+		  strtoul(fe->value, NULL, 10))
+econf_getValueNum(UInt64, uint64_t, VALUE_CACHE_UINT64, u64,
+		  strtoull(fe->value, NULL, 10))
+econf_getValueNum(Float, float, VALUE_CACHE_FLOAT, f,
+		  strtof(fe->value, NULL))
+econf_getValueNum(Double, double, VALUE_CACHE_DOUBLE, d,
+		  strtod(fe->value, NULL))
+
 econf_err getStringValueNum(econf_file key_file, size_t num, char **result) {
   if (key_file.file_entry[num].value)
-    *result = strdup(key_file.file_entry[num].value);
+    *result = alloc_strdup(key_file.file_entry[num].value);
   else
     *result = NULL;
 
@@ -104,34 +286,38 @@ econf_err getStringValueNum(econf_file key_file, size_t num, char **result) {
 }
 
 econf_err getBoolValueNum(econf_file key_file, size_t num, bool *result) {
-  char *value, *tmp;
-  tmp = strdup(key_file.file_entry[num].value);
-  value = toLowerCase(tmp);
-  size_t hash = hashstring(toLowerCase(key_file.file_entry[num].value));
-  econf_err err = ECONF_SUCCESS;
+  struct file_entry *fe = &key_file.file_entry[num];
+  const char *value = fe->value;
 
-  if ((*value == '1' && strlen(tmp) == 1) || hash == YES || hash == TRUE)
+  if (value_cache_get(fe, VALUE_CACHE_BOOL)) {
+    *result = fe->cache.b;
+    return ECONF_SUCCESS;
+  }
+  if (!strcmp(value, "1") || !strcasecmp(value, YES) ||
+      !strcasecmp(value, TRUE))
     *result = true;
-  else if ((*value == '0' && strlen(tmp) == 1) || !*value ||
-	   hash == NO || hash == FALSE)
+  else if (!strcmp(value, "0") || !*value || !strcasecmp(value, NO) ||
+	   !strcasecmp(value, FALSE))
     *result = false;
   else
-    err = ECONF_PARSE_ERROR;
-
-  free(tmp);
-  return err;
+    return ECONF_PARSE_ERROR;
+  if (value_cache_claim(fe)) {
+    fe->cache.b = *result;
+    value_cache_put(fe, VALUE_CACHE_BOOL);
+  }
+  return ECONF_SUCCESS;
 }
 
 econf_err getCommentsNum(econf_file key_file, size_t num,
 			 char **comment_before_key,
 			 char **comment_after_value) {
   if (key_file.file_entry[num].comment_before_key)
-    *comment_before_key = strdup(key_file.file_entry[num].comment_before_key);
+    *comment_before_key = alloc_strdup(key_file.file_entry[num].comment_before_key);
   else
     *comment_before_key = NULL;
 
   if (key_file.file_entry[num].comment_after_value)
-    *comment_after_value = strdup(key_file.file_entry[num].comment_after_value);
+    *comment_after_value = alloc_strdup(key_file.file_entry[num].comment_after_value);
   else
     *comment_after_value = NULL;
 
@@ -145,10 +331,10 @@ econf_err getLineNrNum(econf_file key_file, size_t num, uint64_t *line_nr) {
 }
 
 econf_err getPath(econf_file key_file, char **path) {
-  /* Fixme: The path sould be set for each value. */
+  /* The file of every entry is kept in the source table, see sources.h */
   if (key_file.path)
   {
-    *path = strdup(key_file.path);
+    *path = alloc_strdup(key_file.path);
   } else {
     *path = NULL;
   }
@@ -162,8 +348,8 @@ econf_err setGroup(econf_file *key_file, size_t num, const char *value) {
   if (key_file == NULL || value == NULL)
     return ECONF_ERROR;
   if (key_file->file_entry[num].group)
-    free(key_file->file_entry[num].group);
-  key_file->file_entry[num].group = strdup(value);
+    alloc_free(key_file->file_entry[num].group);
+  key_file->file_entry[num].group = alloc_strdup(value);
   if (key_file->file_entry[num].group == NULL)
     return ECONF_NOMEM;
 
@@ -174,8 +360,8 @@ econf_err setKey(econf_file *key_file, size_t num, const char *value) {
   if (key_file == NULL || value == NULL)
     return ECONF_ERROR;
   if (key_file->file_entry[num].key)
-    free(key_file->file_entry[num].key);
-  key_file->file_entry[num].key = strdup(value);
+    alloc_free(key_file->file_entry[num].key);
+  key_file->file_entry[num].key = alloc_strdup(value);
   if (key_file->file_entry[num].key == NULL)
     return ECONF_NOMEM;
 
@@ -189,10 +375,10 @@ econf_err setComments(econf_file *key_file, size_t num,
     return ECONF_ERROR;
 
   if (key_file->file_entry[num].comment_before_key)
-    free(key_file->file_entry[num].comment_before_key);
+    alloc_free(key_file->file_entry[num].comment_before_key);
   if (comment_before_key)
   {
-    key_file->file_entry[num].comment_before_key = strdup(comment_before_key);
+    key_file->file_entry[num].comment_before_key = alloc_strdup(comment_before_key);
     if (key_file->file_entry[num].comment_before_key == NULL)
       return ECONF_NOMEM;
   } else {
@@ -200,10 +386,10 @@ econf_err setComments(econf_file *key_file, size_t num,
   }
 
   if (key_file->file_entry[num].comment_after_value)
-    free(key_file->file_entry[num].comment_after_value);
+    alloc_free(key_file->file_entry[num].comment_after_value);
   if (comment_after_value)
   {
-    key_file->file_entry[num].comment_after_value = strdup(comment_after_value);
+    key_file->file_entry[num].comment_after_value = alloc_strdup(comment_after_value);
     if (key_file->file_entry[num].comment_after_value == NULL)
       return ECONF_NOMEM;
   } else {
@@ -218,13 +404,15 @@ econf_err set ## FCT_TYPE ## ValueNum(econf_file *ef, size_t num, const void *v)
   const TYPE *value = (const TYPE*) v; \
   char *ptr; \
 \
-  if (asprintf (&ptr, FMT PR, *value) == -1) \
+  if (alloc_asprintf (&ptr, FMT PR, *value) == -1) \
     return ECONF_NOMEM; \
 \
   if (ef->file_entry[num].value) \
-    free(ef->file_entry[num].value); \
+    alloc_free(ef->file_entry[num].value); \
 \
   ef->file_entry[num].value = ptr; \
+  value_cache_reset(&ef->file_entry[num].cache); \
+  ef->file_entry[num].modified = true; \
 \
   return ECONF_SUCCESS; \
 }
@@ -242,36 +430,42 @@ econf_err setStringValueNum(econf_file *ef, size_t num, const void *v) {
   const char *value = (const char*) (v ? v : "");
   char *ptr;
 
-  if ((ptr = strdup (value)) == NULL)
+  if ((ptr = alloc_strdup (value)) == NULL)
     return ECONF_NOMEM;
 
   if (ef->file_entry[num].value)
-    free(ef->file_entry[num].value);
+    alloc_free(ef->file_entry[num].value);
 
   ef->file_entry[num].value = ptr;
+  value_cache_reset(&ef->file_entry[num].cache);
+  ef->file_entry[num].modified = true;
 
   return ECONF_SUCCESS;
 }
 
-/* XXX This needs to be optimised and error checking added */
 econf_err setBoolValueNum(econf_file *kf, size_t num, const void *v) {
   const char *value = (const char*) (v ? v : "");
-  econf_err error = ECONF_SUCCESS;
-  char *tmp = strdup(value);
-  size_t hash = hashstring(toLowerCase(tmp));
-
-  if ((*value == '1' && strlen(tmp) == 1) || hash == YES || hash == TRUE) {
-    free(kf->file_entry[num].value);
-    kf->file_entry[num].value = strdup("true");
-  } else if ((*value == '0' && strlen(tmp) == 1) || !*value ||
-             hash == NO || hash == FALSE) {
-    free(kf->file_entry[num].value);
-    kf->file_entry[num].value = strdup("false");
-  } else if (hash == KEY_FILE_NULL_VALUE_HASH) {
-    free(kf->file_entry[num].value);
-    kf->file_entry[num].value = strdup(KEY_FILE_NULL_VALUE);
-  } else { error = ECONF_ERROR; }
-
-  free(tmp);
-  return error;
+  const char *bool_value;
+  char *ptr;
+
+  if (!strcmp(value, "1") || !strcasecmp(value, YES) ||
+      !strcasecmp(value, TRUE))
+    bool_value = "true";
+  else if (!strcmp(value, "0") || !*value || !strcasecmp(value, NO) ||
+	   !strcasecmp(value, FALSE))
+    bool_value = "false";
+  else if (!strcasecmp(value, KEY_FILE_NULL_VALUE))
+    bool_value = KEY_FILE_NULL_VALUE;
+  else
+    return ECONF_ERROR;
+
+  if ((ptr = alloc_strdup(bool_value)) == NULL)
+    return ECONF_NOMEM;
+
+  alloc_free(kf->file_entry[num].value);
+  kf->file_entry[num].value = ptr;
+  value_cache_reset(&kf->file_entry[num].cache);
+  kf->file_entry[num].modified = true;
+
+  return ECONF_SUCCESS;
 }
@@ -25,16 +25,41 @@
 
 /* --- keyfile.h --- */
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include "libeconf_ext.h"
+
 /* This file contains the definition of the econf_file struct declared in
    libeconf.h as well as the functions to get and set a specified element
    of the struct. All functions return an error code != 0 on error defined
    in libeconf.h.  */
 
 
+/* Type of the value which has been cached by the first typed get*ValueNum
+   call on a file_entry. VALUE_CACHE_NONE means the value has to be parsed,
+   VALUE_CACHE_BUSY that another thread is storing its result.  */
+enum value_cache_type {
+  VALUE_CACHE_NONE = 0,
+  VALUE_CACHE_BUSY,
+  VALUE_CACHE_INT,
+  VALUE_CACHE_INT64,
+  VALUE_CACHE_UINT,
+  VALUE_CACHE_UINT64,
+  VALUE_CACHE_FLOAT,
+  VALUE_CACHE_DOUBLE,
+  VALUE_CACHE_BOOL
+};
+
+/* Lines of a value as returned by econf_getExtValueView(). The spans
+   point into the value of the file_entry.  */
+struct value_lines {
+  size_t length;
+  econf_span spans[];
+};
+
 /* Definition of the econf_file struct and its inner file_entry struct.  */
 typedef struct econf_file {
   /* The file_entry struct contains the group, key and value of every
@@ -44,6 +69,43 @@ typedef struct econf_file {
     char *group, *key, *value;
     char *comment_before_key, *comment_after_value;
     uint64_t line_number;
+    /* File the entry has been read from, see sources.h  */
+    size_t source;
+    /* Set by key_file_delete(). Deleted entries keep their group and key
+       until they are removed by key_file_normalize(); all other members
+       are freed.  */
+    bool deleted;
+    /* Number of lookups of the entry if the lookups are profiled, see
+       lookups.h. It fits into the padding after deleted.  */
+    _Atomic uint32_t lookups;
+    /* Byte offsets into econf_file.source. [span_start, span_end) contains
+       all lines of the entry including the trailing newline and
+       [value_start, value_end) the value without quotes. span_end is 0 if
+       the entry has not been read from source, value_start is 0 if the
+       value cannot be replaced in place (no value or multiline value).  */
+    size_t span_start, span_end, value_start, value_end;
+    /* Set by all functions which change value.  */
+    bool modified;
+    /* Parsed representation of value. Every function which changes value
+       has to reset the cache with value_cache_reset(). The getters may run
+       concurrently, so the cache is filled only once: the thread which
+       moves type from VALUE_CACHE_NONE to VALUE_CACHE_BUSY stores the
+       value and publishes it by setting type, see keyfile.c.  */
+    struct value_cache {
+      _Atomic enum value_cache_type type;
+      union {
+        int32_t i32;
+        int64_t i64;
+        uint32_t u32;
+        uint64_t u64;
+        float f;
+        double d;
+        bool b;
+      };
+      /* Lines of value, NULL if it has not been split yet. Set once with
+         a compare and exchange.  */
+      struct value_lines *_Atomic lines;
+    } cache;
   } * file_entry;
   /* length represents the current amount of key/value entries in econf_file and
      alloc_length the the amount of currently allocated file_entry elements
@@ -59,18 +121,73 @@ typedef struct econf_file {
   /* Binary variable to determine whether econf_file should be freed after
      being merged with another econf_file.  */
   bool on_merge_delete;
+  /* Set if keys have been appended to a group which is not the last one.
+     The entries are not stored group by group then, see
+     key_file_normalize().  */
+  bool unordered;
+  /* Number of entries which have been marked as deleted.  */
+  size_t deleted;
+  /* Content of the file which has been read. It is used to write the file
+     again without losing comments and formatting.  */
+  char *source;
+  size_t source_length, source_alloc_length;
+  /* Spans of entries read from source which have been removed from
+     file_entry after they had been deleted.  */
+  struct source_span {
+    size_t start, end;
+  } *removed_spans;
+  size_t removed_spans_length;
   char *path;
+  /* Paths of the files the entries have been read from, see sources.h  */
+  struct source_table *sources;
+  /* Lookup index of the entries, built when the file is created. See keyindex.h  */
+  struct econf_index *index;
+  /* Statistics if the file has been loaded with OPT_STATS, see stats.h  */
+  struct load_stats *stats;
+  /* Lookups of missing keys if the lookups are profiled, see lookups.h  */
+  struct lookup_profile *lookups;
+  /* Mapping of a configuration attached by econf_attach(). The strings
+     of the entries point into it, so they must not be freed or changed.
+     See shared.h  */
+  void *shared;
+  size_t shared_size;
 } econf_file;
 
-/* Increases both length and alloc_length of key_file by one and initializes
-   new elements of struct file_entry.  */
+/* Make sure that key_file can hold at least length entries. alloc_length
+   grows exponentially and new elements of struct file_entry are zeroed.  */
+econf_err key_file_reserve(econf_file *key_file, size_t length);
+
+/* Increases length of key_file by one and initializes the new element of
+   struct file_entry.  */
 econf_err key_file_append(econf_file *key_file);
 
+/* Reorder the entries of an unordered key_file, so that the entries of
+   every group are stored one after another, and remove deleted entries.
+   Groups keep the order of their first appearance and entries their
+   order within a group.  */
+econf_err key_file_normalize(econf_file *key_file);
+
+/* Same as key_file_normalize(), but also shrinks alloc_length to the
+   number of remaining entries.  */
+econf_err key_file_compact(econf_file *key_file);
+
+/* Invalidate the parsed representations of a value which has changed.  */
+void value_cache_reset(struct value_cache *cache);
+
+/* Copy the parsed value of from into to. The lines are not copied, they
+   point into the value of the entry from.  */
+void value_cache_copy(struct value_cache *to, const struct value_cache *from);
+
+/* Mark the file_entry element number num as deleted.  */
+econf_err key_file_delete(econf_file *key_file, size_t num);
+
 /* GETTERS */
 
 /* Functions used to get a set value from key_file depending on num.
    Expects a pointer of fitting type and writes the result into the pointer.
    num corresponds to the respective instance of the file_entry array.
+   The value converted by the first call is cached in the file_entry, so
+   repeated calls with the same type do not parse the value again.
    TODO: Error checking and defining return value on error needs to done.  */
 econf_err getIntValueNum(econf_file key_file, size_t num, int32_t *result);
 econf_err getInt64ValueNum(econf_file key_file, size_t num, int64_t *result);
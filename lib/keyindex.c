@@ -0,0 +1,469 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "defines.h"
+#include "keyindex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Initial size of the list of entries of a group */
+#define GROUP_MIN_ENTRIES 4
+
+/* Group name given by the caller. Brackets are added the same way
+   addbrackets() does it, but without allocating memory.  */
+struct group_name {
+  const char *name;
+  size_t length;
+  bool add_brackets;
+};
+
+static void
+group_name_init(struct group_name *gn, const char *group)
+{
+  if (!group || !*group) {
+    gn->name = KEY_FILE_NULL_VALUE;
+    gn->length = strlen(KEY_FILE_NULL_VALUE);
+    gn->add_brackets = false;
+    return;
+  }
+  gn->name = group;
+  gn->length = strlen(group);
+  gn->add_brackets = !(group[0] == '[' && group[gn->length - 1] == ']');
+}
+
+/* Group names stored in a file_entry are already normalized.  */
+static void
+group_name_stored(struct group_name *gn, const char *group)
+{
+  gn->name = group;
+  gn->length = strlen(group);
+  gn->add_brackets = false;
+}
+
+// Hash function djb2 from Dan J. Bernstein, see hashstring()
+static size_t
+hash_bytes(size_t hash, const char *string, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+    hash = ((hash << 5) + hash) + (unsigned char) string[i];
+  return hash;
+}
+
+static size_t
+hash_group(const struct group_name *gn)
+{
+  size_t hash = 5381;
+  if (gn->add_brackets)
+    hash = hash_bytes(hash, "[", 1);
+  hash = hash_bytes(hash, gn->name, gn->length);
+  if (gn->add_brackets)
+    hash = hash_bytes(hash, "]", 1);
+  return hash;
+}
+
+static size_t
+hash_key(const struct group_name *gn, const char *key)
+{
+  /* The group and key are separated by a 0 byte. */
+  return hash_bytes(hash_group(gn), key, strlen(key) + 1);
+}
+
+size_t index_hash(const char *group, const char *key) {
+  struct group_name gn;
+  group_name_init(&gn, group);
+  return hash_key(&gn, key);
+}
+
+static bool
+group_equal(const char *stored, const struct group_name *gn)
+{
+  if (!gn->add_brackets)
+    return strcmp(stored, gn->name) == 0;
+  return stored[0] == '[' && strncmp(stored + 1, gn->name, gn->length) == 0 &&
+    stored[gn->length + 1] == ']' && stored[gn->length + 2] == '\0';
+}
+
+static size_t *
+table_alloc(size_t size)
+{
+  return alloc_calloc(size, sizeof(size_t));
+}
+
+static econf_err
+group_table_resize(struct econf_index *idx, size_t size)
+{
+  size_t *table = table_alloc(size);
+  if (table == NULL)
+    return ECONF_NOMEM;
+
+  for (size_t i = 0; i < idx->groups_length; i++) {
+    struct group_name gn;
+    group_name_stored(&gn, idx->groups[i].name);
+    size_t slot = hash_group(&gn) & (size - 1);
+    while (table[slot])
+      slot = (slot + 1) & (size - 1);
+    table[slot] = i + 1;
+  }
+  alloc_free(idx->group_table);
+  idx->group_table = table;
+  idx->group_table_size = size;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+key_table_resize(econf_file *kf, size_t size)
+{
+  struct econf_index *idx = kf->index;
+  size_t *table = table_alloc(size);
+  if (table == NULL)
+    return ECONF_NOMEM;
+
+  for (size_t i = 0; i < idx->key_table_size; i++) {
+    if (!idx->key_table[i])
+      continue;
+    struct file_entry *fe = &kf->file_entry[idx->key_table[i] - 1];
+    struct group_name gn;
+    group_name_stored(&gn, fe->group);
+    size_t slot = hash_key(&gn, fe->key) & (size - 1);
+    while (table[slot])
+      slot = (slot + 1) & (size - 1);
+    table[slot] = idx->key_table[i];
+  }
+  alloc_free(idx->key_table);
+  idx->key_table = table;
+  idx->key_table_size = size;
+  return ECONF_SUCCESS;
+}
+
+// Return the slot of the group in the group table. If the group does not
+// exist the slot points to the empty element where it has to be inserted.
+static size_t
+group_slot(const struct econf_index *idx, const struct group_name *gn)
+{
+  size_t mask = idx->group_table_size - 1;
+  size_t slot = hash_group(gn) & mask;
+  while (idx->group_table[slot] &&
+	 !group_equal(idx->groups[idx->group_table[slot] - 1].name, gn))
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+// Same as group_slot() for the key table
+static size_t
+key_slot(const econf_file *kf, const struct group_name *gn, const char *key)
+{
+  const struct econf_index *idx = kf->index;
+  size_t mask = idx->key_table_size - 1;
+  size_t slot = hash_key(gn, key) & mask;
+  while (idx->key_table[slot]) {
+    const struct file_entry *fe = &kf->file_entry[idx->key_table[slot] - 1];
+    if (group_equal(fe->group, gn) && !strcmp(fe->key, key))
+      break;
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/* Make room for a new group which has not been found at *slot. *slot is
+   updated if the group table is resized.  */
+static econf_err
+group_reserve(struct econf_index *idx, const struct group_name *gn,
+	      size_t *slot)
+{
+  if (idx->groups_length == idx->groups_alloc_length) {
+    size_t alloc_length = idx->groups_alloc_length * 2;
+    struct group_index *tmp =
+      alloc_realloc(idx->groups, alloc_length * sizeof(struct group_index));
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    idx->groups = tmp;
+    idx->groups_alloc_length = alloc_length;
+  }
+  if ((idx->groups_length + 1) * 2 > idx->group_table_size) {
+    if (group_table_resize(idx, idx->group_table_size * 2))
+      return ECONF_NOMEM;
+    *slot = group_slot(idx, gn);
+  }
+  return ECONF_SUCCESS;
+}
+
+/* Add a group without entries after group_reserve().  */
+static struct group_index *
+group_create(struct econf_index *idx, const char *name, size_t slot)
+{
+  struct group_index *gi = &idx->groups[idx->groups_length++];
+  gi->name = name;
+  gi->entries = NULL;
+  gi->length = gi->alloc_length = 0;
+  gi->deleted = 0;
+  idx->group_table[slot] = idx->groups_length;
+  return gi;
+}
+
+econf_err index_add_entry(econf_file *kf, size_t num) {
+  struct econf_index *idx = kf->index;
+  struct file_entry *fe = &kf->file_entry[num];
+  struct group_name gn;
+
+  if (idx == NULL)
+    return ECONF_SUCCESS;
+
+  /* Reserve everything the entry needs before the index is changed, so
+     it stays valid if an allocation fails.  */
+  if (!fe->deleted && (idx->key_count + 1) * 2 > idx->key_table_size &&
+      key_table_resize(kf, idx->key_table_size * 2))
+    return ECONF_NOMEM;
+
+  group_name_stored(&gn, fe->group);
+  size_t slot = group_slot(idx, &gn);
+  size_t *entries = NULL;
+  if (!idx->group_table[slot]) {
+    if (group_reserve(idx, &gn, &slot))
+      return ECONF_NOMEM;
+    entries = alloc_malloc(GROUP_MIN_ENTRIES * sizeof(size_t));
+    if (entries == NULL)
+      return ECONF_NOMEM;
+  } else {
+    struct group_index *gi = &idx->groups[idx->group_table[slot] - 1];
+    if (gi->length == gi->alloc_length) {
+      size_t alloc_length = gi->alloc_length * 2;
+      size_t *tmp = alloc_realloc(gi->entries, alloc_length * sizeof(size_t));
+      if (tmp == NULL)
+	return ECONF_NOMEM;
+      gi->entries = tmp;
+      gi->alloc_length = alloc_length;
+    }
+  }
+
+  /* Find or create the group */
+  struct group_index *gi;
+  if (entries == NULL) {
+    gi = &idx->groups[idx->group_table[slot] - 1];
+  } else {
+    gi = group_create(idx, fe->group, slot);
+    gi->entries = entries;
+    gi->alloc_length = GROUP_MIN_ENTRIES;
+  }
+
+  gi->entries[gi->length++] = num;
+  if (fe->deleted) {
+    gi->deleted++;
+    return ECONF_SUCCESS;
+  }
+
+  /* Only the first entry of a group/key combination is found by lookups.
+     A deleted entry is replaced by the new one.  */
+  slot = key_slot(kf, &gn, fe->key);
+  if (!idx->key_table[slot])
+    idx->key_count++;
+  if (!idx->key_table[slot] ||
+      kf->file_entry[idx->key_table[slot] - 1].deleted)
+    idx->key_table[slot] = num + 1;
+
+  return ECONF_SUCCESS;
+}
+
+econf_err index_delete_entry(econf_file *kf, size_t num) {
+  struct econf_index *idx = kf->index;
+  struct group_name gn;
+
+  if (idx == NULL)
+    return ECONF_SUCCESS;
+
+  group_name_stored(&gn, kf->file_entry[num].group);
+  size_t slot = group_slot(idx, &gn);
+  if (!idx->group_table[slot])
+    return ECONF_ERROR;
+  idx->groups[idx->group_table[slot] - 1].deleted++;
+  return ECONF_SUCCESS;
+}
+
+econf_err index_build(econf_file *kf) {
+  econf_err error;
+
+  if (kf->index)
+    return ECONF_SUCCESS;
+
+  struct econf_index *idx = alloc_calloc(1, sizeof(struct econf_index));
+  if (idx == NULL)
+    return ECONF_NOMEM;
+  kf->index = idx;
+
+  size_t size = 16;
+  while (size < kf->length * 2)
+    size *= 2;
+  idx->groups_alloc_length = 8;
+  idx->groups = alloc_malloc(idx->groups_alloc_length * sizeof(struct group_index));
+  idx->group_table_size = 16;
+  idx->group_table = table_alloc(idx->group_table_size);
+  idx->key_table_size = size;
+  idx->key_table = table_alloc(size);
+  if (idx->groups == NULL || idx->group_table == NULL || idx->key_table == NULL) {
+    index_free(kf);
+    return ECONF_NOMEM;
+  }
+
+  /* Create the groups and allocate their lists of entries with the final
+     size first, so they do not grow entry by entry.  */
+  for (size_t i = 0; i < kf->length; i++) {
+    struct group_name gn;
+    group_name_stored(&gn, kf->file_entry[i].group);
+    size_t slot = group_slot(idx, &gn);
+    struct group_index *gi;
+    if (idx->group_table[slot]) {
+      gi = &idx->groups[idx->group_table[slot] - 1];
+    } else {
+      if (group_reserve(idx, &gn, &slot))
+	goto nomem;
+      gi = group_create(idx, kf->file_entry[i].group, slot);
+    }
+    gi->alloc_length++;
+  }
+  for (size_t i = 0; i < idx->groups_length; i++) {
+    struct group_index *gi = &idx->groups[i];
+    if (gi->alloc_length < GROUP_MIN_ENTRIES)
+      gi->alloc_length = GROUP_MIN_ENTRIES;
+    gi->entries = alloc_malloc(gi->alloc_length * sizeof(size_t));
+    if (gi->entries == NULL)
+      goto nomem;
+  }
+
+  for (size_t i = 0; i < kf->length; i++) {
+    if ((error = index_add_entry(kf, i))) {
+      index_free(kf);
+      return error;
+    }
+  }
+  return ECONF_SUCCESS;
+
+ nomem:
+  index_free(kf);
+  return ECONF_NOMEM;
+}
+
+void index_destroy(struct econf_index *idx) {
+  if (idx == NULL)
+    return;
+
+  if (idx->groups) {
+    for (size_t i = 0; i < idx->groups_length; i++)
+      alloc_free(idx->groups[i].entries);
+    alloc_free(idx->groups);
+  }
+  alloc_free(idx->group_table);
+  alloc_free(idx->key_table);
+  alloc_free(idx);
+}
+
+void index_free(econf_file *kf) {
+  index_destroy(kf->index);
+  kf->index = NULL;
+}
+
+size_t index_memory_usage(const econf_file *kf) {
+  const struct econf_index *idx = kf->index;
+
+  if (idx == NULL)
+    return 0;
+
+  size_t size = sizeof(struct econf_index) +
+    idx->groups_alloc_length * sizeof(struct group_index) +
+    (idx->group_table_size + idx->key_table_size) * sizeof(size_t);
+  for (size_t i = 0; i < idx->groups_length; i++)
+    size += idx->groups[i].alloc_length * sizeof(size_t);
+  return size;
+}
+
+econf_err index_find_group(econf_file *kf, const char *group,
+			   struct group_index **result) {
+  struct group_name gn;
+
+  if (kf->index == NULL)
+    return ECONF_ERROR;
+
+  group_name_init(&gn, group);
+  size_t slot = group_slot(kf->index, &gn);
+  if (!kf->index->group_table[slot])
+    return ECONF_NOGROUP;
+  struct group_index *gi = &kf->index->groups[kf->index->group_table[slot] - 1];
+  if (gi->deleted == gi->length)
+    return ECONF_NOGROUP;
+  *result = gi;
+  return ECONF_SUCCESS;
+}
+
+econf_err index_find_key(econf_file *kf, const char *group,
+			 const char *key, size_t *num) {
+  struct group_name gn;
+
+  if (kf->index == NULL)
+    return ECONF_ERROR;
+
+  group_name_init(&gn, group);
+  size_t slot = key_slot(kf, &gn, key);
+  if (!kf->index->key_table[slot] ||
+      kf->file_entry[kf->index->key_table[slot] - 1].deleted)
+    return ECONF_NOKEY;
+  *num = kf->index->key_table[slot] - 1;
+  return ECONF_SUCCESS;
+}
+
+econf_err index_next_entry(const econf_file *kf, size_t cursor, size_t *num) {
+  const struct econf_index *idx = kf->index;
+  size_t group = 0, pos = 0;
+
+  if (idx == NULL)
+    return ECONF_ERROR;
+  if (cursor > kf->length)
+    return ECONF_NOKEY;
+
+  if (cursor) {
+    struct group_name gn;
+    group_name_stored(&gn, kf->file_entry[cursor - 1].group);
+    size_t slot = group_slot(idx, &gn);
+    if (!idx->group_table[slot])
+      return ECONF_ERROR;
+    group = idx->group_table[slot] - 1;
+    /* The entries of a group are sorted by number. Find the first one
+       after the entry cursor - 1.  */
+    const struct group_index *gi = &idx->groups[group];
+    size_t high = gi->length;
+    while (pos < high) {
+      size_t middle = pos + (high - pos) / 2;
+      if (gi->entries[middle] < cursor)
+	pos = middle + 1;
+      else
+	high = middle;
+    }
+  }
+
+  for (; group < idx->groups_length; group++, pos = 0) {
+    if (pos < idx->groups[group].length) {
+      *num = idx->groups[group].entries[pos];
+      return ECONF_SUCCESS;
+    }
+  }
+  return ECONF_NOKEY;
+}
@@ -0,0 +1,103 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- keyindex.h --- */
+
+#include "libeconf.h"
+#include "keyfile.h"
+
+/* This file contains the index of an econf_file which is used to look up
+   groups and keys without scanning all entries. The index is built when
+   an econf_file is created, read, merged or attached and is kept up to
+   date by index_add_entry() and index_delete_entry(). Every other
+   function which changes the group or key of an entry or reorders the
+   file_entry array has to build it again. Lookups never change the
+   index, so they can run concurrently.  */
+
+/* All entries of one group in the order they have been added, including
+   the deleted ones.  */
+struct group_index {
+  /* Borrowed from the group of the first entry of this group.  */
+  const char *name;
+  size_t *entries;
+  size_t length, alloc_length;
+  /* Number of deleted entries. The group does not exist anymore if all
+     of its entries have been deleted.  */
+  size_t deleted;
+};
+
+struct econf_index {
+  /* Groups in the order of their first appearance.  */
+  struct group_index *groups;
+  size_t groups_length, groups_alloc_length;
+  /* Open addressing hash tables. group_table contains the group number + 1,
+     key_table the entry number + 1 of the first entry of a group/key
+     combination. 0 marks an empty slot. The sizes are powers of two.  */
+  size_t *group_table, group_table_size;
+  size_t *key_table, key_table_size, key_count;
+};
+
+/* Build the index of key_file if it does not exist yet.  */
+econf_err index_build(econf_file *key_file);
+
+/* Free an index which is not used by an econf_file anymore.  */
+void index_destroy(struct econf_index *index);
+
+/* Free the index of key_file.  */
+void index_free(econf_file *key_file);
+
+/* Hash of a group/key combination as it is used by the index. group is
+   given like for index_find_key().  */
+size_t index_hash(const char *group, const char *key);
+
+/* Allocated bytes of the index of key_file, 0 if it has not been built.  */
+size_t index_memory_usage(const econf_file *key_file);
+
+/* Add the entry num which has been appended to key_file to the index.
+   Does nothing if there is no index. If memory allocation fails the
+   index is left unchanged and the caller has to remove the entry.  */
+econf_err index_add_entry(econf_file *key_file, size_t num);
+
+/* Update the index after the entry num has been marked as deleted.  */
+econf_err index_delete_entry(econf_file *key_file, size_t num);
+
+/* Look up a group. group can be given with or without brackets, NULL or an
+   empty string select the entries without group. Returns ECONF_NOGROUP if
+   there is no such group or all of its entries have been deleted and
+   ECONF_ERROR if key_file has no index.  */
+econf_err index_find_group(econf_file *key_file, const char *group,
+			   struct group_index **result);
+
+/* Look up the first entry with the given group and key. Returns
+   ECONF_NOKEY if there is no such entry or it has been deleted and
+   ECONF_ERROR if key_file has no index.  */
+econf_err index_find_key(econf_file *key_file, const char *group,
+			 const char *key, size_t *num);
+
+/* Return the entry which follows the entry cursor - 1 group by group, in
+   the order of econf_getGroups(). cursor 0 returns the first entry.
+   Deleted entries are returned as well. Returns ECONF_NOKEY after the
+   last entry.  */
+econf_err index_next_entry(const econf_file *key_file, size_t cursor,
+			   size_t *num);
@@ -22,14 +22,22 @@
 */
 
 #include "libeconf.h"
+#include "alloc.h"
 
 #include "defines.h"
 #include "getfilecontents.h"
 #include "helpers.h"
 #include "keyfile.h"
+#include "keyindex.h"
+#include "lookups.h"
+#include "sources.h"
+#include "stats.h"
 #include "mergefiles.h"
+#include "shared.h"
+#include "options.h"
+#include "probes.h"
+#include "writefile.h"
 
-#include <dirent.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -38,7 +46,7 @@
 econf_err
 econf_newKeyFile(econf_file **result, char delimiter, char comment)
 {
-  econf_file *key_file = calloc(1, sizeof(econf_file));
+  econf_file *key_file = alloc_calloc(1, sizeof(econf_file));
 
   if (key_file == NULL)
     return ECONF_NOMEM;
@@ -48,16 +56,15 @@ econf_newKeyFile(econf_file **result, char delimiter, char comment)
   key_file->delimiter = delimiter;
   key_file->comment = comment;
 
-  key_file->file_entry = malloc(KEY_FILE_DEFAULT_LENGTH * sizeof(struct file_entry));
-  if (key_file->file_entry == NULL)
+  /* Unused elements are zeroed. They are initialized by key_file_append() */
+  key_file->file_entry = alloc_calloc(KEY_FILE_DEFAULT_LENGTH, sizeof(struct file_entry));
+  if (key_file->file_entry == NULL || index_build(key_file))
     {
-      free (key_file);
+      alloc_free (key_file->file_entry);
+      alloc_free (key_file);
       return ECONF_NOMEM;
     }
 
-  for (size_t i = 0; i < KEY_FILE_DEFAULT_LENGTH; i++)
-    initialize(key_file, i);
-
   *result = key_file;
 
   return ECONF_SUCCESS;
@@ -70,6 +77,14 @@ econf_err econf_newIniFile(econf_file **result) {
 // Process the file of the given file_name and save its contents into key_file
 econf_err econf_readFile(econf_file **key_file, const char *file_name,
 			     const char *delim, const char *comment)
+{
+  return econf_readFileWithOptions(key_file, file_name, delim, comment, NULL);
+}
+
+econf_err econf_readFileWithOptions(econf_file **key_file,
+				    const char *file_name,
+				    const char *delim, const char *comment,
+				    const econf_options *options)
 {
   econf_err t_err;
 
@@ -81,9 +96,9 @@ econf_err econf_readFile(econf_file **key_file, const char *file_name,
   if (absolute_path == NULL)
     return t_err;
 
-  *key_file = calloc(1, sizeof(econf_file));
+  *key_file = alloc_calloc(1, sizeof(econf_file));
   if (*key_file == NULL) {
-    free (absolute_path);
+    alloc_free (absolute_path);
     return ECONF_NOMEM;
   }
 
@@ -94,9 +109,11 @@ econf_err econf_readFile(econf_file **key_file, const char *file_name,
     comment = "#";
   }
 
-  t_err = read_file(*key_file, absolute_path, delim, comment);
-  
-  free (absolute_path);
+  t_err = read_file(*key_file, absolute_path, delim, comment, options);
+  if (!t_err && (options_flags(options) & OPT_PROFILE_LOOKUPS))
+    t_err = lookups_enable(*key_file);
+
+  alloc_free (absolute_path);
 
   if(t_err) {
     econf_free(*key_file);
@@ -108,23 +125,30 @@ econf_err econf_readFile(econf_file **key_file, const char *file_name,
 }
 
 // Merge the contents of two key files
-econf_err econf_mergeFiles(econf_file **merged_file, econf_file *usr_file, econf_file *etc_file)
+static econf_err
+merge_files(econf_file **merged_file, econf_file *usr_file, econf_file *etc_file)
 {
-  if (merged_file == NULL || usr_file == NULL || etc_file == NULL)
-    return ECONF_ERROR;
+  econf_err error;
+  if ((error = key_file_normalize(usr_file)) ||
+      (error = key_file_normalize(etc_file)))
+    return error;
 
-  *merged_file = calloc(1, sizeof(econf_file));
+  if ((error = source_table_share(usr_file, etc_file)))
+    return error;
+
+  *merged_file = alloc_calloc(1, sizeof(econf_file));
   if (*merged_file == NULL)
     return ECONF_NOMEM;
 
   (*merged_file)->delimiter = usr_file->delimiter;
   (*merged_file)->comment = usr_file->comment;
   (*merged_file)->path = NULL;
+  (*merged_file)->sources = source_table_ref(usr_file->sources);
   struct file_entry *fe =
-      malloc((etc_file->length + usr_file->length) * sizeof(struct file_entry));
+      alloc_malloc((etc_file->length + usr_file->length) * sizeof(struct file_entry));
   if (fe == NULL)
     {
-      free (*merged_file);
+      alloc_free (*merged_file);
       *merged_file = NULL;
       return ECONF_NOMEM;
     }
@@ -143,18 +167,38 @@ econf_err econf_mergeFiles(econf_file **merged_file, econf_file *usr_file, econf
   (*merged_file)->alloc_length = merge_length;
 
   (*merged_file)->file_entry = fe;
+  if ((error = index_build(*merged_file))) {
+    econf_freeFile(*merged_file);
+    *merged_file = NULL;
+    return error;
+  }
   return ECONF_SUCCESS;
 }
 
+econf_err econf_mergeFiles(econf_file **merged_file, econf_file *usr_file, econf_file *etc_file)
+{
+  if (merged_file == NULL || usr_file == NULL || etc_file == NULL)
+    return ECONF_ERROR;
 
-econf_err econf_readDirsHistory(econf_file ***key_files,
-				size_t *size,
-				const char *dist_conf_dir,
-				const char *etc_conf_dir,
-				const char *project_name,
-				const char *config_suffix,
-				const char *delim,
-				const char *comment)
+  uint64_t start = PROBE_TIME();
+  PROBE2(merge__start, usr_file->path, etc_file->path);
+  econf_err error = merge_files(merged_file, usr_file, etc_file);
+  PROBE3(merge__end, error ? 0 : (*merged_file)->length, error,
+	 PROBE_TIME() - start);
+  return error;
+}
+
+
+// Evaluate the files like econf_readDirsHistory, reading them with options
+static econf_err read_dirs_history(econf_file ***key_files,
+				   size_t *size,
+				   const char *dist_conf_dir,
+				   const char *etc_conf_dir,
+				   const char *project_name,
+				   const char *config_suffix,
+				   const char *delim,
+				   const char *comment,
+				   const econf_options *options)
 {
   const char *suffix, *default_dirs[3] = {NULL, NULL, NULL};
   char *distfile, *etcfile, *cp;
@@ -211,7 +255,8 @@ econf_err econf_readDirsHistory(econf_file ***key_files,
 
   if (etcfile)
     {
-      error = econf_readFile(&key_file, etcfile, delim, comment);
+      error = econf_readFileWithOptions(&key_file, etcfile, delim, comment,
+					options);
       if (error && error != ECONF_NOFILE)
 	return error;
     }
@@ -225,7 +270,8 @@ econf_err econf_readDirsHistory(econf_file ***key_files,
        and merge all *.d files. */
     if (distfile)
       {
-	error = econf_readFile(&key_file, distfile, delim, comment);
+	error = econf_readFileWithOptions(&key_file, distfile, delim, comment,
+					  options);
 	if (error && error != ECONF_NOFILE)
 	  return error;
       }
@@ -242,7 +288,7 @@ econf_err econf_readDirsHistory(econf_file ***key_files,
 
   /* create space to store the econf_files for merging */
   *size = *size+1;
-  *key_files = calloc(*size, sizeof(econf_file*));
+  *key_files = alloc_calloc(*size, sizeof(econf_file*));
   if (*key_files == NULL) {
     econf_freeFile(key_file);
     return ECONF_NOMEM;
@@ -253,40 +299,45 @@ econf_err econf_readDirsHistory(econf_file ***key_files,
     (*key_files)[0] = key_file;
   }
 
-  int i = 0;
-  while (default_dirs[i]) {
-    /*
-      Indicate which directories to look for. The order is:
-       "default_dirs/project_name.suffix.d/"
-
-       XXX make this configureable:
-       "default_dirs/project_name/conf.d/"
-       "default_dirs/project_name.d/"
-       "default_dirs/project_name/"
-    */
-    const char *conf_dirs[] = {  NULL, /* "/conf.d/", ".d/", "/", */ NULL};
-    char *project_path = combine_strings(default_dirs[i], project_name, '/');
-    char *suffix_d = malloc (strlen(suffix) + 4); /* + strlen(".d/") */
-    if (suffix_d == NULL)
-      return ECONF_NOMEM;
-    cp = stpcpy(suffix_d, suffix);
+  /*
+    Indicate which directories to look for. The order is:
+     "default_dirs/project_name.suffix.d/"
+
+     XXX make this configureable:
+     "default_dirs/project_name/conf.d/"
+     "default_dirs/project_name.d/"
+     "default_dirs/project_name/"
+  */
+  char *drop_in_dirs[2];
+  size_t drop_in_length = 0;
+  error = ECONF_SUCCESS;
+  for (int i = 0; default_dirs[i]; i++) {
+    char *dir = alloc_malloc(strlen(default_dirs[i]) + strlen(project_name) +
+			     strlen(suffix) + 4); /* + "/" + ".d" */
+    if (dir == NULL) {
+      error = ECONF_NOMEM;
+      break;
+    }
+    cp = stpcpy(dir, default_dirs[i]);
+    *cp++ = '/';
+    cp = stpcpy(cp, project_name);
+    cp = stpcpy(cp, suffix);
     stpcpy(cp, ".d");
-    conf_dirs[0] = suffix_d;
-
-    error = traverse_conf_dirs(key_files, conf_dirs, size, project_path,
-			       suffix, delim, comment);
-    free(suffix_d);
-    free(project_path);
-    if (error != ECONF_SUCCESS)
+    drop_in_dirs[drop_in_length++] = dir;
+  }
+  if (!error)
+    error = read_drop_in_dirs(key_files, size, drop_in_dirs, drop_in_length,
+			      suffix, delim, comment, options);
+  for (size_t i = 0; i < drop_in_length; i++)
+    alloc_free(drop_in_dirs[i]);
+  if (error != ECONF_SUCCESS)
+  {
+    for(size_t k = 0; k < *size-1; k++)
     {
-      for(size_t k = 0; k < *size-1; k++)
-      {
-	econf_freeFile((*key_files)[k]);
-      }
-      free(*key_files);
-      return error;
+      econf_freeFile((*key_files)[k]);
     }
-    i++;
+    alloc_free(*key_files);
+    return error;
   }
   (*size)--;
   (*key_files)[*size] = NULL;
@@ -297,6 +348,19 @@ econf_err econf_readDirsHistory(econf_file ***key_files,
     return ECONF_SUCCESS;
 }
 
+econf_err econf_readDirsHistory(econf_file ***key_files,
+				size_t *size,
+				const char *dist_conf_dir,
+				const char *etc_conf_dir,
+				const char *project_name,
+				const char *config_suffix,
+				const char *delim,
+				const char *comment)
+{
+  return read_dirs_history(key_files, size, dist_conf_dir, etc_conf_dir,
+			   project_name, config_suffix, delim, comment, NULL);
+}
+
 econf_err econf_readDirs(econf_file **result,
 			 const char *dist_conf_dir,
 			 const char *etc_conf_dir,
@@ -304,25 +368,83 @@ econf_err econf_readDirs(econf_file **result,
 			 const char *config_suffix,
 			 const char *delim,
 			 const char *comment)
+{
+  return econf_readDirsWithOptions(result, dist_conf_dir, etc_conf_dir,
+				   project_name, config_suffix, delim, comment,
+				   NULL);
+}
+
+econf_err econf_readDirsWithOptions(econf_file **result,
+				    const char *dist_conf_dir,
+				    const char *etc_conf_dir,
+				    const char *project_name,
+				    const char *config_suffix,
+				    const char *delim,
+				    const char *comment,
+				    const econf_options *options)
 {
   size_t size = 0;
   econf_file **key_files;
   econf_err error;
-
-  error = econf_readDirsHistory(&key_files,
-				&size,
-				dist_conf_dir,
-				etc_conf_dir,
-				project_name,
-				config_suffix,
-				delim,
-				comment);
+  unsigned int flags = options_flags(options);
+  struct load_stats *stats = NULL;
+  uint64_t allocations = alloc_count();
+  uint64_t start = (flags & OPT_STATS) ? stats_now() : 0, read_ns = 0;
+
+  error = read_dirs_history(&key_files,
+			    &size,
+			    dist_conf_dir,
+			    etc_conf_dir,
+			    project_name,
+			    config_suffix,
+			    delim,
+			    comment,
+			    options);
   if (error != ECONF_SUCCESS)
     return error;
 
+  /* The statistics of the single files are collected before merging
+     them, because merging releases the files.  */
+  if (flags & OPT_STATS) {
+    read_ns = stats_now() - start;
+    stats = alloc_calloc(1, sizeof(struct load_stats));
+    if (stats == NULL)
+      error = ECONF_NOMEM;
+    for (size_t i = 0; !error && i < size; i++)
+      error = stats_append(&stats, key_files[i]->stats);
+    if (error) {
+      stats_free(stats);
+      for (size_t i = 0; i < size; i++)
+	econf_freeFile(key_files[i]);
+      alloc_free(key_files);
+      return error;
+    }
+  }
+
   // Merge the list of acquired key_files into merged_file
+  uint64_t merge_start = (flags & OPT_STATS) ? stats_now() : 0;
   error = merge_econf_files(key_files, result);
-  free(key_files);
+  alloc_free(key_files);
+
+  if (flags & OPT_STATS) {
+    if (error) {
+      stats_free(stats);
+      return error;
+    }
+    uint64_t end = stats_now();
+    uint64_t file_ns = stats->total.parse_ns + stats->total.join_ns;
+    stats->total.scan_ns = read_ns > file_ns ? read_ns - file_ns : 0;
+    stats->total.merge_ns = end - merge_start;
+    stats->total.total_ns = end - start;
+    stats->total.allocations = alloc_count() - allocations;
+    stats_free((*result)->stats);
+    (*result)->stats = stats;
+  }
+  if (!error && (flags & OPT_PROFILE_LOOKUPS) &&
+      (error = lookups_enable(*result))) {
+    econf_freeFile(*result);
+    *result = NULL;
+  }
 
   return error;
 }
@@ -330,146 +452,194 @@ econf_err econf_readDirs(econf_file **result,
 // Write content of a econf_file struct to specified location
 econf_err econf_writeFile(econf_file *key_file, const char *save_to_dir,
 			       const char *file_name) {
-  if (!key_file)
+  return econf_writeFileWithFlags(key_file, save_to_dir, file_name, 0);
+}
+
+econf_err econf_writeFileWithFlags(econf_file *key_file, const char *save_to_dir,
+				   const char *file_name, int flags) {
+  if (!key_file || !save_to_dir || !file_name)
     return ECONF_ERROR;
 
-  // Check if the directory exists
-  // XXX use stat instead of opendir
-  DIR *dir = opendir(save_to_dir);
-  if (dir)
-    closedir(dir);
+  econf_err error = key_file_normalize(key_file);
+  if (error)
+    return error;
+
+  char *data;
+  size_t length;
+  if (flags & ECONF_WRITE_LOSSLESS)
+    error = serialize_key_file_lossless(key_file, &data, &length);
   else
-    return ECONF_NOFILE;
+    error = serialize_key_file(key_file, &data, &length);
+  if (error)
+    return error;
 
-  // Create a file handle for the specified file
-  char *save_to = combine_strings(save_to_dir, file_name, '/');
-  if (save_to == NULL)
-    return ECONF_NOMEM;
+  error = write_file_atomic(save_to_dir, file_name, data, length, flags);
+  alloc_free(data);
+  return error;
+}
+
+// Evaluate the entries of edited_file which differ from base_file
+econf_err econf_diffFiles(econf_file **delta, econf_file *base_file,
+			  econf_file *edited_file) {
+  if (delta == NULL || base_file == NULL || edited_file == NULL)
+    return ECONF_ERROR;
 
-  FILE *kf = fopen(save_to, "w");
-  if (kf == NULL) {
-    free(save_to);
-    return ECONF_WRITEERROR;
+  econf_err error = econf_newKeyFile(delta, edited_file->delimiter,
+				     edited_file->comment);
+  if (error)
+    return error;
+
+  for (size_t i = 0; i < edited_file->length; i++) {
+    struct file_entry *fe = &edited_file->file_entry[i];
+    if (fe->deleted)
+      continue;
+    const char *group =
+      strcmp(fe->group, KEY_FILE_NULL_VALUE) ? fe->group : NULL;
+    size_t num;
+    error = find_key(base_file, group, fe->key, &num);
+    if (error == ECONF_SUCCESS) {
+      const char *value = base_file->file_entry[num].value;
+      if (value == fe->value ||
+	  (value && fe->value && !strcmp(value, fe->value)))
+	continue;
+    } else if (error != ECONF_NOKEY) {
+      break;
+    }
+    if ((error = setKeyValue(setStringValueNum, *delta, group, fe->key,
+			     fe->value)))
+      break;
+  }
+
+  if (error) {
+    econf_freeFile(*delta);
+    *delta = NULL;
   }
+  return error;
+}
+
+// Add the changes of edited_file to a drop-in file
+econf_err econf_writeDropIn(econf_file *base_file, econf_file *edited_file,
+			    const char *dropin_dir, const char *file_name,
+			    int flags) {
+  econf_file *delta = NULL, *dropin = NULL;
+
+  if (dropin_dir == NULL || file_name == NULL)
+    return ECONF_ERROR;
 
-  // Write to file
-  for (size_t i = 0; i < key_file->length; i++) {
-    if (!i || strcmp(key_file->file_entry[i - 1].group,
-                     key_file->file_entry[i].group)) {
-      if (i)
-        fprintf(kf, "\n");
-      if (strcmp(key_file->file_entry[i].group, KEY_FILE_NULL_VALUE))
-        fprintf(kf, "%s\n", key_file->file_entry[i].group);
+  econf_err error = econf_diffFiles(&delta, base_file, edited_file);
+  if (error)
+    return error;
+
+  char *path = combine_strings(dropin_dir, file_name, '/');
+  if (path == NULL) {
+    econf_freeFile(delta);
+    return ECONF_NOMEM;
+  }
+  char delim[] = { edited_file->delimiter, '\0' };
+  char comment[] = { edited_file->comment, '\0' };
+  error = econf_readFile(&dropin, path, delim, comment);
+  alloc_free(path);
+
+  if (error == ECONF_NOFILE) {
+    error = ECONF_SUCCESS;
+    if (delta->length == 0)
+      goto out;
+    dropin = delta;
+    delta = NULL;
+  } else if (error) {
+    goto out;
+  } else {
+    for (size_t i = 0; i < delta->length; i++) {
+      struct file_entry *fe = &delta->file_entry[i];
+      const char *group =
+	strcmp(fe->group, KEY_FILE_NULL_VALUE) ? fe->group : NULL;
+      if ((error = setKeyValue(setStringValueNum, dropin, group, fe->key,
+			       fe->value)))
+	goto out;
     }
-    fprintf(kf, "%s%c%s\n", key_file->file_entry[i].key, key_file->delimiter,
-            key_file->file_entry[i].value);
   }
 
-  // Clean up
-  free(save_to);
-  fclose(kf);
-  return ECONF_SUCCESS;
+  error = econf_writeFileWithFlags(dropin, dropin_dir, file_name,
+				   flags | ECONF_WRITE_LOSSLESS);
+
+ out:
+  econf_freeFile(delta);
+  econf_freeFile(dropin);
+  return error;
 }
 
 extern char *econf_getPath(econf_file *kf)
 {
   if (kf->path == NULL)
-    return strdup("");
-  return strdup(kf->path);
+    return alloc_strdup("");
+  return alloc_strdup(kf->path);
 }
 
 /* GETTER FUNCTIONS */
-// TODO: Currently only works with a sorted econf_file. If a new
-// key with an existing group is appended at the end the group
-// will show twice. So the key file either needs to be sorted
-// upon entering a new key or the function must ensure only
-// unique values are returned.
 econf_err
 econf_getGroups(econf_file *kf, size_t *length, char ***groups)
 {
   if (!kf || groups == NULL)
     return ECONF_ERROR;
 
-  size_t tmp = 0;
-  bool *uniques = calloc(kf->length,sizeof(bool));
-  if (uniques == NULL)
-    return ECONF_NOMEM;
+  struct econf_index *idx = kf->index;
+  if (idx == NULL)
+    return ECONF_ERROR;
 
-  for (size_t i = 0; i < kf->length; i++) {
-    if ((!i || strcmp(kf->file_entry[i].group, kf->file_entry[i - 1].group)) &&
-        strcmp(kf->file_entry[i].group, KEY_FILE_NULL_VALUE)) {
-      uniques[i] = 1;
+  size_t tmp = 0;
+  for (size_t i = 0; i < idx->groups_length; i++)
+    if (idx->groups[i].deleted < idx->groups[i].length &&
+	strcmp(idx->groups[i].name, KEY_FILE_NULL_VALUE))
       tmp++;
-    }
-  }
-  if (!tmp) {
-    free(uniques);
+  if (!tmp)
     return ECONF_NOGROUP;
-  }
-  *groups = calloc(tmp + 1, sizeof(char*));
-  if (*groups == NULL) {
-    free(uniques);
+
+  *groups = alloc_calloc(tmp + 1, sizeof(char*));
+  if (*groups == NULL)
     return ECONF_NOMEM;
-  }
 
   tmp = 0;
-  for (size_t i = 0; i < kf->length; i++)
-    if (uniques[i])
-      (*groups)[tmp++] = strdup(kf->file_entry[i].group);
+  for (size_t i = 0; i < idx->groups_length; i++)
+    if (idx->groups[i].deleted < idx->groups[i].length &&
+	strcmp(idx->groups[i].name, KEY_FILE_NULL_VALUE))
+      (*groups)[tmp++] = alloc_strdup(idx->groups[i].name);
 
   if (length != NULL)
     *length = tmp;
 
-  free(uniques);
   return ECONF_SUCCESS;
 }
 
-// TODO: Same issue as with getGroups()
 econf_err
 econf_getKeys(econf_file *kf, const char *grp, size_t *length, char ***keys)
 {
   if (!kf)
     return ECONF_ERROR;
 
-  size_t tmp = 0;
-  char *group = ((!grp || !*grp) ? strdup(KEY_FILE_NULL_VALUE) :
-                 addbrackets(grp));
-  if (group == NULL)
-    return ECONF_NOMEM;
+  struct group_index *gi;
+  econf_err error = index_find_group(kf, grp, &gi);
+  if (error == ECONF_NOGROUP)
+    return ECONF_NOKEY;
+  if (error)
+    return error;
 
-  bool *uniques = calloc(kf->length, sizeof(bool));
-  if (uniques == NULL)
-    {
-      free(group);
-      return ECONF_NOMEM;
-    }
-  for (size_t i = 0; i < kf->length; i++) {
-    if (!strcmp(kf->file_entry[i].group, group) &&
-        (!i || strcmp(kf->file_entry[i].key, kf->file_entry[i - 1].key))) {
-      uniques[i] = 1;
-      tmp++;
-    }
-  }
-  free(group);
-  if (!tmp)
-    {
-      free (uniques);
-      return ECONF_NOKEY;
-    }
-  *keys = calloc(tmp + 1, sizeof(char*));
-  if (*keys == NULL) {
-    free (uniques);
+  *keys = alloc_calloc(gi->length + 1, sizeof(char*));
+  if (*keys == NULL)
     return ECONF_NOMEM;
-  }
 
-  for (size_t i = 0, j = 0; i < kf->length; i++)
-    if (uniques[i])
-      (*keys)[j++] = strdup(kf->file_entry[i].key);
+  size_t tmp = 0;
+  for (size_t i = 0; i < gi->length; i++) {
+    struct file_entry *fe = &kf->file_entry[gi->entries[i]];
+    size_t num;
+    /* Return keys which are defined several times only once */
+    if (index_find_key(kf, grp, fe->key, &num) == ECONF_SUCCESS &&
+	num == gi->entries[i])
+      (*keys)[tmp++] = alloc_strdup(fe->key);
+  }
 
   if (length != NULL)
     *length = tmp;
 
-  free(uniques);
   return ECONF_SUCCESS;
 }
 
@@ -482,7 +652,7 @@ econf_err econf_get ## FCT_TYPE ## Value(econf_file *kf, const char *group, \
     return ECONF_ERROR; \
 \
   size_t num; \
-  econf_err error = find_key(*kf, group, key, &num);	\
+  econf_err error = lookup_key(kf, group, key, &num);	\
   if (error) \
     return error; \
   return get ## FCT_TYPE ## ValueNum(*kf, num, result);	\
@@ -517,14 +687,68 @@ libeconf_setValue(Double, double, &value)
 libeconf_setValue(String, const char *, value)
 libeconf_setValue(Bool, const char *, value)
 
+/* DELETE FUNCTIONS */
+econf_err
+econf_deleteKey(econf_file *kf, const char *group, const char *key)
+{
+  if (!kf)
+    return ECONF_ERROR;
+
+  size_t num;
+  econf_err error = find_key(kf, group, key, &num);
+  if (error)
+    return error;
+
+  /* A file can contain a key several times. Lookups return the first
+     one, so all of them are deleted; otherwise the next one would
+     show up again after econf_compact().  */
+  struct group_index *gi;
+  if ((error = index_find_group(kf, group, &gi)))
+    return error;
+  for (size_t i = 0; i < gi->length; i++) {
+    struct file_entry *fe = &kf->file_entry[gi->entries[i]];
+    if (!fe->deleted && !strcmp(fe->key, key) &&
+	(error = key_file_delete(kf, gi->entries[i])))
+      return error;
+  }
+  return ECONF_SUCCESS;
+}
+
+econf_err
+econf_deleteGroup(econf_file *kf, const char *group)
+{
+  if (!kf)
+    return ECONF_ERROR;
+
+  struct group_index *gi;
+  econf_err error = index_find_group(kf, group, &gi);
+  if (error)
+    return error;
+
+  for (size_t i = 0; i < gi->length; i++) {
+    if ((error = key_file_delete(kf, gi->entries[i])))
+      return error;
+  }
+  return ECONF_SUCCESS;
+}
+
+econf_err
+econf_compact(econf_file *kf)
+{
+  if (!kf)
+    return ECONF_ERROR;
+
+  return key_file_compact(kf);
+}
+
 /* --- DESTROY FUNCTIONS --- */
 
 void econf_freeArray(char** array) {
   if (!array) { return; }
   char *tmp = (char*) array;
   while (*array)
-    free(*array++);
-  free(tmp);
+    alloc_free(*array++);
+  alloc_free(tmp);
 }
 
 // Free memory allocated by key_file
@@ -535,22 +759,33 @@ void econf_freeFile(econf_file *key_file) {
   if (key_file->file_entry)
   {
     for (size_t i = 0; i < key_file->alloc_length; i++) {
+      alloc_free(key_file->file_entry[i].cache.lines);
+      /* The strings of an attached file belong to the mapping */
+      if (key_file->shared)
+	continue;
       if (key_file->file_entry[i].group)
-	free(key_file->file_entry[i].group);
+	alloc_free(key_file->file_entry[i].group);
       if (key_file->file_entry[i].key)
-	free(key_file->file_entry[i].key);
+	alloc_free(key_file->file_entry[i].key);
       if (key_file->file_entry[i].value)
-	free(key_file->file_entry[i].value);
+	alloc_free(key_file->file_entry[i].value);
       if (key_file->file_entry[i].comment_before_key)
-	free(key_file->file_entry[i].comment_before_key);
+	alloc_free(key_file->file_entry[i].comment_before_key);
       if (key_file->file_entry[i].comment_after_value)
-	free(key_file->file_entry[i].comment_after_value);
+	alloc_free(key_file->file_entry[i].comment_after_value);
     }
-    free(key_file->file_entry);
+    alloc_free(key_file->file_entry);
   }
+  alloc_free(key_file->source);
+  alloc_free(key_file->removed_spans);
+  source_table_release(key_file->sources);
+  stats_free(key_file->stats);
+  lookups_free(key_file->lookups);
+  shared_release(key_file);
 
   if (key_file->path)
-    free(key_file->path);
+    alloc_free(key_file->path);
 
-  free(key_file);
+  index_free(key_file);
+  alloc_free(key_file);
 }
@@ -23,85 +23,164 @@
 #include <string.h>
 #include <stdio.h>
 #include "libeconf.h"
+#include "alloc.h"
+#include "defines.h"
 #include "helpers.h"
 #include "keyfile.h"
+#include "keyindex.h"
 #include "libeconf_ext.h"
-
-static char *ltrim(char *s)
+#include "lookups.h"
+#include "sources.h"
+#include "stats.h"
+
+/* Return the lines of the value of the file_entry number num. The lines
+   are split on the first call and cached until the value is changed. If
+   several threads split them at the same time, the first one stores its
+   lines and the others free theirs.  */
+static econf_err
+value_lines(econf_file *kf, size_t num, const struct value_lines **result)
 {
-  while(isspace(*s)) s++;
-  return s;
-}
+  struct file_entry *fe = &kf->file_entry[num];
+  struct value_lines *cached =
+    atomic_load_explicit(&fe->cache.lines, memory_order_acquire);
+
+  if (cached == NULL) {
+    const char *value = fe->value ? fe->value : "";
+    const char *start = value, *end = value + strlen(value);
+    while (start < end && isspace((unsigned char) *start))
+      start++;
+    while (end > start && isspace((unsigned char) *(end - 1)))
+      end--;
+
+    /* one quoted string only, otherwise one value per line */
+    size_t length = 1;
+    if (*start != '"') {
+      for (const char *p = start; (p = memchr(p, '\n', end - p)) != NULL; p++)
+	length++;
+    }
 
-static char *rtrim(char *s)
-{
-  if (strlen(s)<=0)
-    return s;
+    struct value_lines *lines =
+      alloc_malloc(sizeof(struct value_lines) + length * sizeof(econf_span));
+    if (lines == NULL)
+      return ECONF_NOMEM;
+    lines->length = length;
+    for (size_t i = 0; i < length; i++) {
+      const char *line_start = start;
+      const char *line_end = i + 1 < length ?
+	memchr(start, '\n', end - start) : end;
+      start = line_end + 1;
+      while (line_start < line_end && isspace((unsigned char) *line_start))
+	line_start++;
+      while (line_end > line_start && isspace((unsigned char) *(line_end - 1)))
+	line_end--;
+      lines->spans[i].start = line_start;
+      lines->spans[i].length = line_end - line_start;
+    }
+    if (atomic_compare_exchange_strong_explicit(&fe->cache.lines, &cached,
+						lines, memory_order_acq_rel,
+						memory_order_acquire))
+      cached = lines;
+    else
+      alloc_free(lines);
+  }
 
-  char* back = s + strlen(s);
-  while(isspace(*--back));
-  *(back+1) = '\0';
-  return s;
+  *result = cached;
+  return ECONF_SUCCESS;
 }
 
-static char *trim(char *s)
+econf_err
+econf_getExtValueView(econf_file *kf, const char *group,
+		      const char *key, econf_ext_value_view *result)
 {
-  return rtrim(ltrim(s));
+  if (!kf || result == NULL)
+    return ECONF_ERROR;
+
+  size_t num;
+  econf_err error = lookup_key(kf, group, key, &num);
+  if (error)
+    return error;
+
+  const struct value_lines *lines;
+  if ((error = value_lines(kf, num, &lines)))
+    return error;
+
+  result->values = lines->spans;
+  result->values_length = lines->length;
+  result->file = source_path(kf, kf->file_entry[num].source);
+  if (result->file == NULL)
+    result->file = kf->path;
+  result->line_number = kf->file_entry[num].line_number;
+  result->comment_before_key = kf->file_entry[num].comment_before_key;
+  result->comment_after_value = kf->file_entry[num].comment_after_value;
+  return ECONF_SUCCESS;
 }
 
 econf_err
 econf_getExtValue(econf_file *kf, const char *group,
 		  const char *key, econf_ext_value **result)
 {
-  if (!kf)
-    return ECONF_ERROR;
-
-  size_t num;
-  econf_err error = find_key(*kf, group, key, &num);
+  econf_ext_value_view view;
+  econf_err error = econf_getExtValueView(kf, group, key, &view);
   if (error)
     return error;
 
-  *result = malloc(sizeof(econf_ext_value));
+  *result = alloc_calloc(1, sizeof(econf_ext_value));
   if (*result==NULL)
     return ECONF_NOMEM;
 
-  getCommentsNum(*kf, num,
-		 &((*result)->comment_before_key),
-		 &((*result)->comment_after_value));
-  getPath(*kf, &((*result)->file));
-  getLineNrNum(*kf, num, &((*result)->line_number));
-
-  char *value_string = NULL;
-  getStringValueNum(*kf, num, &value_string);
-
-  char buf[BUFSIZ];
-  char *line;
-  size_t n_del = 0;
-  strncpy(buf,value_string,BUFSIZ-1);
-  free(value_string);
-  value_string = trim(buf);
-  (*result)->values = NULL;
-
-  if (value_string[0] == '\"')
-  {
-    /* one quoted string only */
-    (*result)->values = realloc ((*result)->values, sizeof (char*) * ++n_del);
-    if ((*result)->values == NULL)
-      return ECONF_NOMEM; /* memory allocation failed */
-    (*result)->values[n_del-1] = strdup(value_string);
-  } else {
-    /* splitting into a character array */
-    while ((line = strsep(&value_string, "\n")) != NULL) {
-      (*result)->values = realloc ((*result)->values, sizeof (char*) * ++n_del);
-      if ((*result)->values == NULL)
-	return ECONF_NOMEM; /* memory allocation failed */
-      (*result)->values[n_del-1] = strdup(trim(line));
-    }
+  /* one extra element for the last 0 */
+  (*result)->values = alloc_calloc(view.values_length + 1, sizeof(char *));
+  if ((*result)->values == NULL)
+    goto nomem;
+  for (size_t i = 0; i < view.values_length; i++) {
+    (*result)->values[i] = alloc_strndup(view.values[i].start,
+				   view.values[i].length);
+    if ((*result)->values[i] == NULL)
+      goto nomem;
   }
 
-  /* realloc one extra element for the last 0 */
-  (*result)->values = realloc ((*result)->values, sizeof (char*) * ++n_del);
-  (*result)->values[n_del-1] = 0;
+  if ((view.file &&
+       ((*result)->file = alloc_strdup(view.file)) == NULL) ||
+      (view.comment_before_key &&
+       ((*result)->comment_before_key = alloc_strdup(view.comment_before_key)) == NULL) ||
+      (view.comment_after_value &&
+       ((*result)->comment_after_value = alloc_strdup(view.comment_after_value)) == NULL))
+    goto nomem;
+  (*result)->line_number = view.line_number;
+
+  return ECONF_SUCCESS;
+
+ nomem:
+  econf_freeExtValue(*result);
+  *result = NULL;
+  return ECONF_NOMEM;
+}
+
+econf_err
+econf_nextEntry(econf_file *kf, size_t *cursor, econf_entry *entry)
+{
+  if (!kf || cursor == NULL || entry == NULL)
+    return ECONF_ERROR;
+
+  /* The cursor is the number of the last returned entry + 1. The entries
+     are taken from the index, so kf does not have to be reordered.  */
+  struct file_entry *fe;
+  do {
+    size_t num;
+    econf_err error = index_next_entry(kf, *cursor, &num);
+    if (error)
+      return error;
+    *cursor = num + 1;
+    fe = &kf->file_entry[num];
+  } while (fe->deleted);
+
+  entry->group = strcmp(fe->group, KEY_FILE_NULL_VALUE) ? fe->group : NULL;
+  entry->key = fe->key;
+  entry->value = fe->value;
+  entry->comment_before_key = fe->comment_before_key;
+  entry->comment_after_value = fe->comment_after_value;
+  entry->line_number = fe->line_number;
+  entry->file = source_path(kf, fe->source);
 
   return ECONF_SUCCESS;
 }
@@ -112,12 +191,64 @@ extern void econf_freeExtValue(econf_ext_value *to_free)
 
   /* freeing array of strings */
   char **str = to_free->values;
-  while (*str)
-    free(*str++); 
-  free(to_free->values);
-
-  free(to_free->file);
-  free(to_free->comment_before_key);
-  free(to_free->comment_after_value);
-  free(to_free);
+  while (str && *str)
+    alloc_free(*str++);
+  alloc_free(to_free->values);
+
+  alloc_free(to_free->file);
+  alloc_free(to_free->comment_before_key);
+  alloc_free(to_free->comment_after_value);
+  alloc_free(to_free);
+}
+
+static size_t
+string_size(const char *string)
+{
+  return string ? strlen(string) + 1 : 0;
+}
+
+econf_err
+econf_memoryUsage(econf_file *kf, econf_memory_usage *usage)
+{
+  if (!kf || usage == NULL)
+    return ECONF_ERROR;
+
+  memset(usage, 0, sizeof(econf_memory_usage));
+  usage->entry_count = kf->length;
+  usage->entries = kf->length * sizeof(struct file_entry);
+  usage->slack = (kf->alloc_length - kf->length) * sizeof(struct file_entry);
+  for (size_t i = 0; kf->shared == NULL && i < kf->length; i++) {
+    const struct file_entry *fe = &kf->file_entry[i];
+    usage->strings += string_size(fe->group) + string_size(fe->key) +
+      string_size(fe->value);
+    usage->comments += string_size(fe->comment_before_key) +
+      string_size(fe->comment_after_value);
+  }
+  /* The strings of an attached file are part of the shared mapping */
+  usage->shared = kf->shared_size;
+  for (size_t i = 0; i < kf->length; i++) {
+    const struct file_entry *fe = &kf->file_entry[i];
+    if (fe->cache.lines)
+      usage->caches += sizeof(struct value_lines) +
+	fe->cache.lines->length * sizeof(econf_span);
+  }
+  usage->source = kf->source_alloc_length +
+    kf->removed_spans_length * sizeof(struct source_span);
+  usage->index = index_memory_usage(kf);
+
+  usage->other = sizeof(econf_file) + string_size(kf->path) +
+    source_table_memory_usage(kf->sources);
+  if (kf->stats) {
+    usage->other += sizeof(struct load_stats) +
+      kf->stats->alloc_length * (sizeof(econf_file_stats) + sizeof(char *));
+    for (size_t i = 0; i < kf->stats->total.file_stats_length; i++)
+      usage->other += string_size(kf->stats->paths[i]);
+  }
+  if (kf->lookups)
+    usage->other += lookups_memory_usage(kf->lookups);
+
+  usage->total = usage->entries + usage->slack + usage->strings +
+    usage->comments + usage->caches + usage->source + usage->index +
+    usage->other;
+  return ECONF_SUCCESS;
 }
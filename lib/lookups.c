@@ -0,0 +1,250 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "defines.h"
+#include "helpers.h"
+#include "keyindex.h"
+#include "lookups.h"
+
+#include <string.h>
+
+econf_err lookups_enable(econf_file *kf) {
+  if (kf->lookups)
+    return ECONF_SUCCESS;
+  kf->lookups = alloc_calloc(1, sizeof(struct lookup_profile));
+  if (kf->lookups == NULL)
+    return ECONF_NOMEM;
+  if (pthread_mutex_init(&kf->lookups->lock, NULL)) {
+    alloc_free(kf->lookups);
+    kf->lookups = NULL;
+    return ECONF_ERROR;
+  }
+  return ECONF_SUCCESS;
+}
+
+/* Compare a group given by the caller with a stored one without adding
+   the brackets first, see addbrackets().  */
+static bool
+group_equal(const char *stored, const char *group)
+{
+  if (!group || !*group)
+    return stored == NULL;
+  if (stored == NULL)
+    return false;
+  size_t length = strlen(group);
+  if (group[0] == '[' && group[length - 1] == ']')
+    return strcmp(stored, group) == 0;
+  return stored[0] == '[' && strncmp(stored + 1, group, length) == 0 &&
+    stored[length + 1] == ']' && stored[length + 2] == '\0';
+}
+
+// Return the slot of the miss in the hash table. If the miss does not
+// exist the slot points to the empty element where it has to be inserted.
+static size_t
+miss_slot(const struct lookup_profile *profile, size_t hash,
+	  const char *group, const char *key)
+{
+  size_t mask = profile->table_size - 1;
+  size_t slot = hash & mask;
+  while (profile->table[slot]) {
+    const struct lookup_miss *miss = &profile->misses[profile->table[slot] - 1];
+    if (miss->hash == hash && strcmp(miss->key, key) == 0 &&
+	group_equal(miss->group, group))
+      break;
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+static econf_err
+table_resize(struct lookup_profile *profile, size_t size)
+{
+  size_t *table = alloc_calloc(size, sizeof(size_t));
+  if (table == NULL)
+    return ECONF_NOMEM;
+
+  for (size_t i = 0; i < profile->misses_length; i++) {
+    size_t slot = profile->misses[i].hash & (size - 1);
+    while (table[slot])
+      slot = (slot + 1) & (size - 1);
+    table[slot] = i + 1;
+  }
+  alloc_free(profile->table);
+  profile->table = table;
+  profile->table_size = size;
+  return ECONF_SUCCESS;
+}
+
+static struct lookup_miss *
+new_miss(struct lookup_profile *profile, size_t hash, const char *group,
+	 const char *key)
+{
+  if ((profile->misses_length + 1) * 2 > profile->table_size &&
+      table_resize(profile, profile->table_size ? profile->table_size * 2 : 16))
+    return NULL;
+  if (profile->misses_length == profile->misses_alloc_length) {
+    size_t alloc_length = profile->misses_alloc_length ?
+      profile->misses_alloc_length * 2 : 8;
+    struct lookup_miss *tmp =
+      alloc_realloc(profile->misses, alloc_length * sizeof(struct lookup_miss));
+    if (tmp == NULL)
+      return NULL;
+    profile->misses = tmp;
+    profile->misses_alloc_length = alloc_length;
+  }
+
+  struct lookup_miss *miss = &profile->misses[profile->misses_length];
+  miss->group = (!group || !*group) ? NULL : addbrackets(group);
+  miss->key = alloc_strdup(key);
+  if ((group && *group && miss->group == NULL) || miss->key == NULL) {
+    alloc_free(miss->group);
+    alloc_free(miss->key);
+    return NULL;
+  }
+  miss->hash = hash;
+  miss->count = 0;
+  profile->misses_length++;
+  profile->table[miss_slot(profile, hash, group, key)] = profile->misses_length;
+  return miss;
+}
+
+void lookups_add_miss(struct lookup_profile *profile, const char *group,
+		      const char *key) {
+  struct lookup_miss *miss = NULL;
+  size_t hash = index_hash(group, key);
+
+  pthread_mutex_lock(&profile->lock);
+  if (profile->table_size) {
+    size_t slot = miss_slot(profile, hash, group, key);
+    if (profile->table[slot])
+      miss = &profile->misses[profile->table[slot] - 1];
+  }
+  if (miss == NULL)
+    miss = new_miss(profile, hash, group, key);
+  if (miss)
+    miss->count++;
+  pthread_mutex_unlock(&profile->lock);
+}
+
+size_t lookups_memory_usage(struct lookup_profile *profile) {
+  pthread_mutex_lock(&profile->lock);
+  size_t size = sizeof(struct lookup_profile) +
+    profile->misses_alloc_length * sizeof(struct lookup_miss) +
+    profile->table_size * sizeof(size_t);
+  for (size_t i = 0; i < profile->misses_length; i++)
+    size += (profile->misses[i].group ? strlen(profile->misses[i].group) + 1 : 0) +
+      strlen(profile->misses[i].key) + 1;
+  pthread_mutex_unlock(&profile->lock);
+  return size;
+}
+
+void lookups_free(struct lookup_profile *profile) {
+  if (profile == NULL)
+    return;
+  for (size_t i = 0; i < profile->misses_length; i++) {
+    alloc_free(profile->misses[i].group);
+    alloc_free(profile->misses[i].key);
+  }
+  alloc_free(profile->misses);
+  alloc_free(profile->table);
+  pthread_mutex_destroy(&profile->lock);
+  alloc_free(profile);
+}
+
+/* Element of the array which is sorted by econf_getLookups(). The order
+   in the file is needed for sorting stably with qsort().  */
+struct sort_lookup {
+  econf_lookup lookup;
+  size_t order;
+};
+
+/* Existing keys first, then the most frequently used ones. Keys with the
+   same number of lookups stay in the order of the file.  */
+static int
+compare_lookups(const void *a, const void *b)
+{
+  const struct sort_lookup *la = a, *lb = b;
+
+  if (la->lookup.found != lb->lookup.found)
+    return la->lookup.found ? -1 : 1;
+  if (la->lookup.count != lb->lookup.count)
+    return la->lookup.count > lb->lookup.count ? -1 : 1;
+  return la->order < lb->order ? -1 : la->order > lb->order;
+}
+
+econf_err econf_getLookups(econf_file *kf, econf_lookup **lookups,
+			   size_t *length) {
+  if (kf == NULL || lookups == NULL || length == NULL || kf->lookups == NULL)
+    return ECONF_ERROR;
+
+  struct lookup_profile *profile = kf->lookups;
+  pthread_mutex_lock(&profile->lock);
+  size_t n = 0, max = kf->length - kf->deleted + profile->misses_length;
+  struct sort_lookup *sorted =
+    alloc_malloc((max ? max : 1) * sizeof(struct sort_lookup));
+  if (sorted == NULL) {
+    pthread_mutex_unlock(&profile->lock);
+    return ECONF_NOMEM;
+  }
+  for (size_t i = 0; i < kf->length; i++) {
+    const struct file_entry *fe = &kf->file_entry[i];
+    if (fe->deleted)
+      continue;
+    sorted[n].lookup.group =
+      strcmp(fe->group, KEY_FILE_NULL_VALUE) ? fe->group : NULL;
+    sorted[n].lookup.key = fe->key;
+    sorted[n].lookup.count =
+      atomic_load_explicit(&fe->lookups, memory_order_relaxed);
+    sorted[n].lookup.found = true;
+    sorted[n].order = n;
+    n++;
+  }
+  for (size_t i = 0; i < profile->misses_length; i++) {
+    sorted[n].lookup.group = profile->misses[i].group;
+    sorted[n].lookup.key = profile->misses[i].key;
+    sorted[n].lookup.count = profile->misses[i].count;
+    sorted[n].lookup.found = false;
+    sorted[n].order = n;
+    n++;
+  }
+  pthread_mutex_unlock(&profile->lock);
+
+  qsort(sorted, n, sizeof(struct sort_lookup), compare_lookups);
+  econf_lookup *result = alloc_malloc((n ? n : 1) * sizeof(econf_lookup));
+  if (result == NULL) {
+    alloc_free(sorted);
+    return ECONF_NOMEM;
+  }
+  for (size_t i = 0; i < n; i++)
+    result[i] = sorted[i].lookup;
+  alloc_free(sorted);
+
+  *lookups = result;
+  *length = n;
+  return ECONF_SUCCESS;
+}
+
+void econf_freeLookups(econf_lookup *lookups) {
+  alloc_free(lookups);
+}
@@ -0,0 +1,67 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- lookups.h --- */
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "keyfile.h"
+
+/* Profile of the lookups of an econf_file which has been read with
+   OPT_PROFILE_LOOKUPS. The lookups of existing keys are counted in
+   file_entry.lookups with relaxed atomics, lookups are read-only
+   otherwise and can run concurrently. The lookups of missing keys are
+   counted in misses, which are protected by the mutex lock and not by a
+   spinlock, because a miss may allocate memory while it holds the lock.
+   The library links the threads library for it. Files without profile
+   only pay for the check of econf_file.lookups in lookup_key().  */
+struct lookup_profile {
+  pthread_mutex_t lock;
+  struct lookup_miss {
+    /* Group as it is stored in a file_entry or NULL */
+    char *group;
+    char *key;
+    size_t hash;
+    uint64_t count;
+  } *misses;
+  size_t misses_length, misses_alloc_length;
+  /* Open addressing hash table of the misses with the hash of
+     index_hash(). It contains the miss number + 1, 0 marks an empty
+     slot. The size is 0 or a power of two.  */
+  size_t *table, table_size;
+};
+
+/* Start profiling the lookups of key_file */
+econf_err lookups_enable(econf_file *key_file);
+
+/* Count a lookup of a key which does not exist. Lookups which cannot be
+   recorded because of missing memory are lost.  */
+void lookups_add_miss(struct lookup_profile *profile, const char *group,
+		      const char *key);
+
+/* Allocated bytes of profile including the misses */
+size_t lookups_memory_usage(struct lookup_profile *profile);
+
+void lookups_free(struct lookup_profile *profile);
@@ -22,6 +22,7 @@
 */
 
 #include "libeconf.h"
+#include "alloc.h"
 #include "defines.h"
 #include "helpers.h"
 #include "mergefiles.h"
@@ -63,8 +64,12 @@ size_t merge_existing_groups(struct file_entry **fe, econf_file *uf, econf_file
 	    for (size_t k = merge_length; k < i + tmp; k++) {
 	      // If an existing key is found in ef take the value from ef
 	      if (!strcmp((*fe)[k].key, ef->file_entry[j].key)) {
-		free((*fe)[k].value);
-		(*fe)[k].value = strdup(ef->file_entry[j].value);
+		alloc_free((*fe)[k].value);
+		(*fe)[k].value = alloc_strdup(ef->file_entry[j].value);
+		value_cache_copy(&(*fe)[k].cache, &ef->file_entry[j].cache);
+		/* Both files share the same source table */
+		(*fe)[k].source = ef->file_entry[j].source;
+		(*fe)[k].line_number = ef->file_entry[j].line_number;
 		new_key = 0;
 		break;
 	      }
@@ -104,7 +109,7 @@ size_t add_new_groups(struct file_entry **fe, econf_file *uf, econf_file *ef,
       if (new_key)
 	(*fe)[added_keys++] = cpy_file_entry(ef->file_entry[i]);
     }
-    *fe = realloc(*fe, added_keys * sizeof(struct file_entry));
+    *fe = alloc_realloc(*fe, added_keys * sizeof(struct file_entry));
   }
   return added_keys;
 }
@@ -117,19 +122,19 @@ size_t add_new_groups(struct file_entry **fe, econf_file *uf, econf_file *ef,
 char **get_default_dirs(const char *usr_conf_dir, const char *etc_conf_dir) {
   size_t default_dir_number = 3, dir_num = 0;
 
-  char **default_dirs = malloc(default_dir_number * sizeof(char *));
+  char **default_dirs = alloc_malloc(default_dir_number * sizeof(char *));
   if (default_dirs == NULL)
     return NULL;
 
   if (etc_conf_dir)
     {
       // Set config directory in /etc
-      default_dirs[dir_num++] = strdup(etc_conf_dir); /* XXX ENOMEM check */
+      default_dirs[dir_num++] = alloc_strdup(etc_conf_dir); /* XXX ENOMEM check */
     }
   if (usr_conf_dir)
     {
       // Set config directory in /usr
-      default_dirs[dir_num++] = strdup(usr_conf_dir); /* XXX ENOMEM check */
+      default_dirs[dir_num++] = alloc_strdup(usr_conf_dir); /* XXX ENOMEM check */
     }
 
   // TODO: Use secure_getenv() instead and check if the variable is actually set
@@ -139,14 +144,14 @@ char **get_default_dirs(const char *usr_conf_dir, const char *etc_conf_dir) {
 
   // If XDG_CONFIG_DIRS is set check it as well
   if(getenv("XDG_CONFIG_DIRS")) {
-    default_dirs = realloc(default_dirs, ++default_dir_number * sizeof(char *));
-    default_dirs[dir_num++] = strdup(getenv("XDG_CONFIG_DIRS"));
+    default_dirs = alloc_realloc(default_dirs, ++default_dir_number * sizeof(char *));
+    default_dirs[dir_num++] = alloc_strdup(getenv("XDG_CONFIG_DIRS"));
   }
   // XDG config home
   if (getenv("XDG_CONFIG_HOME")) {
-    default_dirs[dir_num++] = strdup(getenv("XDG_CONFIG_HOME"));
+    default_dirs[dir_num++] = alloc_strdup(getenv("XDG_CONFIG_HOME"));
   } else {
-    sprintf(default_dirs[dir_num++] = malloc(strlen("/home//.config") +
+    sprintf(default_dirs[dir_num++] = alloc_malloc(strlen("/home//.config") +
             strlen(getenv("USERNAME")) + 1), "/home/%s/.config",
             getenv("USERNAME"));
   }
@@ -157,68 +162,127 @@ char **get_default_dirs(const char *usr_conf_dir, const char *etc_conf_dir) {
 }
 #endif
 
-// Check if the given directory exists. If so look for config files
-// with the given suffix
+/* Sorted listing of a drop-in directory */
+struct drop_in_dir {
+  const char *path;
+  /* allocated by scandir() and released with free() */
+  struct dirent **de;
+  int length;
+  /* next file which has not been read or skipped yet */
+  int next;
+  /* Position of is_shadowed() in this listing while an earlier directory
+     is read. It is reset for every earlier directory.  */
+  int shadow;
+};
+
+// Move to the next file with the given suffix
+static void
+skip_other_files(struct drop_in_dir *dir, const char *config_suffix)
+{
+  size_t lensuffix = strlen(config_suffix);
+  for (; dir->next < dir->length; dir->next++) {
+    const char *name = dir->de[dir->next]->d_name;
+    size_t lenstr = strlen(name);
+    if (lensuffix < lenstr &&
+	strncmp(name + lenstr - lensuffix, config_suffix, lensuffix) == 0)
+      break;
+  }
+}
+
+// Check if one of the later directories contains a file with the given
+// name. The names of one directory are looked up in the order of the
+// sorted listings, so each later listing is walked through once per
+// earlier directory.
+static bool
+is_shadowed(struct drop_in_dir *later, size_t length, const char *name)
+{
+  for (size_t i = 0; i < length; i++) {
+    struct drop_in_dir *dir = &later[i];
+    while (dir->shadow < dir->length &&
+	   strcoll(dir->de[dir->shadow]->d_name, name) < 0)
+      dir->shadow++;
+    if (dir->shadow < dir->length &&
+	strcmp(dir->de[dir->shadow]->d_name, name) == 0)
+      return true;
+  }
+  return false;
+}
+
 static econf_err
-check_conf_dir(econf_file ***key_files, size_t *size, const char *path,
-	       const char *config_suffix, const char *delim, const char *comment)
+read_drop_in(econf_file ***key_files, size_t *size, const char *path,
+	     const char *name, const char *delim, const char *comment,
+	     const econf_options *options)
 {
-  struct dirent **de;
-  int num_dirs = scandir(path, &de, NULL, alphasort);
-  if(num_dirs > 0) {
-    for (int i = 0; i < num_dirs; i++) {
-      size_t lenstr = strlen(de[i]->d_name);
-      size_t lensuffix = strlen(config_suffix);
-      if (lensuffix < lenstr &&
-          strncmp(de[i]->d_name + lenstr - lensuffix, config_suffix, lensuffix) == 0) {
-        char *file_path = combine_strings(path, de[i]->d_name, '/');
-        econf_file *key_file;
-	econf_err error = econf_readFile(&key_file, file_path, delim, comment);
-        free(file_path);
-        if(!error && key_file) {
-          key_file->on_merge_delete = 1;
-          (*key_files)[(*size) - 1] = key_file;
-          *key_files = realloc(*key_files, ++(*size) * sizeof(econf_file *));
-        } else {
-	  for (int k = i; k < num_dirs; k++)
-	    free(de[k]);
-	  free(de);
-	  return error;
-	}
-      }
-      free(de[i]);
-    }
-    free(de);
+  char *file_path = combine_strings(path, name, '/');
+  if (file_path == NULL)
+    return ECONF_NOMEM;
+  econf_file *key_file;
+  econf_err error = econf_readFileWithOptions(&key_file, file_path, delim,
+					      comment, options);
+  alloc_free(file_path);
+  if (error || !key_file)
+    return error;
+
+  key_file->on_merge_delete = 1;
+  (*key_files)[(*size) - 1] = key_file;
+  econf_file **tmp = alloc_realloc(*key_files, (*size + 1) * sizeof(econf_file *));
+  if (tmp == NULL) {
+    (*key_files)[(*size) - 1] = NULL;
+    econf_freeFile(key_file);
+    return ECONF_NOMEM;
   }
+  *key_files = tmp;
+  (*size)++;
   return ECONF_SUCCESS;
 }
 
-econf_err traverse_conf_dirs(econf_file ***key_files,
-			     const char *config_dirs[],
-			     size_t *size, const char *path,
-			     const char *config_suffix,
-			     const char *delim, const char *comment) {
-  int i;
-
-  if (config_dirs == NULL)
-    return ECONF_NOFILE;
-
-  i = 0;
-  while (config_dirs[i] != NULL) {
-    char *fulldir, *cp;
-
-    if ((fulldir = malloc (strlen(path) + strlen (config_dirs[i]) + 1)) == NULL)
-      return ECONF_NOMEM;
-
-    cp = stpcpy (fulldir, path);
-    stpcpy (cp, config_dirs[i++]);
-    econf_err error = check_conf_dir(key_files, size,
-				     fulldir, config_suffix, delim, comment);
-    free (fulldir);
-    if (error)
-      return error;
+econf_err read_drop_in_dirs(econf_file ***key_files, size_t *size,
+			    char **dirs, size_t dirs_length,
+			    const char *config_suffix,
+			    const char *delim, const char *comment,
+			    const econf_options *options) {
+  struct drop_in_dir *listings = alloc_calloc(dirs_length,
+					      sizeof(struct drop_in_dir));
+  econf_err error = ECONF_SUCCESS;
+
+  if (listings == NULL)
+    return ECONF_NOMEM;
+
+  for (size_t i = 0; i < dirs_length; i++) {
+    listings[i].path = dirs[i];
+    listings[i].length = scandir(dirs[i], &listings[i].de, NULL, alphasort);
+    if (listings[i].length < 0) {
+      listings[i].de = NULL;
+      listings[i].length = 0;
+    }
   }
-  return ECONF_SUCCESS;
+
+  /* The directories are read one after the other. A file which is
+     replaced by a file with the same name in a later directory is not
+     read at all. */
+  for (size_t i = 0; i < dirs_length && !error; i++) {
+    struct drop_in_dir *dir = &listings[i];
+    for (size_t j = i + 1; j < dirs_length; j++)
+      listings[j].shadow = 0;
+    for (dir->next = 0, skip_other_files(dir, config_suffix);
+	 dir->next < dir->length;
+	 dir->next++, skip_other_files(dir, config_suffix)) {
+      const char *name = dir->de[dir->next]->d_name;
+      if (is_shadowed(listings + i + 1, dirs_length - i - 1, name))
+	continue;
+      if ((error = read_drop_in(key_files, size, dir->path, name, delim,
+				comment, options)))
+	break;
+    }
+  }
+
+  for (size_t i = 0; i < dirs_length; i++) {
+    for (int k = 0; k < listings[i].length; k++)
+      free(listings[i].de[k]);
+    free(listings[i].de);
+  }
+  alloc_free(listings);
+  return error;
 }
 
 econf_err merge_econf_files(econf_file **key_files, econf_file **merged_files) {
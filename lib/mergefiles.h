@@ -46,11 +46,15 @@ size_t add_new_groups(struct file_entry **fe, econf_file *uf, econf_file *ef,
 /* Returns the default dirs to iterate through when merging */
 char **get_default_dirs(const char *usr_conf_dir, const char *etc_conf_dir);
 
-/* Receives a list of config directories to look for and calls 'check_conf_dir' */
-econf_err traverse_conf_dirs(econf_file ***key_files, const char *conf_dirs[],
-                              size_t *size, const char *path, 
-                              const char *config_suffix,
-                              const char *delim, const char *comment);
+/* Read the drop-in files with the given suffix of the directories. A
+   file replaces the files with the same name in the directories before,
+   e.g. /etc/example.conf.d/50-foo.conf replaces
+   /usr/etc/example.conf.d/50-foo.conf, which is not read. */
+econf_err read_drop_in_dirs(econf_file ***key_files, size_t *size,
+                            char **dirs, size_t dirs_length,
+                            const char *config_suffix,
+                            const char *delim, const char *comment,
+                            const econf_options *options);
 
 /* Merge an array of given econf_files into one */
 econf_err merge_econf_files(econf_file **key_files, econf_file **merged_files);
@@ -0,0 +1,88 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "options.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/* Default flags, -1 as long as the environment has not been checked */
+static atomic_int default_flags = -1;
+
+static unsigned int
+get_default_flags(void) {
+  int flags = atomic_load_explicit(&default_flags, memory_order_relaxed);
+
+  /* The environment is checked only once. Concurrent first calls
+     store the same value.  */
+  if (flags < 0) {
+    flags = getenv("ECONF_JOIN_SAME_ENTRIES") ? OPT_JOIN_SAME_ENTRIES : 0;
+    atomic_store_explicit(&default_flags, flags, memory_order_relaxed);
+  }
+  return flags;
+}
+
+unsigned int options_flags(const econf_options *options) {
+  return options ? options->flags : get_default_flags();
+}
+
+econf_err econf_newOptions(econf_options **result) {
+  if (result == NULL)
+    return ECONF_ERROR;
+
+  econf_options *options = alloc_malloc(sizeof(econf_options));
+  if (options == NULL)
+    return ECONF_NOMEM;
+  options->flags = get_default_flags();
+
+  *result = options;
+  return ECONF_SUCCESS;
+}
+
+econf_err econf_setOpt(econf_options *options, econf_option option,
+		       bool value) {
+  if (options == NULL)
+    return ECONF_ERROR;
+
+  switch (option) {
+  case ECONF_OPT_DISCARD_COMMENTS:
+  case ECONF_OPT_NO_MULTILINE:
+  case ECONF_OPT_JOIN_SAME_ENTRIES:
+  case ECONF_OPT_STATS:
+  case ECONF_OPT_PROFILE_LOOKUPS:
+    break;
+  default:
+    return ECONF_ERROR;
+  }
+
+  if (value)
+    options->flags |= 1u << option;
+  else
+    options->flags &= ~(1u << option);
+  return ECONF_SUCCESS;
+}
+
+void econf_freeOptions(econf_options *options) {
+  alloc_free(options);
+}
@@ -0,0 +1,42 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- options.h --- */
+
+#include "libeconf.h"
+
+/* Options of econf_readFileWithOptions(). Every econf_option is a bit
+   in flags.  */
+struct econf_options {
+  unsigned int flags;
+};
+
+#define OPT_DISCARD_COMMENTS (1u << ECONF_OPT_DISCARD_COMMENTS)
+#define OPT_NO_MULTILINE (1u << ECONF_OPT_NO_MULTILINE)
+#define OPT_JOIN_SAME_ENTRIES (1u << ECONF_OPT_JOIN_SAME_ENTRIES)
+#define OPT_STATS (1u << ECONF_OPT_STATS)
+#define OPT_PROFILE_LOOKUPS (1u << ECONF_OPT_PROFILE_LOOKUPS)
+
+/* Return the flags of options or the default flags if options is NULL.  */
+unsigned int options_flags(const econf_options *options);
@@ -0,0 +1,71 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- probes.h --- */
+
+/* Static tracepoints of the provider "libeconf" for perf, bpftrace and
+   systemtap, e.g.
+
+     bpftrace -e 'usdt:/usr/lib64/libeconf.so.0:libeconf:file__close
+                  { printf("%s %d\n", str(arg0), arg3); }'
+
+   file__open(path)
+   file__close(path, lines, error, ns)
+   store(path, line, group, key, append)
+   merge__start(usr_path, etc_path)
+   merge__end(entries, error, ns)
+   lookup__hit(group, key, entry)
+   lookup__miss(group, key)
+
+   The lookup probes only fire for the values read by the econf_get*Value
+   functions, not for the lookups done while changing or merging files.
+
+   The probes are compiled out if sys/sdt.h is not available. The
+   timestamps for the durations are only taken if the probes exist.  */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+#include "stats.h"
+
+#define PROBE1(name, a) DTRACE_PROBE1(libeconf, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(libeconf, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(libeconf, name, a, b, c)
+#define PROBE4(name, a, b, c, d) DTRACE_PROBE4(libeconf, name, a, b, c, d)
+#define PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(libeconf, name, a, b, c, d, e)
+#define PROBE_TIME() stats_now()
+
+#else
+
+#define PROBE1(name, a) do { (void) (a); } while (0)
+#define PROBE2(name, a, b) do { (void) (a); (void) (b); } while (0)
+#define PROBE3(name, a, b, c) \
+  do { (void) (a); (void) (b); (void) (c); } while (0)
+#define PROBE4(name, a, b, c, d) \
+  do { (void) (a); (void) (b); (void) (c); (void) (d); } while (0)
+#define PROBE5(name, a, b, c, d, e) \
+  do { (void) (a); (void) (b); (void) (c); (void) (d); (void) (e); } while (0)
+#define PROBE_TIME() ((uint64_t) 0)
+
+#endif
@@ -0,0 +1,93 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "scanner.h"
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static void
+add_class(struct scanner *scanner, const char *bytes, unsigned char class)
+{
+  for (; *bytes; bytes++)
+    scanner->class[(unsigned char) *bytes] |= class;
+}
+
+void
+scanner_init(struct scanner *scanner, const char *delim, const char *comment)
+{
+  memset(scanner, 0, sizeof(*scanner));
+  add_class(scanner, "\n", SCAN_NEWLINE);
+  add_class(scanner, delim, SCAN_DELIM);
+  add_class(scanner, comment, SCAN_COMMENT);
+  add_class(scanner, "\"", SCAN_QUOTE);
+  add_class(scanner, "[]", SCAN_BRACKET);
+  add_class(scanner, " \t\n\v\f\r", SCAN_SPACE);
+
+  /* Only a few bytes have a class, so collect them for every mask */
+  for (size_t c = 1; c < 256; c++) {
+    if (!scanner->class[c])
+      continue;
+    for (unsigned int mask = 1; mask < SCAN_CLASSES; mask++) {
+      struct scan_set *set = &scanner->sets[mask];
+      if (!(scanner->class[c] & mask) || set->length > SCAN_SET_MAX)
+	continue;
+      if (set->length < SCAN_SET_MAX)
+	set->bytes[set->length] = (unsigned char) c;
+      set->length++;
+    }
+  }
+}
+
+size_t
+scanner_find(const struct scanner *scanner, const char *buf, size_t length,
+	     unsigned int mask)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const struct scan_set *set = &scanner->sets[mask & (SCAN_CLASSES - 1)];
+  if (set->length <= SCAN_SET_MAX && length >= 16) {
+    __m128i needles[SCAN_SET_MAX];
+    for (size_t j = 0; j < set->length; j++)
+      needles[j] = _mm_set1_epi8((char) set->bytes[j]);
+
+    for (; i + 16 <= length; i += 16) {
+      __m128i data = _mm_loadu_si128((const __m128i *) (buf + i));
+      __m128i found = _mm_setzero_si128();
+      for (size_t j = 0; j < set->length; j++)
+	found = _mm_or_si128(found, _mm_cmpeq_epi8(data, needles[j]));
+      int bits = _mm_movemask_epi8(found);
+      if (bits)
+	return i + (size_t) __builtin_ctz((unsigned int) bits);
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    if (scanner->class[(unsigned char) buf[i]] & mask)
+      return i;
+  }
+  return length;
+}
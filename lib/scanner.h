@@ -0,0 +1,71 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- scanner.h --- */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* This file contains the scanner used by the parser to find the next
+   byte of a class in a line, e.g. the next delimiter or comment
+   character. The classes of all bytes are kept in a table, so every
+   byte is classified with one lookup instead of strchr() calls. Where
+   SSE2 is available 16 bytes are checked at once.  */
+
+#define SCAN_NEWLINE (1 << 0)
+#define SCAN_DELIM   (1 << 1)
+#define SCAN_COMMENT (1 << 2)
+#define SCAN_QUOTE   (1 << 3)
+#define SCAN_BRACKET (1 << 4)
+/* Same as isspace() in the C locale */
+#define SCAN_SPACE   (1 << 5)
+#define SCAN_CLASSES (1 << 6)
+
+/* Maximum number of bytes of a class combination which are compared
+   in parallel. Larger combinations are searched with the table only. */
+#define SCAN_SET_MAX 16
+
+struct scanner {
+  unsigned char class[256];
+  /* Bytes of every class combination */
+  struct scan_set {
+    unsigned char length;
+    unsigned char bytes[SCAN_SET_MAX];
+  } sets[SCAN_CLASSES];
+};
+
+/* Set up the class table for the given delimiters and comment characters */
+extern void scanner_init(struct scanner *scanner, const char *delim,
+			 const char *comment);
+
+/* Return the offset of the first byte of buf which belongs to one of
+   the classes in mask, or length if there is none.  */
+extern size_t scanner_find(const struct scanner *scanner, const char *buf,
+			   size_t length, unsigned int mask);
+
+static inline bool
+scanner_is(const struct scanner *scanner, char c, unsigned int mask)
+{
+  return scanner->class[(unsigned char) c] & mask;
+}
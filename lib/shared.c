@@ -0,0 +1,314 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "keyfile.h"
+#include "keyindex.h"
+#include "shared.h"
+#include "sources.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Append string to the strings of the configuration and return its
+   offset. If strings is NULL only the length is computed.  */
+static uint32_t
+put_string(char *strings, size_t *length, const char *string)
+{
+  if (string == NULL)
+    return SHARED_NULL;
+
+  size_t offset = *length, string_length = strlen(string) + 1;
+  if (strings)
+    memcpy(strings + offset, string, string_length);
+  *length += string_length;
+  return (uint32_t) offset;
+}
+
+/* Write the configuration to base and return its size. If base is NULL
+   only the size is computed. Returns 0 if the strings are too large for
+   32 bit offsets.  */
+static size_t
+serialize(const econf_file *kf, char *base)
+{
+  size_t entries = 0, sources = kf->sources ? kf->sources->length : 0;
+  for (size_t i = 0; i < kf->length; i++)
+    if (!kf->file_entry[i].deleted)
+      entries++;
+
+  size_t start = sizeof(struct shared_header) +
+    entries * sizeof(struct shared_entry) + sources * sizeof(uint32_t);
+  char *strings = base ? base + start : NULL;
+  struct shared_entry *se =
+    base ? (void *) (base + sizeof(struct shared_header)) : NULL;
+  uint32_t *source_paths = base ? (void *) (se + entries) : NULL;
+  size_t length = 0;
+
+  if (base) {
+    struct shared_header *header = (void *) base;
+    memset(header, 0, sizeof(struct shared_header));
+    memcpy(header->magic, SHARED_MAGIC, sizeof(header->magic));
+    header->version = SHARED_VERSION;
+    header->header_size = sizeof(struct shared_header);
+    header->entry_size = sizeof(struct shared_entry);
+    header->entries = entries;
+    header->sources = sources;
+    header->strings = start;
+    header->delimiter = kf->delimiter;
+    header->comment = kf->comment;
+    header->path = put_string(strings, &length, kf->path);
+  } else {
+    put_string(NULL, &length, kf->path);
+  }
+
+  for (size_t i = 0; i < sources; i++) {
+    uint32_t offset = put_string(strings, &length, kf->sources->paths[i]);
+    if (base)
+      source_paths[i] = offset;
+  }
+
+  /* The entries of a group follow each other, so every group is only
+     stored once.  */
+  const char *group = NULL;
+  uint32_t group_offset = SHARED_NULL;
+  for (size_t i = 0, n = 0; i < kf->length; i++) {
+    const struct file_entry *fe = &kf->file_entry[i];
+    if (fe->deleted)
+      continue;
+    if (group == NULL || strcmp(group, fe->group)) {
+      group = fe->group;
+      group_offset = put_string(strings, &length, group);
+    }
+    struct shared_entry entry = {
+      .line_number = fe->line_number,
+      .group = group_offset,
+      .key = put_string(strings, &length, fe->key),
+      .value = put_string(strings, &length, fe->value),
+      .comment_before_key = put_string(strings, &length, fe->comment_before_key),
+      .comment_after_value = put_string(strings, &length, fe->comment_after_value),
+      .source = (uint32_t) fe->source,
+    };
+    if (base)
+      se[n++] = entry;
+  }
+
+  /* The configuration ends with a 0 byte even without strings */
+  if (length == 0)
+    length = 1;
+  if (length >= SHARED_NULL)
+    return 0;
+  if (base) {
+    strings[length - 1] = '\0';
+    ((struct shared_header *) (void *) base)->size = start + length;
+  }
+  return start + length;
+}
+
+econf_err econf_publish(econf_file *kf, int *fd)
+{
+  econf_err error;
+
+  if (!kf || fd == NULL)
+    return ECONF_ERROR;
+  if ((error = key_file_normalize(kf)))
+    return error;
+
+  size_t size = serialize(kf, NULL);
+  if (size == 0)
+    return ECONF_ERROR;
+
+#ifdef MFD_ALLOW_SEALING
+  int memfd = memfd_create("econf", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0)
+    return ECONF_WRITEERROR;
+  if (ftruncate(memfd, (off_t) size) < 0)
+    goto error;
+  char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (base == MAP_FAILED)
+    goto error;
+  serialize(kf, base);
+  munmap(base, size);
+
+  /* Nobody can change the configuration after it has been published */
+  if (fcntl(memfd, F_ADD_SEALS,
+	    F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    goto error;
+  *fd = memfd;
+  return ECONF_SUCCESS;
+
+ error:
+  close(memfd);
+  return ECONF_WRITEERROR;
+#else
+  /* memfd_create() is not available */
+  return ECONF_ERROR;
+#endif
+}
+
+static bool
+valid_offset(const struct shared_header *header, uint32_t offset)
+{
+  return offset == SHARED_NULL || offset < header->size - header->strings;
+}
+
+static bool
+valid_header(const struct shared_header *header, size_t size)
+{
+  const size_t header_size = sizeof(struct shared_header);
+  const size_t entry_size = sizeof(struct shared_entry);
+
+  if (memcmp(header->magic, SHARED_MAGIC, sizeof(header->magic)) ||
+      header->version != SHARED_VERSION ||
+      header->header_size != header_size ||
+      header->entry_size != entry_size || header->size != size)
+    return false;
+  /* Checked one after the other, so nothing can overflow */
+  if (header->entries > (size - header_size) / entry_size ||
+      header->sources > (size - header_size - header->entries * entry_size) /
+      sizeof(uint32_t))
+    return false;
+  return header->strings == header_size + header->entries * entry_size +
+    header->sources * sizeof(uint32_t) && header->strings < size &&
+    valid_offset(header, header->path);
+}
+
+econf_err econf_attach(econf_file **result, int fd)
+{
+  struct stat st;
+  econf_err error;
+
+  if (result == NULL || fd < 0)
+    return ECONF_ERROR;
+  *result = NULL;
+
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+      (size_t) st.st_size <= sizeof(struct shared_header))
+    return ECONF_ERROR;
+#ifdef F_GET_SEALS
+  /* The mapping is shared, so a configuration which can still be changed
+     or shrunk by somebody else could change under the readers or let
+     them crash with SIGBUS. Only sealed memory files are accepted; files
+     which do not support seals, like regular files, are not.  */
+  int seals = fcntl(fd, F_GET_SEALS);
+  if (seals < 0 ||
+      (seals & (F_SEAL_WRITE | F_SEAL_SHRINK)) != (F_SEAL_WRITE | F_SEAL_SHRINK))
+    return ECONF_ERROR;
+#else
+  /* Without seals it cannot be checked that fd will not change */
+  return ECONF_ERROR;
+#endif
+
+  size_t size = (size_t) st.st_size;
+  char *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return errno == ENOMEM ? ECONF_NOMEM : ECONF_ERROR;
+  const struct shared_header *header = (void *) base;
+  if (!valid_header(header, size) || base[size - 1] != '\0') {
+    munmap(base, size);
+    return ECONF_ERROR;
+  }
+
+  econf_file *kf = alloc_calloc(1, sizeof(econf_file));
+  if (kf == NULL) {
+    munmap(base, size);
+    return ECONF_NOMEM;
+  }
+  kf->shared = base;
+  kf->shared_size = size;
+  kf->delimiter = header->delimiter;
+  kf->comment = header->comment;
+
+  char *strings = base + header->strings;
+  const struct shared_entry *se =
+    (const void *) (base + sizeof(struct shared_header));
+  const uint32_t *source_paths = (const void *) (se + header->entries);
+  size_t *sources = NULL;
+
+  if (header->path != SHARED_NULL &&
+      (kf->path = alloc_strdup(strings + header->path)) == NULL)
+    goto nomem;
+
+  /* Sources of the configuration -> sources of kf */
+  if (header->sources) {
+    sources = alloc_malloc(header->sources * sizeof(size_t));
+    if (sources == NULL)
+      goto nomem;
+  }
+  for (size_t i = 0; i < header->sources; i++) {
+    if (source_paths[i] == SHARED_NULL || !valid_offset(header, source_paths[i]))
+      goto invalid;
+    if ((error = source_table_add(kf, strings + source_paths[i], &sources[i])))
+      goto failed;
+  }
+
+  if ((error = key_file_reserve(kf, header->entries)))
+    goto failed;
+  for (size_t i = 0; i < header->entries; i++) {
+    struct file_entry *fe = &kf->file_entry[i];
+    if (se[i].group == SHARED_NULL || se[i].key == SHARED_NULL ||
+	!valid_offset(header, se[i].group) || !valid_offset(header, se[i].key) ||
+	!valid_offset(header, se[i].value) ||
+	!valid_offset(header, se[i].comment_before_key) ||
+	!valid_offset(header, se[i].comment_after_value) ||
+	se[i].source > header->sources)
+      goto invalid;
+#define SHARED_STRING(offset) \
+    ((offset) == SHARED_NULL ? NULL : strings + (offset))
+    fe->group = strings + se[i].group;
+    fe->key = strings + se[i].key;
+    fe->value = SHARED_STRING(se[i].value);
+    fe->comment_before_key = SHARED_STRING(se[i].comment_before_key);
+    fe->comment_after_value = SHARED_STRING(se[i].comment_after_value);
+#undef SHARED_STRING
+    fe->line_number = se[i].line_number;
+    fe->source = se[i].source ? sources[se[i].source - 1] : 0;
+  }
+  kf->length = header->entries;
+  alloc_free(sources);
+  sources = NULL;
+  if ((error = index_build(kf)))
+    goto failed;
+
+  *result = kf;
+  return ECONF_SUCCESS;
+
+ invalid:
+  error = ECONF_ERROR;
+  goto failed;
+ nomem:
+  error = ECONF_NOMEM;
+ failed:
+  alloc_free(sources);
+  econf_freeFile(kf);
+  return error;
+}
+
+void shared_release(econf_file *kf) {
+  if (kf->shared)
+    munmap(kf->shared, kf->shared_size);
+  kf->shared = NULL;
+}
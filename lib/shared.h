@@ -0,0 +1,78 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- shared.h --- */
+
+#include <stdint.h>
+
+#include "libeconf.h"
+#include "keyfile.h"
+
+/* This file contains the format of a configuration which has been
+   published by econf_publish(). It is position independent, so every
+   process can map it at another address:
+
+     struct shared_header
+     struct shared_entry entries[header.entries]
+     uint32_t sources[header.sources]  offsets of the source paths
+     strings                           terminated by 0, the last byte of
+                                       the configuration is 0
+
+   All offsets are relative to the start of the strings and
+   SHARED_NULL marks a NULL pointer. The configuration is only read by
+   the same host, so the numbers are stored in native byte order.
+
+   econf_attach() builds an econf_file whose entries point into the
+   mapping. Only the file_entry array, the index and the caches are
+   allocated by every process. Such a file cannot be changed: the
+   functions which would change a string return ECONF_ERROR.  */
+
+#define SHARED_MAGIC "ECONFSHM"
+#define SHARED_VERSION 1
+#define SHARED_NULL UINT32_MAX
+
+struct shared_header {
+  char magic[8];
+  uint32_t version;
+  /* Size of the structures. Mappings of other builds are rejected.  */
+  uint16_t header_size, entry_size;
+  uint64_t size;
+  uint64_t entries, sources;
+  /* Offset of the strings from the start of the configuration */
+  uint64_t strings;
+  uint32_t path;
+  char delimiter, comment;
+};
+
+struct shared_entry {
+  uint64_t line_number;
+  uint32_t group, key, value;
+  uint32_t comment_before_key, comment_after_value;
+  /* Index into sources + 1, 0 if the entry has not been read from a
+     file, see file_entry.source.  */
+  uint32_t source;
+};
+
+/* Release the mapping of a file created by econf_attach().  */
+void shared_release(econf_file *key_file);
@@ -0,0 +1,122 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "sources.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+econf_err source_table_add(econf_file *kf, const char *path, size_t *source) {
+  struct source_table *table = kf->sources;
+
+  if (table == NULL) {
+    table = alloc_calloc(1, sizeof(struct source_table));
+    if (table == NULL)
+      return ECONF_NOMEM;
+    table->refcount = 1;
+    kf->sources = table;
+  }
+
+  /* Only a few files are merged, so the paths are searched linearly */
+  for (size_t i = 0; i < table->length; i++) {
+    if (!strcmp(table->paths[i], path)) {
+      *source = i + 1;
+      return ECONF_SUCCESS;
+    }
+  }
+
+  if (table->length == table->alloc_length) {
+    size_t alloc_length = table->alloc_length ? table->alloc_length * 2 : 4;
+    char **tmp = alloc_realloc(table->paths, alloc_length * sizeof(char *));
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    table->paths = tmp;
+    table->alloc_length = alloc_length;
+  }
+  if ((table->paths[table->length] = alloc_strdup(path)) == NULL)
+    return ECONF_NOMEM;
+  *source = ++table->length;
+  return ECONF_SUCCESS;
+}
+
+econf_err source_table_share(econf_file *to, econf_file *from) {
+  struct source_table *table = from->sources;
+  econf_err error;
+
+  if (table == NULL || table == to->sources)
+    return ECONF_SUCCESS;
+
+  size_t *map = alloc_malloc(table->length * sizeof(size_t));
+  if (map == NULL)
+    return ECONF_NOMEM;
+  for (size_t i = 0; i < table->length; i++) {
+    if ((error = source_table_add(to, table->paths[i], &map[i]))) {
+      alloc_free(map);
+      return error;
+    }
+  }
+
+  for (size_t i = 0; i < from->length; i++) {
+    struct file_entry *fe = &from->file_entry[i];
+    if (fe->source)
+      fe->source = map[fe->source - 1];
+  }
+  alloc_free(map);
+
+  source_table_release(table);
+  from->sources = source_table_ref(to->sources);
+  return ECONF_SUCCESS;
+}
+
+struct source_table *source_table_ref(struct source_table *table) {
+  if (table)
+    table->refcount++;
+  return table;
+}
+
+void source_table_release(struct source_table *table) {
+  if (table == NULL || --table->refcount)
+    return;
+  for (size_t i = 0; i < table->length; i++)
+    alloc_free(table->paths[i]);
+  alloc_free(table->paths);
+  alloc_free(table);
+}
+
+const char *source_path(const econf_file *kf, size_t source) {
+  if (source == 0 || kf->sources == NULL || source > kf->sources->length)
+    return NULL;
+  return kf->sources->paths[source - 1];
+}
+
+size_t source_table_memory_usage(const struct source_table *table) {
+  if (table == NULL)
+    return 0;
+
+  size_t size = sizeof(struct source_table) +
+    table->alloc_length * sizeof(char *);
+  for (size_t i = 0; i < table->length; i++)
+    size += strlen(table->paths[i]) + 1;
+  return size;
+}
@@ -0,0 +1,66 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- sources.h --- */
+
+#include "libeconf.h"
+#include "keyfile.h"
+
+/* This file contains the table of the files the entries of an econf_file
+   have been read from. An entry refers to its file by file_entry.source,
+   which is the index of the path in the table + 1. 0 means that the
+   entry has not been read from a file.
+
+   Paths are interned, so every file is stored only once. The table only
+   grows and the indices never change, so it is shared by reference
+   counting: a merged file uses the table of the file it has been merged
+   from and appends the paths of the other one.  */
+struct source_table {
+  size_t refcount;
+  char **paths;
+  size_t length, alloc_length;
+};
+
+/* Return the source of path in the table of key_file. The path is added
+   if it is not in the table yet and the table is created if needed.  */
+econf_err source_table_add(econf_file *key_file, const char *path,
+			   size_t *source);
+
+/* Let the entries of from refer to the table of to. The paths of from are
+   added to the table of to and the sources of its entries are changed
+   accordingly.  */
+econf_err source_table_share(econf_file *to, econf_file *from);
+
+/* Take a reference of table, which can be NULL.  */
+struct source_table *source_table_ref(struct source_table *table);
+
+/* Drop a reference of table, which can be NULL.  */
+void source_table_release(struct source_table *table);
+
+/* Allocated bytes of table, which can be NULL. A shared table is counted
+   in full.  */
+size_t source_table_memory_usage(const struct source_table *table);
+
+/* Return the path of source or NULL if it is 0.  */
+const char *source_path(const econf_file *key_file, size_t source);
@@ -0,0 +1,112 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "stats.h"
+
+#include <string.h>
+#include <time.h>
+
+uint64_t stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+static econf_err
+append_file(struct load_stats **stats, const econf_file_stats *file) {
+  struct load_stats *s = *stats;
+
+  if (s == NULL) {
+    s = alloc_calloc(1, sizeof(struct load_stats));
+    if (s == NULL)
+      return ECONF_NOMEM;
+    *stats = s;
+  }
+  if (s->total.file_stats_length == s->alloc_length) {
+    size_t alloc_length = s->alloc_length ? s->alloc_length * 2 : 4;
+    econf_file_stats *tmp =
+      alloc_realloc(s->files, alloc_length * sizeof(econf_file_stats));
+    if (tmp == NULL)
+      return ECONF_NOMEM;
+    s->files = tmp;
+    s->total.file_stats = tmp;
+    char **paths = alloc_realloc(s->paths, alloc_length * sizeof(char *));
+    if (paths == NULL)
+      return ECONF_NOMEM;
+    s->paths = paths;
+    s->alloc_length = alloc_length;
+  }
+
+  size_t num = s->total.file_stats_length;
+  char *path = alloc_strdup(file->path);
+  if (path == NULL)
+    return ECONF_NOMEM;
+  s->paths[num] = path;
+  s->files[num] = *file;
+  s->files[num].path = path;
+  s->total.file_stats_length++;
+
+  s->total.files++;
+  s->total.bytes += file->bytes;
+  s->total.lines += file->lines;
+  s->total.entries += file->entries;
+  s->total.allocations += file->allocations;
+  s->total.parse_ns += file->parse_ns;
+  s->total.join_ns += file->join_ns;
+  s->total.total_ns += file->parse_ns + file->join_ns;
+  return ECONF_SUCCESS;
+}
+
+econf_err stats_add_file(econf_file *kf, const econf_file_stats *file) {
+  return append_file(&kf->stats, file);
+}
+
+econf_err stats_append(struct load_stats **to, const struct load_stats *from) {
+  econf_err error;
+
+  if (from == NULL)
+    return ECONF_SUCCESS;
+  for (size_t i = 0; i < from->total.file_stats_length; i++) {
+    if ((error = append_file(to, &from->files[i])))
+      return error;
+  }
+  return ECONF_SUCCESS;
+}
+
+void stats_free(struct load_stats *stats) {
+  if (stats == NULL)
+    return;
+  for (size_t i = 0; i < stats->total.file_stats_length; i++)
+    alloc_free(stats->paths[i]);
+  alloc_free(stats->paths);
+  alloc_free(stats->files);
+  alloc_free(stats);
+}
+
+econf_err econf_getStats(econf_file *kf, econf_stats *stats) {
+  if (kf == NULL || stats == NULL || kf->stats == NULL)
+    return ECONF_ERROR;
+  *stats = kf->stats->total;
+  return ECONF_SUCCESS;
+}
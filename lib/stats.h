@@ -0,0 +1,50 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+#pragma once
+
+/* --- stats.h --- */
+
+#include "libeconf.h"
+#include "libeconf_ext.h"
+#include "keyfile.h"
+
+/* Statistics of an econf_file which has been loaded with OPT_STATS.
+   total.file_stats points to files. paths owns the paths of files.  */
+struct load_stats {
+  econf_stats total;
+  econf_file_stats *files;
+  char **paths;
+  size_t alloc_length;
+};
+
+/* Monotonic time in nanoseconds */
+uint64_t stats_now(void);
+
+/* Append the statistics of one file to the statistics of key_file and
+   add them to the totals. The statistics are created if needed.  */
+econf_err stats_add_file(econf_file *key_file, const econf_file_stats *file);
+
+/* Append all files of from to to. from can be NULL.  */
+econf_err stats_append(struct load_stats **to, const struct load_stats *from);
+
+void stats_free(struct load_stats *stats);
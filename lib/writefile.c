@@ -0,0 +1,440 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+
+#include "libeconf.h"
+#include "alloc.h"
+#include "defines.h"
+#include "helpers.h"
+#include "keyindex.h"
+#include "writefile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Makes the names of temporary files unique within a process */
+static atomic_uint tmp_counter;
+
+/* Growing buffer for the serialized file. It is allocated with
+   alloc_realloc(), so the hooks of econf_setAllocator() see it, unlike
+   a buffer of open_memstream(). A failed allocation is remembered and
+   reported by out_finish().  */
+struct out {
+  char *data;
+  size_t length, alloc_length;
+  bool failed;
+};
+
+static void out_write(struct out *out, const char *data, size_t length) {
+  if (out->failed || length == 0)
+    return;
+  if (out->alloc_length - out->length < length) {
+    size_t alloc_length = out->alloc_length ? out->alloc_length : 4096;
+    while (alloc_length - out->length < length)
+      alloc_length *= 2;
+    char *tmp = alloc_realloc(out->data, alloc_length);
+    if (tmp == NULL) {
+      out->failed = true;
+      return;
+    }
+    out->data = tmp;
+    out->alloc_length = alloc_length;
+  }
+  memcpy(out->data + out->length, data, length);
+  out->length += length;
+}
+
+static void out_putc(struct out *out, char c) {
+  out_write(out, &c, 1);
+}
+
+static void out_puts(struct out *out, const char *string) {
+  out_write(out, string, strlen(string));
+}
+
+// Hand the buffer over to the caller or release it after a failure
+static econf_err out_finish(struct out *out, char **data, size_t *length) {
+  if (out->failed) {
+    alloc_free(out->data);
+    return ECONF_NOMEM;
+  }
+  *data = out->data;
+  *length = out->length;
+  return ECONF_SUCCESS;
+}
+
+econf_err serialize_key_file(econf_file *kf, char **data, size_t *length) {
+  struct out out_buffer = { 0 }, *out = &out_buffer;
+
+  for (size_t i = 0; i < kf->length; i++) {
+    struct file_entry *fe = &kf->file_entry[i];
+    if (!i || strcmp(kf->file_entry[i - 1].group, fe->group)) {
+      if (i)
+        out_putc(out, '\n');
+      if (strcmp(fe->group, KEY_FILE_NULL_VALUE)) {
+        out_puts(out, fe->group);
+        out_putc(out, '\n');
+      }
+    }
+    out_puts(out, fe->key);
+    out_putc(out, kf->delimiter);
+    if (fe->value)
+      out_puts(out, fe->value);
+    out_putc(out, '\n');
+  }
+
+  return out_finish(out, data, length);
+}
+
+// Write an entry which is not part of source or cannot be patched in place
+static void render_entry(struct out *out, econf_file *kf, struct file_entry *fe) {
+  out_puts(out, fe->key);
+  out_putc(out, kf->delimiter);
+  if (fe->value)
+    out_puts(out, fe->value);
+  if (fe->span_end && fe->comment_after_value &&
+      !strchr(fe->comment_after_value, '\n')) {
+    out_putc(out, ' ');
+    out_putc(out, kf->comment);
+    out_puts(out, fe->comment_after_value);
+  }
+  out_putc(out, '\n');
+}
+
+// Write an entry which has been read from source
+static void patch_entry(struct out *out, econf_file *kf, struct file_entry *fe) {
+  if (!fe->modified) {
+    out_write(out, kf->source + fe->span_start, fe->span_end - fe->span_start);
+  } else if (fe->value_start) {
+    out_write(out, kf->source + fe->span_start,
+	      fe->value_start - fe->span_start);
+    if (fe->value)
+      out_puts(out, fe->value);
+    out_write(out, kf->source + fe->value_end, fe->span_end - fe->value_end);
+  } else {
+    render_entry(out, kf, fe);
+  }
+}
+
+// Write all entries of group gi which are not part of source
+static void render_new_entries(struct out *out, econf_file *kf,
+			       struct group_index *gi) {
+  for (size_t i = 0; i < gi->length; i++) {
+    struct file_entry *fe = &kf->file_entry[gi->entries[i]];
+    if (!fe->deleted && !fe->span_end)
+      render_entry(out, kf, fe);
+  }
+}
+
+/* Part of source which is written by patch_entry() or skipped if num is
+   SIZE_MAX. */
+struct segment {
+  size_t start, end, num;
+};
+
+static int segment_cmp(const void *a, const void *b) {
+  const struct segment *sa = a, *sb = b;
+  return (sa->start > sb->start) - (sa->start < sb->start);
+}
+
+econf_err serialize_key_file_lossless(econf_file *kf, char **data,
+				      size_t *length) {
+  if (kf->source == NULL)
+    return serialize_key_file(kf, data, length);
+
+  struct econf_index *idx = kf->index;
+  if (idx == NULL)
+    return ECONF_ERROR;
+
+  /* New entries are written after the last entry of their group found
+     in source. anchor contains the group number for these entries.  */
+  size_t *anchor = alloc_malloc((kf->length ? kf->length : 1) * sizeof(size_t));
+  struct segment *segments =
+    alloc_malloc((kf->length + kf->removed_spans_length + 1) * sizeof(struct segment));
+  if (anchor == NULL || segments == NULL) {
+    alloc_free(anchor);
+    alloc_free(segments);
+    return ECONF_NOMEM;
+  }
+  for (size_t i = 0; i < kf->length; i++)
+    anchor[i] = SIZE_MAX;
+
+  /* Groups with new entries but without entries in source */
+  bool new_groups = false;
+  size_t none_group = SIZE_MAX;
+  for (size_t i = 0; i < idx->groups_length; i++) {
+    struct group_index *gi = &idx->groups[i];
+    size_t last = SIZE_MAX;
+    bool has_new = false;
+    for (size_t j = 0; j < gi->length; j++) {
+      struct file_entry *fe = &kf->file_entry[gi->entries[j]];
+      if (fe->deleted)
+	continue;
+      if (!fe->span_end)
+	has_new = true;
+      else if (last == SIZE_MAX ||
+	       fe->span_start > kf->file_entry[last].span_start)
+	last = gi->entries[j];
+    }
+    if (!has_new)
+      continue;
+    if (last != SIZE_MAX)
+      anchor[last] = i;
+    else if (!strcmp(gi->name, KEY_FILE_NULL_VALUE))
+      none_group = i;
+    else
+      new_groups = true;
+  }
+
+  size_t n = 0;
+  bool sorted = true;
+  for (size_t i = 0; i < kf->length; i++) {
+    struct file_entry *fe = &kf->file_entry[i];
+    if (fe->deleted || !fe->span_end)
+      continue;
+    segments[n].start = fe->span_start;
+    segments[n].end = fe->span_end;
+    segments[n].num = i;
+    if (n && segments[n - 1].start > fe->span_start)
+      sorted = false;
+    n++;
+  }
+  for (size_t i = 0; i < kf->removed_spans_length; i++) {
+    segments[n].start = kf->removed_spans[i].start;
+    segments[n].end = kf->removed_spans[i].end;
+    segments[n].num = SIZE_MAX;
+    if (n && segments[n - 1].start > segments[n].start)
+      sorted = false;
+    n++;
+  }
+  if (!sorted)
+    qsort(segments, n, sizeof(struct segment), segment_cmp);
+
+  struct out out_buffer = { 0 }, *out = &out_buffer;
+
+  /* Keys without group have to be written before the first group */
+  if (none_group != SIZE_MAX)
+    render_new_entries(out, kf, &idx->groups[none_group]);
+
+  size_t cursor = 0;
+  for (size_t i = 0; i < n; i++) {
+    out_write(out, kf->source + cursor, segments[i].start - cursor);
+    cursor = segments[i].end;
+    if (segments[i].num == SIZE_MAX)
+      continue;
+    struct file_entry *fe = &kf->file_entry[segments[i].num];
+    patch_entry(out, kf, fe);
+    if (anchor[segments[i].num] != SIZE_MAX) {
+      if (kf->source[fe->span_end - 1] != '\n')
+	out_putc(out, '\n');
+      render_new_entries(out, kf, &idx->groups[anchor[segments[i].num]]);
+    }
+  }
+  out_write(out, kf->source + cursor, kf->source_length - cursor);
+
+  if (new_groups) {
+    if (kf->source_length && kf->source[kf->source_length - 1] != '\n')
+      out_putc(out, '\n');
+    for (size_t i = 0; i < idx->groups_length; i++) {
+      struct group_index *gi = &idx->groups[i];
+      if (i == none_group || !strcmp(gi->name, KEY_FILE_NULL_VALUE))
+	continue;
+      bool in_source = false, has_new = false;
+      for (size_t j = 0; j < gi->length; j++) {
+	struct file_entry *fe = &kf->file_entry[gi->entries[j]];
+	if (fe->deleted)
+	  continue;
+	if (fe->span_end)
+	  in_source = true;
+	else
+	  has_new = true;
+      }
+      if (in_source || !has_new)
+	continue;
+      out_putc(out, '\n');
+      out_puts(out, gi->name);
+      out_putc(out, '\n');
+      render_new_entries(out, kf, gi);
+    }
+  }
+
+  alloc_free(anchor);
+  alloc_free(segments);
+  return out_finish(out, data, length);
+}
+
+static econf_err write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t ret = write(fd, data, length);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      return ECONF_WRITEERROR;
+    }
+    data += ret;
+    length -= (size_t) ret;
+  }
+  return ECONF_SUCCESS;
+}
+
+// Flush the directory entry of path to disk
+static econf_err sync_parent_dir(const char *path) {
+  char *dir = alloc_strdup(path);
+  if (dir == NULL)
+    return ECONF_NOMEM;
+  char *slash = strrchr(dir, '/');
+  if (slash == dir)
+    slash[1] = '\0';
+  else if (slash)
+    *slash = '\0';
+
+  int fd = open(slash ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  alloc_free(dir);
+  if (fd < 0)
+    return ECONF_WRITEERROR;
+  int ret = fsync(fd);
+  close(fd);
+  return ret ? ECONF_WRITEERROR : ECONF_SUCCESS;
+}
+
+/* Overwrite the existing file path. Used if the replacement cannot get
+   the owner of the file, e.g. a group writable file of another user,
+   which was written in place like this before.  */
+static econf_err write_file_in_place(const char *path, const char *data,
+				     size_t length, int flags) {
+  int fd = open(path, O_WRONLY | O_TRUNC | O_CLOEXEC);
+  if (fd < 0)
+    return ECONF_WRITEERROR;
+  econf_err error = write_all(fd, data, length);
+  if (!error && (flags & ECONF_WRITE_SYNC) && fsync(fd))
+    error = ECONF_WRITEERROR;
+  if (close(fd) && !error)
+    error = ECONF_WRITEERROR;
+  return error;
+}
+
+econf_err write_file_atomic(const char *dir, const char *file_name,
+			    const char *data, size_t length, int flags) {
+  econf_err error = ECONF_WRITEERROR;
+  struct stat st;
+  int fd = -1;
+
+  // Check if the directory exists
+  if (stat(dir, &st) || !S_ISDIR(st.st_mode))
+    return ECONF_NOFILE;
+
+  char *path = combine_strings(dir, file_name, '/');
+  if (path == NULL)
+    return ECONF_NOMEM;
+
+  /* rename() would replace a symbolic link by a regular file, so the
+     file it points to is written instead, like fopen() did. A dangling
+     link is refused.  */
+  if (lstat(path, &st) == 0 && S_ISLNK(st.st_mode)) {
+    char target[PATH_MAX];
+    bool resolved = realpath(path, target) != NULL;
+    alloc_free(path);
+    if (!resolved)
+      return ECONF_WRITEERROR;
+    if ((path = alloc_strdup(target)) == NULL)
+      return ECONF_NOMEM;
+  }
+
+  /* The temporary file is created with O_EXCL instead of mkstemp(), so
+     the umask is applied to new files the same way as with fopen().  */
+  char *tmp_path = NULL;
+  for (int i = 0; fd < 0 && i < 100; i++) {
+    alloc_free(tmp_path);
+    if (alloc_asprintf(&tmp_path, "%s.%ld.%u", path, (long) getpid(),
+		 atomic_fetch_add(&tmp_counter, 1)) < 0) {
+      alloc_free(path);
+      return ECONF_NOMEM;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0 && errno != EEXIST)
+      break;
+  }
+  /* A writable file in a directory of another user */
+  if (fd < 0 && errno == EACCES && stat(path, &st) == 0 &&
+      S_ISREG(st.st_mode)) {
+    error = write_file_in_place(path, data, length, flags);
+    goto out;
+  }
+  if (fd < 0)
+    goto out;
+
+  /* Keep the owner and the permissions of the file which is replaced.
+     fchown() clears the set-user-ID bits, so it comes first. Only the
+     owner of the new file or root may change it; other users who may
+     write the file overwrite it in place instead.  */
+  if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+    struct stat tmp_st;
+    if (fstat(fd, &tmp_st))
+      goto fail;
+    if ((tmp_st.st_uid != st.st_uid || tmp_st.st_gid != st.st_gid) &&
+	fchown(fd, st.st_uid, st.st_gid)) {
+      if (errno != EPERM)
+	goto fail;
+      close(fd);
+      fd = -1;
+      unlink(tmp_path);
+      error = write_file_in_place(path, data, length, flags);
+      goto out;
+    }
+    if (fchmod(fd, st.st_mode & 07777))
+      goto fail;
+  }
+
+  if ((error = write_all(fd, data, length)))
+    goto fail;
+  if ((flags & ECONF_WRITE_SYNC) && fsync(fd)) {
+    error = ECONF_WRITEERROR;
+    goto fail;
+  }
+  int ret = close(fd);
+  fd = -1;
+  if (ret || rename(tmp_path, path)) {
+    error = ECONF_WRITEERROR;
+    goto fail;
+  }
+  error = ECONF_SUCCESS;
+  if (flags & ECONF_WRITE_SYNC)
+    error = sync_parent_dir(path);
+  goto out;
+
+ fail:
+  if (fd >= 0)
+    close(fd);
+  unlink(tmp_path);
+ out:
+  alloc_free(tmp_path);
+  alloc_free(path);
+  return error;
+}
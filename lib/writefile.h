@@ -0,0 +1,58 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+
+#pragma once
+
+/* --- writefile.h --- */
+
+#include "libeconf.h"
+#include "keyfile.h"
+
+#include <stddef.h>
+
+/* This file contains the functions used by econf_writeFile to serialize
+   an econf_file and to replace the destination file atomically.  */
+
+/* Serialize all entries of key_file into a newly allocated buffer which
+   has to be released by the caller with alloc_free(). The buffer is
+   NULL if the file is empty. key_file has to be normalized.  */
+econf_err serialize_key_file(econf_file *key_file, char **data, size_t *length);
+
+/* Same as serialize_key_file(), but the content of the file which has
+   been read into key_file is kept. Entries which have not been changed
+   are copied from there, only modified values are replaced. New entries
+   are added after the last entry of their group. Falls back to
+   serialize_key_file() if key_file has not been read from a file.  */
+econf_err serialize_key_file_lossless(econf_file *key_file, char **data,
+				      size_t *length);
+
+/* Write length bytes of data into a temporary file in dir and rename it
+   to file_name afterwards, so readers either see the old or the new
+   content. The permissions, owner and group of an existing file are kept.
+   If the temporary file cannot be created or cannot get the owner of
+   the file, e.g. for a writable file of another user, the file is
+   overwritten in place instead. A symbolic link is resolved first, so the file it points to is
+   replaced. With ECONF_WRITE_SYNC the file and the directory are flushed
+   to disk.  */
+econf_err write_file_atomic(const char *dir, const char *file_name,
+			    const char *data, size_t length, int flags);
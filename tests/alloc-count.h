@@ -0,0 +1,86 @@
+/* Count the allocations of libeconf during specific calls.
+
+   The allocations are counted by an allocator installed with
+   econf_setAllocator(), which passes all requests on to malloc(),
+   realloc() and free() of the C library. Memory returned by the library
+   can still be released with free() therefore. Allocations which are
+   done by the C library itself, e.g. by fopen(), are not counted. This
+   header is used by the tests and the benchmarks and must be included
+   by exactly one file of a program.
+
+   Usage:
+     alloc_count_start();
+     ... libeconf calls ...
+     struct alloc_count count = alloc_count_stop();
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "libeconf.h"
+
+struct alloc_count {
+  /* Calls of allocate */
+  size_t mallocs;
+  /* Calls of reallocate */
+  size_t reallocs;
+  /* Calls of release */
+  size_t frees;
+  /* Requested bytes of all allocations */
+  size_t bytes;
+};
+
+static bool alloc_counting;
+static struct alloc_count alloc_counted;
+
+static void *
+alloc_count_allocate(size_t size, void *data __attribute__((unused)))
+{
+  if (alloc_counting) {
+    alloc_counted.mallocs++;
+    alloc_counted.bytes += size;
+  }
+  return malloc(size);
+}
+
+static void *
+alloc_count_reallocate(void *ptr, size_t size,
+		       void *data __attribute__((unused)))
+{
+  if (alloc_counting) {
+    alloc_counted.reallocs++;
+    alloc_counted.bytes += size;
+  }
+  return realloc(ptr, size);
+}
+
+static void
+alloc_count_release(void *ptr, void *data __attribute__((unused)))
+{
+  if (alloc_counting)
+    alloc_counted.frees++;
+  free(ptr);
+}
+
+/* The allocator is installed on the first call and stays installed, it
+   only stops counting.  */
+static void
+alloc_count_start(void)
+{
+  static const econf_allocator allocator = {
+    alloc_count_allocate, alloc_count_reallocate, alloc_count_release, NULL
+  };
+  econf_setAllocator(&allocator);
+  alloc_counted = (struct alloc_count) { 0 };
+  alloc_counting = true;
+}
+
+static struct alloc_count
+alloc_count_stop(void)
+{
+  alloc_counting = false;
+  return alloc_counted;
+}
@@ -0,0 +1,133 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+#include "alloc-count.h"
+
+/* Test case:
+   Lookups must not allocate memory apart from the returned copies.
+   Borrowed getters, typed getters of cached values, missing keys and
+   the iteration do not allocate at all once the caches have been filled
+   by the first call.
+*/
+
+static int
+check_budget(const char *what, struct alloc_count count, size_t mallocs)
+{
+  if (count.mallocs > mallocs || count.reallocs > 0)
+    {
+      fprintf (stderr, "ERROR: %s: %zu mallocs and %zu reallocs, "
+	       "expected at most %zu mallocs\n", what, count.mallocs,
+	       count.reallocs, mallocs);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_ext_value_view view;
+  econf_entry entry;
+  struct alloc_count count;
+  econf_err error;
+  int32_t ival;
+  bool bval;
+  char *sval;
+  int retval = 0;
+
+  error = econf_readFile (&key_file,
+			  TESTSDIR"tst-writefile3-data/test.conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't read configuration file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  econf_setIntValue(key_file, "numbers", "int", 42);
+  econf_setBoolValue(key_file, "numbers", "bool", "true");
+  econf_setStringValue(key_file, "strings", "lines", "one\ntwo\nthree");
+
+  /* The first calls fill the caches */
+  econf_getIntValue(key_file, "numbers", "int", &ival);
+  econf_getBoolValue(key_file, "numbers", "bool", &bval);
+  econf_getExtValueView(key_file, "strings", "lines", &view);
+
+  for (int i = 0; i < 100; i++)
+    {
+      alloc_count_start();
+      error = econf_getIntValue(key_file, "numbers", "int", &ival);
+      count = alloc_count_stop();
+      if (error || ival != 42)
+	{
+	  fprintf (stderr, "ERROR: wrong int value\n");
+	  return 1;
+	}
+      retval |= check_budget("econf_getIntValue", count, 0);
+
+      alloc_count_start();
+      error = econf_getBoolValue(key_file, "numbers", "bool", &bval);
+      count = alloc_count_stop();
+      if (error || !bval)
+	{
+	  fprintf (stderr, "ERROR: wrong bool value\n");
+	  return 1;
+	}
+      retval |= check_budget("econf_getBoolValue", count, 0);
+
+      alloc_count_start();
+      error = econf_getExtValueView(key_file, "strings", "lines", &view);
+      count = alloc_count_stop();
+      if (error || view.values_length != 3)
+	{
+	  fprintf (stderr, "ERROR: wrong view\n");
+	  return 1;
+	}
+      retval |= check_budget("econf_getExtValueView", count, 0);
+
+      alloc_count_start();
+      error = econf_getStringValue(key_file, "numbers", "missing", &sval);
+      count = alloc_count_stop();
+      if (error != ECONF_NOKEY)
+	{
+	  fprintf (stderr, "ERROR: missing key has been found\n");
+	  return 1;
+	}
+      retval |= check_budget("econf_getStringValue of a missing key", count, 0);
+
+      /* Only the returned copy is allocated */
+      alloc_count_start();
+      error = econf_getStringValue(key_file, "strings", "lines", &sval);
+      count = alloc_count_stop();
+      if (error)
+	{
+	  fprintf (stderr, "ERROR: couldn't get string\n");
+	  return 1;
+	}
+      free(sval);
+      retval |= check_budget("econf_getStringValue", count, 1);
+
+      size_t cursor = 0, entries = 0;
+      alloc_count_start();
+      while (econf_nextEntry(key_file, &cursor, &entry) == ECONF_SUCCESS)
+	entries++;
+      count = alloc_count_stop();
+      if (entries == 0)
+	{
+	  fprintf (stderr, "ERROR: no entries\n");
+	  return 1;
+	}
+      retval |= check_budget("econf_nextEntry", count, 0);
+
+      if (retval)
+	break;
+    }
+
+  econf_free(key_file);
+  return retval;
+}
@@ -0,0 +1,163 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+#include "alloc-count.h"
+
+/* Test case:
+   Parsing must allocate a bounded number of blocks per line. The parser
+   itself only allocates group names and comments, econf_readFile()
+   allocates the strings of an entry and grows its arrays geometrically.
+*/
+
+#define LINES 10000
+#define KEYS_PER_GROUP 50
+
+/* Blocks allocated independent of the number of lines */
+#define FIXED_BUDGET 64
+
+static econf_err
+count_entry(void *data, const econf_parse_entry *entry __attribute__((unused)))
+{
+  (*(size_t *) data)++;
+  return ECONF_SUCCESS;
+}
+
+struct content {
+  size_t groups, comments, entries;
+};
+
+/* Write LINES lines with groups, comments and values */
+static int
+generate(const char *path, struct content *content)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL)
+    return 1;
+  *content = (struct content) { 0 };
+  for (size_t line = 0; line < LINES; line++)
+    {
+      if (line % KEYS_PER_GROUP == 0)
+	fprintf(fp, "[group%zu]\n", content->groups++);
+      else if (line % 10 == 1)
+	{
+	  fprintf(fp, "# comment %zu\n", line);
+	  content->comments++;
+	}
+      else if (line % 10 == 2)
+	{
+	  fprintf(fp, "key%zu = \"quoted %zu\" # comment\n", line, line);
+	  content->comments++;
+	  content->entries++;
+	}
+      else
+	{
+	  fprintf(fp, "key%zu = %zu\n", line, line);
+	  content->entries++;
+	}
+    }
+  return fclose(fp) != 0;
+}
+
+static int
+check_budget(const char *what, struct alloc_count count, size_t mallocs,
+	     size_t reallocs)
+{
+  printf("%s: %zu mallocs, %zu reallocs, %zu bytes\n", what, count.mallocs,
+	 count.reallocs, count.bytes);
+  if (count.mallocs > mallocs || count.reallocs > reallocs)
+    {
+      fprintf (stderr, "ERROR: %s exceeds the budget of %zu mallocs and "
+	       "%zu reallocs\n", what, mallocs, reallocs);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  char path[] = "/tmp/tst-alloc2-XXXXXX";
+  econf_file *key_file;
+  econf_options *options;
+  econf_parse_callbacks callbacks = { .on_entry = count_entry };
+  struct alloc_count count;
+  struct content content;
+  size_t entries = 0;
+  econf_err error;
+  int retval = 0;
+
+  int fd = mkstemp(path);
+  if (fd < 0)
+    {
+      perror("mkstemp");
+      return 1;
+    }
+  close(fd);
+  if (generate(path, &content))
+    {
+      fprintf (stderr, "ERROR: couldn't write %s\n", path);
+      unlink(path);
+      return 1;
+    }
+
+  /* The parser allocates group names and comments and grows its line
+     buffer */
+  alloc_count_start();
+  error = econf_parseFile(path, "=", "#", &callbacks, &entries);
+  count = alloc_count_stop();
+  if (error || entries != content.entries)
+    {
+      fprintf (stderr, "ERROR: econf_parseFile: %s\n", econf_errString(error));
+      retval = 1;
+    }
+  retval |= check_budget("econf_parseFile", count,
+			 content.groups + content.comments + FIXED_BUDGET,
+			 FIXED_BUDGET);
+
+  /* Group, key and value of every entry, a copy of every comment and
+     the list of entries of every group in the index. Arrays grow
+     geometrically. */
+  alloc_count_start();
+  error = econf_readFile(&key_file, path, "=", "#");
+  count = alloc_count_stop();
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readFile: %s\n", econf_errString(error));
+      retval = 1;
+    }
+  else
+    econf_free(key_file);
+  retval |= check_budget("econf_readFile", count,
+			 3 * content.entries + 2 * content.groups +
+			 2 * content.comments + FIXED_BUDGET, FIXED_BUDGET);
+
+  /* Without comments no comment is allocated */
+  if (econf_newOptions(&options))
+    return 1;
+  econf_setOpt(options, ECONF_OPT_DISCARD_COMMENTS, true);
+  econf_setOpt(options, ECONF_OPT_NO_MULTILINE, true);
+  alloc_count_start();
+  error = econf_readFileWithOptions(&key_file, path, "=", "#", options);
+  count = alloc_count_stop();
+  econf_freeOptions(options);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readFileWithOptions: %s\n",
+	       econf_errString(error));
+      retval = 1;
+    }
+  else
+    econf_free(key_file);
+  retval |= check_budget("econf_readFileWithOptions", count,
+			 3 * content.entries + 2 * content.groups + FIXED_BUDGET,
+			 FIXED_BUDGET);
+
+  unlink(path);
+  return retval;
+}
@@ -0,0 +1,245 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   Install an allocator which marks its blocks and counts the blocks in
+   use. Reading, merging, modifying and writing files must only use this
+   allocator and must release all blocks again. Writing a file must not
+   call the allocator of the C library at all, which is checked by
+   replacing malloc() and friends where glibc allows it.
+*/
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && \
+  !defined(__SANITIZE_THREAD__)
+#define COUNT_LIBC_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void __libc_free(void *ptr);
+
+/* Calls of the C library allocator while libc_counting is set */
+static size_t libc_allocations;
+static int libc_counting;
+
+void *
+malloc(size_t size)
+{
+  libc_allocations += libc_counting;
+  return __libc_malloc(size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  libc_allocations += libc_counting;
+  return __libc_realloc(ptr, size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  libc_allocations += libc_counting;
+  return __libc_calloc(nmemb, size);
+}
+
+void
+free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+/* The arena itself is not counted */
+#define arena_malloc __libc_malloc
+#define arena_realloc __libc_realloc
+#define arena_free __libc_free
+#else
+#define arena_malloc malloc
+#define arena_realloc realloc
+#define arena_free free
+#endif
+
+#define MAGIC 0x65636f6eu
+
+struct arena {
+  size_t allocations, in_use;
+  int foreign;
+};
+
+/* Every block starts with a header containing the magic number */
+union header {
+  unsigned int magic;
+  max_align_t align;
+};
+
+static void *
+arena_allocate(size_t size, void *data)
+{
+  struct arena *arena = data;
+  union header *h = arena_malloc(sizeof(union header) + size);
+  if (h == NULL)
+    return NULL;
+  h->magic = MAGIC;
+  arena->allocations++;
+  arena->in_use++;
+  return h + 1;
+}
+
+static void *
+arena_reallocate(void *ptr, size_t size, void *data)
+{
+  struct arena *arena = data;
+  if (ptr == NULL)
+    return arena_allocate(size, data);
+  union header *h = (union header *) ptr - 1;
+  if (h->magic != MAGIC)
+    {
+      arena->foreign++;
+      return NULL;
+    }
+  h = arena_realloc(h, sizeof(union header) + size);
+  if (h == NULL)
+    return NULL;
+  arena->allocations++;
+  return h + 1;
+}
+
+static void
+arena_release(void *ptr, void *data)
+{
+  struct arena *arena = data;
+  union header *h = (union header *) ptr - 1;
+  if (h->magic != MAGIC)
+    {
+      arena->foreign++;
+      return;
+    }
+  h->magic = 0;
+  arena->in_use--;
+  arena_free(h);
+}
+
+int
+main(void)
+{
+  struct arena arena = { 0 };
+  econf_allocator allocator = {
+    arena_allocate, arena_reallocate, arena_release, &arena
+  };
+  econf_allocator incomplete = { arena_allocate, NULL, arena_release, &arena };
+  econf_file *key_file = NULL, *usr_file = NULL, *merged = NULL;
+  char dir[] = "/tmp/tst-allocator1-XXXXXX";
+  char **keys, *value;
+  size_t key_number;
+  econf_err error;
+  int retval = 0;
+
+  if (econf_setAllocator(&incomplete) != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: incomplete allocator has been accepted\n");
+      return 1;
+    }
+  if ((error = econf_setAllocator(&allocator)))
+    {
+      fprintf (stderr, "ERROR: couldn't set allocator: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+
+  if ((error = econf_readFile (&key_file,
+			       TESTSDIR"tst-writefile3-data/test.conf",
+			       "=", "#")) ||
+      (error = econf_readDirs (&usr_file,
+			       TESTSDIR"tst-getconfdirs1-data/usr/etc",
+			       TESTSDIR"tst-getconfdirs1-data/etc",
+			       "getconfdir", "conf", "=", "#")) ||
+      (error = econf_mergeFiles (&merged, usr_file, key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't read files: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  /* Returned memory has to be released by the allocator */
+  if ((error = econf_getStringValue(merged, "first", "a", &value)) ||
+      strcmp(value, "old value") != 0)
+    {
+      fprintf (stderr, "ERROR: wrong value of a\n");
+      retval = 1;
+    }
+  else
+    arena_release(value, &arena);
+  if ((error = econf_getKeys(merged, NULL, &key_number, &keys)))
+    {
+      fprintf (stderr, "ERROR: couldn't get keys: %s\n",
+	       econf_errString(error));
+      retval = 1;
+    }
+  else
+    econf_free(keys);
+
+  econf_setStringValue(merged, "first", "a", "new value");
+  econf_setIntValue(merged, "new", "key", 1);
+#ifdef COUNT_LIBC_ALLOCATIONS
+  libc_counting = 1;
+#endif
+  if ((error = econf_writeFileWithFlags(merged, dir, "test.conf",
+					ECONF_WRITE_LOSSLESS)) ||
+      (error = econf_writeFile(merged, dir, "test.conf")))
+    {
+      fprintf (stderr, "ERROR: couldn't write file: %s\n",
+	       econf_errString(error));
+      retval = 1;
+    }
+#ifdef COUNT_LIBC_ALLOCATIONS
+  libc_counting = 0;
+  if (libc_allocations)
+    {
+      fprintf (stderr, "ERROR: writing called the C library allocator %zu "
+	       "times\n", libc_allocations);
+      retval = 1;
+    }
+#endif
+
+  econf_free(merged);
+  econf_free(usr_file);
+  econf_free(key_file);
+
+  if (arena.allocations == 0)
+    {
+      fprintf (stderr, "ERROR: the allocator has not been used\n");
+      retval = 1;
+    }
+  if (arena.foreign)
+    {
+      fprintf (stderr, "ERROR: %d blocks of another allocator\n",
+	       arena.foreign);
+      retval = 1;
+    }
+  /* Only the path for econf_errLocation() is kept */
+  if (arena.in_use != 1)
+    {
+      fprintf (stderr, "ERROR: %zu blocks are still in use\n", arena.in_use);
+      retval = 1;
+    }
+
+  char path[sizeof(dir) + 16];
+  snprintf(path, sizeof(path), "%s/test.conf", dir);
+  unlink(path);
+  rmdir(dir);
+  return retval;
+}
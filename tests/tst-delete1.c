@@ -0,0 +1,213 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   Delete keys and groups, set a deleted key again and compact the
+   file. Deleted keys and groups must not be returned anymore, also if
+   a key occurs several times in a file.
+*/
+
+static int
+check_keys(econf_file *key_file, const char *group, size_t expected_number,
+	   const char *const *expected)
+{
+  char **keys;
+  size_t key_number;
+  econf_err error = econf_getKeys(key_file, group, &key_number, &keys);
+  if (expected_number == 0)
+    {
+      if (error != ECONF_NOKEY)
+	{
+	  fprintf (stderr, "Keys found for deleted group %s\n", group);
+	  return 1;
+	}
+      return 0;
+    }
+  if (error)
+    {
+      fprintf (stderr, "Error getting keys of %s: %s\n", group,
+	       econf_errString(error));
+      return 1;
+    }
+  int retval = 0;
+  if (key_number != expected_number)
+    retval = 1;
+  for (size_t i = 0; !retval && i < key_number; i++)
+    if (strcmp(keys[i], expected[i]) != 0)
+      retval = 1;
+  if (retval)
+    {
+      fprintf (stderr, "Wrong keys of %s (got %zu, expected %zu):\n", group,
+	       key_number, expected_number);
+      for (size_t i = 0; i < key_number; i++)
+	fprintf (stderr, "%zu: %s\n", i, keys[i]);
+    }
+  econf_free (keys);
+  return retval;
+}
+
+/* A file which contains a key twice returns the first value. After
+   deleting the key, it must not come back with the second one.  */
+static int
+check_duplicates(void)
+{
+  char path[] = "/tmp/tst-delete1-XXXXXX";
+  econf_file *key_file = NULL;
+  econf_err error;
+  char *value;
+  int retval = 0;
+
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return 1;
+  static const char content[] = "[g]\nk=1\nk=2\nj=3\n";
+  if (write(fd, content, sizeof(content) - 1) != sizeof(content) - 1)
+    {
+      close(fd);
+      unlink(path);
+      return 1;
+    }
+  close(fd);
+  error = econf_readFile(&key_file, path, "=", "#");
+  unlink(path);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't read %s: %s\n", path,
+	       econf_errString(error));
+      return 1;
+    }
+
+  if ((error = econf_getStringValue(key_file, "g", "k", &value)) ||
+      strcmp(value, "1") != 0)
+    {
+      fprintf (stderr, "Wrong value of duplicate key\n");
+      return 1;
+    }
+  free (value);
+  if ((error = econf_deleteKey(key_file, "g", "k")))
+    {
+      fprintf (stderr, "Error deleting duplicate key: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  for (int compacted = 0; compacted < 2; compacted++)
+    {
+      if (econf_getStringValue(key_file, "g", "k", &value) != ECONF_NOKEY)
+	{
+	  fprintf (stderr, "Duplicate key has been found %s compacting\n",
+		   compacted ? "after" : "before");
+	  retval = 1;
+	}
+      static const char *const keys[] = { "j" };
+      retval |= check_keys(key_file, "g", 1, keys);
+      if ((error = econf_compact(key_file)))
+	{
+	  fprintf (stderr, "Error compacting: %s\n", econf_errString(error));
+	  return 1;
+	}
+    }
+
+  econf_free (key_file);
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  char **groups;
+  char *value;
+  size_t group_number;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_newIniFile (&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  econf_setStringValue(key_file, "first", "key1", "value");
+  econf_setStringValue(key_file, "first", "key2", "value");
+  econf_setStringValue(key_file, "second", "key1", "value");
+  econf_setStringValue(key_file, "first", "key3", "value");
+  econf_setStringValue(key_file, "third", "key1", "value");
+
+  if ((error = econf_deleteKey(key_file, "first", "key2")))
+    {
+      fprintf (stderr, "Error deleting key: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (econf_deleteKey(key_file, "first", "key2") != ECONF_NOKEY)
+    {
+      fprintf (stderr, "Deleted key has been deleted again\n");
+      retval = 1;
+    }
+  if (econf_getStringValue(key_file, "first", "key2", &value) != ECONF_NOKEY)
+    {
+      fprintf (stderr, "Deleted key has been found\n");
+      retval = 1;
+    }
+  static const char *const first_keys[] = { "key1", "key3" };
+  retval |= check_keys(key_file, "first", 2, first_keys);
+
+  if ((error = econf_deleteGroup(key_file, "second")))
+    {
+      fprintf (stderr, "Error deleting group: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (econf_deleteGroup(key_file, "second") != ECONF_NOGROUP)
+    {
+      fprintf (stderr, "Deleted group has been deleted again\n");
+      retval = 1;
+    }
+  retval |= check_keys(key_file, "second", 0, NULL);
+
+  if ((error = econf_getGroups(key_file, &group_number, &groups)))
+    {
+      fprintf (stderr, "Error getting all groups: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (group_number != 2 || strcmp(groups[0], "[first]") != 0 ||
+      strcmp(groups[1], "[third]") != 0)
+    {
+      fprintf (stderr, "Wrong groups (got %zu, expected 2)\n", group_number);
+      retval = 1;
+    }
+  econf_free (groups);
+
+  /* Set a deleted key again. It is appended to its group. */
+  econf_setStringValue(key_file, "first", "key2", "new");
+  static const char *const first_keys_new[] = { "key1", "key3", "key2" };
+  retval |= check_keys(key_file, "first", 3, first_keys_new);
+
+  if ((error = econf_compact(key_file)))
+    {
+      fprintf (stderr, "Error compacting: %s\n", econf_errString(error));
+      return 1;
+    }
+  retval |= check_keys(key_file, "first", 3, first_keys_new);
+  retval |= check_keys(key_file, "second", 0, NULL);
+  if ((error = econf_getStringValue(key_file, "first", "key2", &value)) ||
+      strcmp(value, "new") != 0)
+    {
+      fprintf (stderr, "Wrong value after compacting\n");
+      return 1;
+    }
+  free (value);
+
+  econf_free (key_file);
+
+  retval |= check_duplicates();
+
+  return retval;
+}
@@ -0,0 +1,134 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   econf_diffFiles() returns only changed and added keys and
+   econf_writeDropIn() adds them to an existing drop-in file.
+*/
+
+static int
+check_value(econf_file *key_file, const char *group, const char *key,
+	    const char *expected)
+{
+  char *value = NULL;
+  econf_err error = econf_getStringValue(key_file, group, key, &value);
+  if (expected == NULL)
+    {
+      free(value);
+      if (error != ECONF_NOKEY)
+	{
+	  fprintf (stderr, "ERROR: %s/%s should not exist\n", group, key);
+	  return 1;
+	}
+      return 0;
+    }
+  if (error || strcmp(value, expected) != 0)
+    {
+      fprintf (stderr, "ERROR: %s/%s: expected '%s', got '%s' (%s)\n", group,
+	       key, expected, value ? value : "", econf_errString(error));
+      free(value);
+      return 1;
+    }
+  free(value);
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_file *base = NULL, *edited = NULL, *delta = NULL, *dropin = NULL;
+  econf_err error;
+  char dir[] = "/tmp/tst-dropin1-XXXXXX";
+  char *path;
+  int retval = 0;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  if (asprintf(&path, "%s/90_test.conf", dir) < 0)
+    return 1;
+
+  if (econf_newIniFile (&base) || econf_newIniFile (&edited))
+    {
+      fprintf (stderr, "ERROR: couldn't create key files\n");
+      return 1;
+    }
+  econf_setStringValue(base, NULL, "global", "1");
+  econf_setStringValue(base, "group", "same", "value");
+  econf_setStringValue(base, "group", "changed", "old");
+  econf_setStringValue(base, "group", "removed", "value");
+
+  econf_setStringValue(edited, NULL, "global", "1");
+  econf_setStringValue(edited, "group", "same", "value");
+  econf_setStringValue(edited, "group", "changed", "new");
+  econf_setStringValue(edited, "group", "added", "value");
+  econf_setStringValue(edited, "new", "key", "value");
+
+  if ((error = econf_diffFiles(&delta, base, edited)))
+    {
+      fprintf (stderr, "ERROR: econf_diffFiles: %s\n", econf_errString(error));
+      return 1;
+    }
+  retval |= check_value(delta, NULL, "global", NULL);
+  retval |= check_value(delta, "group", "same", NULL);
+  retval |= check_value(delta, "group", "removed", NULL);
+  retval |= check_value(delta, "group", "changed", "new");
+  retval |= check_value(delta, "group", "added", "value");
+  retval |= check_value(delta, "new", "key", "value");
+  econf_free(delta);
+
+  /* Nothing is written without changes */
+  if ((error = econf_writeDropIn(base, base, dir, "90_test.conf", 0)) ||
+      access(path, F_OK) == 0)
+    {
+      fprintf (stderr, "ERROR: drop-in written without changes (%s)\n",
+	       econf_errString(error));
+      retval = 1;
+    }
+
+  if ((error = econf_writeDropIn(base, edited, dir, "90_test.conf", 0)))
+    {
+      fprintf (stderr, "ERROR: econf_writeDropIn: %s\n", econf_errString(error));
+      return 1;
+    }
+
+  /* A second change is added to the existing drop-in file */
+  econf_setStringValue(edited, "group", "same", "changed too");
+  if ((error = econf_writeDropIn(base, edited, dir, "90_test.conf", 0)))
+    {
+      fprintf (stderr, "ERROR: econf_writeDropIn: %s\n", econf_errString(error));
+      return 1;
+    }
+
+  if ((error = econf_readFile(&dropin, path, "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read drop-in: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  retval |= check_value(dropin, NULL, "global", NULL);
+  retval |= check_value(dropin, "group", "removed", NULL);
+  retval |= check_value(dropin, "group", "changed", "new");
+  retval |= check_value(dropin, "group", "added", "value");
+  retval |= check_value(dropin, "group", "same", "changed too");
+  retval |= check_value(dropin, "new", "key", "value");
+
+  econf_free(dropin);
+  econf_free(base);
+  econf_free(edited);
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
@@ -0,0 +1,494 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+#include "libeconf_client.h"
+
+/* Test case:
+   Start econfd for a configuration in a temporary directory and look
+   up values, a batch of values and the snapshot of the configuration
+   with libeconf_client. A batch whose requests and responses do not
+   fit into the socket buffers must not block, neither must requests
+   which are sent behind a snapshot without waiting for it. A changed
+   file is
+   reloaded by the daemon and the socket is only accessible by its
+   owner.
+*/
+
+static char dir[] = "/tmp/tst-econfd1-XXXXXX";
+static char socket_path[64];
+
+/* Key and value of the group "large" */
+#define LARGE_KEY_LENGTH 2000
+#define LARGE_VALUE_LENGTH 4000
+#define LARGE_REQUESTS 1024
+static char large_key[LARGE_KEY_LENGTH + 1];
+static char large_value[LARGE_VALUE_LENGTH + 1];
+
+static int
+write_file(const char *name, const char *content)
+{
+  char path[128], tmp[136];
+  snprintf (path, sizeof(path), "%s/%s", dir, name);
+  snprintf (tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *fp = fopen (tmp, "w");
+  if (fp == NULL)
+    return 1;
+  fputs (content, fp);
+  /* Replace the file atomically like an editor or package manager */
+  if (fclose (fp) != 0 || rename (tmp, path) != 0)
+    return 1;
+  return 0;
+}
+
+static void
+sleep_ms(long ms)
+{
+  struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+  nanosleep (&ts, NULL);
+}
+
+static econf_client *
+connect_daemon(void)
+{
+  econf_client *client = NULL;
+  for (int i = 0; i < 500; i++)
+    {
+      if (econf_clientConnect (&client, socket_path) == ECONF_SUCCESS)
+	return client;
+      sleep_ms (10);
+    }
+  return NULL;
+}
+
+static int
+check_values(econf_client *client)
+{
+  char *s;
+  int32_t i;
+  uint64_t u64;
+  double d;
+  bool b;
+  econf_err error;
+
+  if ((error = econf_clientGetStringValue (client, "econfd.conf", NULL, "name", &s)) ||
+      strcmp (s, "vendor") != 0)
+    {
+      fprintf (stderr, "ERROR: name: %s\n", econf_errString(error));
+      return 1;
+    }
+  free (s);
+  if ((error = econf_clientGetIntValue (client, "econfd.conf", "numbers", "int", &i)) ||
+      i != -42)
+    {
+      fprintf (stderr, "ERROR: int: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_clientGetUInt64Value (client, "econfd.conf", "numbers", "big", &u64)) ||
+      u64 != 18000000000000000000ULL)
+    {
+      fprintf (stderr, "ERROR: big: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_clientGetDoubleValue (client, "econfd.conf", "[numbers]", "pi", &d)) ||
+      d != 3.25)
+    {
+      fprintf (stderr, "ERROR: pi: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_clientGetBoolValue (client, "econfd.conf", "flags", "on", &b)) ||
+      !b)
+    {
+      fprintf (stderr, "ERROR: on: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_clientGetIntValue (client, "econfd.conf", NULL, "missing", &i)) !=
+      ECONF_NOKEY)
+    {
+      fprintf (stderr, "ERROR: missing key: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_clientGetIntValue (client, "unknown.conf", NULL, "name", &i)) !=
+      ECONF_NOFILE)
+    {
+      fprintf (stderr, "ERROR: unknown project: %s\n", econf_errString(error));
+      return 1;
+    }
+  return 0;
+}
+
+static int
+check_batch(econf_client *client)
+{
+  econf_client_request requests[300];
+  econf_err error;
+
+  /* More requests than fit into one window of the client */
+  for (size_t n = 0; n < 3000; n += 300)
+    {
+      memset (requests, 0, sizeof(requests));
+      for (size_t i = 0; i < 300; i++)
+	{
+	  requests[i].project = "econfd.conf";
+	  if (i % 3 == 0)
+	    {
+	      requests[i].type = ECONFD_GET_STRING;
+	      requests[i].key = "name";
+	    }
+	  else if (i % 3 == 1)
+	    {
+	      requests[i].type = ECONFD_GET_INT;
+	      requests[i].group = "numbers";
+	      requests[i].key = "int";
+	    }
+	  else
+	    {
+	      requests[i].type = ECONFD_GET_BOOL;
+	      requests[i].key = i % 2 ? NULL : "missing";
+	    }
+	}
+      if ((error = econf_clientBatch (client, requests, 300)))
+	{
+	  fprintf (stderr, "ERROR: batch: %s\n", econf_errString(error));
+	  return 1;
+	}
+      for (size_t i = 0; i < 300; i++)
+	{
+	  econf_client_request *r = &requests[i];
+	  int ok;
+	  if (i % 3 == 0)
+	    {
+	      ok = r->error == ECONF_SUCCESS && strcmp (r->value.s, "vendor") == 0;
+	      free (r->value.s);
+	    }
+	  else if (i % 3 == 1)
+	    ok = r->error == ECONF_SUCCESS && r->value.i == -42;
+	  else
+	    ok = r->error == (i % 2 ? ECONF_ERROR : ECONF_NOKEY);
+	  if (!ok)
+	    {
+	      fprintf (stderr, "ERROR: batch request %zu: %s\n", n + i,
+		       econf_errString(r->error));
+	      return 1;
+	    }
+	}
+    }
+  return 0;
+}
+
+/* About 2 MiB of requests and 4 MiB of responses, so the daemon stops
+   reading requests before the client has sent all of them */
+static int
+check_large_batch(econf_client *client)
+{
+  econf_client_request *requests = calloc (LARGE_REQUESTS, sizeof(*requests));
+  econf_err error;
+  int retval = 0;
+
+  if (requests == NULL)
+    return 1;
+  for (size_t i = 0; i < LARGE_REQUESTS; i++)
+    {
+      requests[i].type = ECONFD_GET_STRING;
+      requests[i].project = "econfd.conf";
+      requests[i].group = "large";
+      requests[i].key = large_key;
+    }
+  if ((error = econf_clientBatch (client, requests, LARGE_REQUESTS)))
+    {
+      fprintf (stderr, "ERROR: large batch: %s\n", econf_errString(error));
+      free (requests);
+      return 1;
+    }
+  for (size_t i = 0; i < LARGE_REQUESTS; i++)
+    {
+      if (requests[i].error || strcmp (requests[i].value.s, large_value) != 0)
+	{
+	  fprintf (stderr, "ERROR: large batch request %zu: %s\n", i,
+		   econf_errString(requests[i].error));
+	  retval = 1;
+	}
+      free (requests[i].value.s);
+    }
+  free (requests);
+  return retval;
+}
+
+static int
+check_snapshot(econf_client *client, const char *expected)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  char *name;
+
+  if ((error = econf_clientGetSnapshot (client, "econfd.conf", &key_file)))
+    {
+      fprintf (stderr, "ERROR: snapshot: %s\n", econf_errString(error));
+      return 1;
+    }
+  int retval = 0;
+  if ((error = econf_getStringValue (key_file, NULL, "name", &name)) ||
+      strcmp (name, expected) != 0)
+    {
+      fprintf (stderr, "ERROR: name of the snapshot: %s\n", econf_errString(error));
+      retval = 1;
+    }
+  else
+    free (name);
+  econf_free (key_file);
+
+  if (econf_clientGetSnapshot (client, "unknown.conf", &key_file) != ECONF_NOFILE)
+    {
+      fprintf (stderr, "ERROR: snapshot of an unknown project\n");
+      retval = 1;
+    }
+  return retval;
+}
+
+/* Send the requests of types at once on a new connection and check
+   the responses. Lookups ask for the key "name". */
+static int
+check_pipelined(const econfd_request_type *types, size_t length)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  char request[256], response[4096];
+  size_t request_length = 0, response_length = 0, fds = 0, snapshots = 0;
+  int retval = 1;
+
+  int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return 1;
+  strcpy (addr.sun_path, socket_path);
+  if (connect (fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    goto out;
+  for (size_t i = 0; i < length; i++)
+    {
+      static const char frame[] = "?econfd.conf\0\0name";
+      uint32_t frame_length = sizeof(frame);
+      memcpy (request + request_length, &frame_length, sizeof(frame_length));
+      memcpy (request + request_length + sizeof(frame_length), frame,
+	      sizeof(frame));
+      request[request_length + sizeof(frame_length)] = types[i];
+      request_length += sizeof(frame_length) + sizeof(frame);
+      if (types[i] == ECONFD_GET_SNAPSHOT)
+	snapshots++;
+    }
+  if (send (fd, request, request_length, MSG_NOSIGNAL) !=
+      (ssize_t) request_length)
+    goto out;
+
+  /* Read until all responses have arrived */
+  size_t responses = 0, pos = 0;
+  while (responses < length)
+    {
+      struct pollfd pfd = { .fd = fd, .events = POLLIN };
+      if (poll (&pfd, 1, 5000) <= 0)
+	{
+	  fprintf (stderr, "ERROR: %zu of %zu pipelined responses received\n",
+		   responses, length);
+	  goto out;
+	}
+      union {
+	struct cmsghdr header;
+	char buffer[CMSG_SPACE(sizeof(int))];
+      } control;
+      struct iovec iov = {
+	.iov_base = response + response_length,
+	.iov_len = sizeof(response) - response_length
+      };
+      struct msghdr msg = {
+	.msg_iov = &iov,
+	.msg_iovlen = 1,
+	.msg_control = control.buffer,
+	.msg_controllen = sizeof(control.buffer)
+      };
+      ssize_t n = recvmsg (fd, &msg, MSG_CMSG_CLOEXEC);
+      if (n <= 0)
+	goto out;
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+	   cmsg = CMSG_NXTHDR(&msg, cmsg))
+	if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+	  {
+	    int passed_fd;
+	    memcpy (&passed_fd, CMSG_DATA(cmsg), sizeof(passed_fd));
+	    close (passed_fd);
+	    fds++;
+	  }
+      response_length += n;
+
+      uint32_t frame[2];
+      while (response_length - pos >= sizeof(frame))
+	{
+	  memcpy (frame, response + pos, sizeof(frame));
+	  if (response_length - pos < sizeof(frame[0]) + frame[0])
+	    break;
+	  const char *value = response + pos + sizeof(frame);
+	  if (frame[1] != ECONF_SUCCESS ||
+	      (types[responses] != ECONFD_GET_SNAPSHOT &&
+	       strcmp (value, "vendor") != 0))
+	    {
+	      fprintf (stderr, "ERROR: pipelined response %zu: %s\n", responses,
+		       econf_errString(frame[1]));
+	      goto out;
+	    }
+	  pos += sizeof(frame[0]) + frame[0];
+	  responses++;
+	}
+    }
+  if (fds != snapshots)
+    {
+      fprintf (stderr, "ERROR: %zu of %zu snapshots received\n", fds, snapshots);
+      goto out;
+    }
+  retval = 0;
+out:
+  close (fd);
+  return retval;
+}
+
+static int
+check_pipelined_snapshots(void)
+{
+  static const econfd_request_type snapshot_snapshot[] =
+    { ECONFD_GET_SNAPSHOT, ECONFD_GET_SNAPSHOT };
+  static const econfd_request_type snapshot_get[] =
+    { ECONFD_GET_SNAPSHOT, ECONFD_GET_STRING, ECONFD_GET_SNAPSHOT,
+      ECONFD_GET_SNAPSHOT, ECONFD_GET_STRING };
+  return check_pipelined (snapshot_snapshot, 2) ||
+    check_pipelined (snapshot_get, 5);
+}
+
+static int
+check_reload(econf_client *client)
+{
+  econf_err error;
+  char *s;
+
+  if (write_file ("etc/econfd.conf.d/admin.conf", "name = admin\n"))
+    {
+      fprintf (stderr, "ERROR: cannot write the drop-in\n");
+      return 1;
+    }
+  for (int i = 0; i < 500; i++)
+    {
+      if ((error = econf_clientGetStringValue (client, "econfd.conf", NULL, "name", &s)))
+	{
+	  fprintf (stderr, "ERROR: name: %s\n", econf_errString(error));
+	  return 1;
+	}
+      int changed = strcmp (s, "admin") == 0;
+      free (s);
+      if (changed)
+	return check_snapshot (client, "admin");
+      sleep_ms (10);
+    }
+  fprintf (stderr, "ERROR: changed configuration has not been reloaded\n");
+  return 1;
+}
+
+int
+main(void)
+{
+#ifndef ECONFD
+  return 77;
+#else
+  char path[128];
+  int retval = 1;
+
+  if (mkdtemp (dir) == NULL)
+    return 77;
+  snprintf (socket_path, sizeof(socket_path), "%s/econfd.sock", dir);
+  snprintf (path, sizeof(path), "%s/usr", dir);
+  mkdir (path, 0755);
+  snprintf (path, sizeof(path), "%s/usr/etc", dir);
+  mkdir (path, 0755);
+  snprintf (path, sizeof(path), "%s/etc", dir);
+  mkdir (path, 0755);
+  memset (large_key, 'k', LARGE_KEY_LENGTH);
+  memset (large_value, 'v', LARGE_VALUE_LENGTH);
+  char *content;
+  if (asprintf (&content,
+		"name = vendor\n"
+		"[numbers]\n"
+		"int = -42\n"
+		"big = 18000000000000000000\n"
+		"pi = 3.25\n"
+		"[flags]\n"
+		"on = yes\n"
+		"[large]\n"
+		"%s = %s\n", large_key, large_value) < 0)
+    return 1;
+  int failed = write_file ("usr/etc/econfd.conf", content);
+  free (content);
+  if (failed)
+    {
+      fprintf (stderr, "ERROR: cannot write the configuration\n");
+      return 1;
+    }
+
+  char vendordir[96], etcdir[96];
+  snprintf (vendordir, sizeof(vendordir), "--vendordir=%s/usr/etc", dir);
+  snprintf (etcdir, sizeof(etcdir), "--etcdir=%s/etc", dir);
+  pid_t pid = fork ();
+  if (pid < 0)
+    return 77;
+  if (pid == 0)
+    {
+      execl (ECONFD, ECONFD, "--socket", socket_path, vendordir, etcdir,
+	     "econfd.conf", (char *) NULL);
+      _exit (127);
+    }
+
+  econf_client *client = connect_daemon ();
+  if (client == NULL)
+    fprintf (stderr, "ERROR: cannot connect to econfd\n");
+  else
+    {
+      /* The drop-in directory is created while the daemon is running */
+      snprintf (path, sizeof(path), "%s/etc/econfd.conf.d", dir);
+      mkdir (path, 0755);
+      struct stat st;
+      if (stat (socket_path, &st) != 0 || (st.st_mode & 0777) != 0600)
+	fprintf (stderr, "ERROR: socket is accessible by others\n");
+      else
+	retval = check_values (client) || check_batch (client) ||
+	  check_large_batch (client) || check_snapshot (client, "vendor") ||
+	  check_pipelined_snapshots () ||
+	  check_reload (client);
+      econf_clientDisconnect (client);
+    }
+
+  int status;
+  kill (pid, SIGTERM);
+  waitpid (pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fprintf (stderr, "ERROR: econfd failed\n");
+      retval = 1;
+    }
+  if (access (socket_path, F_OK) == 0)
+    {
+      fprintf (stderr, "ERROR: socket has not been removed\n");
+      retval = 1;
+    }
+
+  snprintf (path, sizeof(path), "rm -rf %s", dir);
+  if (system (path) != 0)
+    retval = 1;
+  return retval;
+#endif
+}
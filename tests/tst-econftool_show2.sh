@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# A key which is set twice in a file is shown once with the value
+# returned by econf_get*Value().
+
+expected=$'[duplicate]\na = 1\nb = 3'
+
+econftool_exe="$PWD/../util/econftool"
+if ! [[ -f "$econftool_exe" ]]; then
+    econftool_exe="$PWD/econftool"
+    if ! [[ -f "$econftool_exe" ]]; then
+        echo "Couldn't find the econftool executable"
+        exit 1
+    fi
+fi
+econftool_root="$PWD/../../tests/tst-econftool-data"
+if ! [[ -d "$econftool_root" ]]; then
+    econftool_root="$PWD/../tests/tst-econftool-data"
+    if ! [[ -d "$econftool_root" ]]; then
+        echo "Couldn't set ECONFTOOL_ROOT"
+        exit 1
+    fi
+fi
+export ECONFTOOL_ROOT=$econftool_root
+
+got_error=false
+
+for command in show cat; do
+    output=$($econftool_exe $command duplicate.conf 2>/dev/null)
+    if [[ "$output" != *"$expected"* ]] || [[ "$output" == *"a = 2"* ]]; then
+        echo error for $command duplicate.conf
+        echo expected: $expected
+        echo got: $output
+        got_error=true
+    fi
+done
+if $got_error; then
+    exit 1
+fi
@@ -0,0 +1,117 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Get multiline and quoted values with econf_getExtValueView and
+   compare them with econf_getExtValue. The lines are split only once
+   and have to be split again after the value has been changed.
+*/
+
+static int
+check_view(econf_file *key_file, const char *key, size_t expected_number,
+	   const char *const *expected)
+{
+  econf_ext_value_view view;
+  econf_ext_value *ext_val;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_getExtValueView(key_file, "main", key, &view)))
+    {
+      fprintf (stderr, "ERROR: couldn't get view of %s: %s\n", key,
+	       econf_errString(error));
+      return 1;
+    }
+  if (view.values_length != expected_number)
+    {
+      fprintf (stderr, "ERROR: %s has %zu lines, expected %zu\n", key,
+	       view.values_length, expected_number);
+      return 1;
+    }
+  for (size_t i = 0; i < expected_number; i++)
+    {
+      if (view.values[i].length != strlen(expected[i]) ||
+	  strncmp(view.values[i].start, expected[i], view.values[i].length))
+	{
+	  fprintf (stderr, "ERROR: line %zu of %s is \"%.*s\", expected \"%s\"\n",
+		   i, key, (int) view.values[i].length, view.values[i].start,
+		   expected[i]);
+	  retval = 1;
+	}
+    }
+
+  /* The owning variant returns the same lines */
+  if ((error = econf_getExtValue(key_file, "main", key, &ext_val)))
+    {
+      fprintf (stderr, "ERROR: couldn't get %s: %s\n", key,
+	       econf_errString(error));
+      return 1;
+    }
+  for (size_t i = 0; i <= expected_number; i++)
+    {
+      if (i == expected_number ? ext_val->values[i] != NULL :
+	  ext_val->values[i] == NULL || strcmp(ext_val->values[i], expected[i]))
+	{
+	  fprintf (stderr, "ERROR: econf_getExtValue differs in line %zu of %s\n",
+		   i, key);
+	  retval = 1;
+	  break;
+	}
+    }
+  econf_freeExtValue(ext_val);
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_ext_value_view view, view2;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_newIniFile (&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  econf_setStringValue(key_file, "main", "hosts", "  first \n\tsecond\n\n third  ");
+  econf_setStringValue(key_file, "main", "quoted", " \"a\n b\" ");
+  econf_setStringValue(key_file, "main", "empty", "");
+
+  static const char *const hosts[] = { "first", "second", "", "third" };
+  static const char *const quoted[] = { "\"a\n b\"" };
+  static const char *const empty[] = { "" };
+  retval |= check_view(key_file, "hosts", 4, hosts);
+  retval |= check_view(key_file, "quoted", 1, quoted);
+  retval |= check_view(key_file, "empty", 1, empty);
+
+  /* The split lines are kept */
+  econf_getExtValueView(key_file, "main", "hosts", &view);
+  econf_getExtValueView(key_file, "main", "hosts", &view2);
+  if (view.values != view2.values)
+    {
+      fprintf (stderr, "ERROR: lines have been split again\n");
+      retval = 1;
+    }
+
+  econf_setStringValue(key_file, "main", "hosts", "other\nhost");
+  static const char *const other[] = { "other", "host" };
+  retval |= check_view(key_file, "hosts", 2, other);
+
+  if (econf_getExtValueView(key_file, "main", "missing", &view) != ECONF_NOKEY)
+    {
+      fprintf (stderr, "ERROR: view of a missing key\n");
+      retval = 1;
+    }
+
+  econf_free(key_file);
+  return retval;
+}
@@ -9,7 +9,8 @@
 
 /* Test case:
    /usr/etc/sysctl.d/<*>.conf and /etc/sysctl.d/<*>.conf files
-   are read.
+   are read. /etc/sysctl.d/getconfdir.conf replaces
+   /usr/etc/sysctl.d/getconfdir.conf, which is not read.
    There are no /usr/etc/sysctl.conf nor /etc/sysctl.conf
 */
 
@@ -65,7 +66,7 @@ main(void)
     retval = 1;
   if (check_key(key_file, "ETC", "true") != 0)
     retval = 1;
-  if (check_key(key_file, "USRETC", "true") != 0)
+  if (check_key(key_file, "USRETC", NULL) != 0)
     retval = 1;
   if (check_key(key_file, "OVERRIDE", NULL) != 0)
     retval = 1;
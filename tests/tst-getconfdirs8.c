@@ -0,0 +1,134 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   The drop-in files of /usr/etc/override.conf.d and then those of
+   /etc/override.conf.d are read.
+   /etc/override.conf.d/50-shadowed.conf replaces the file with the same
+   name in /usr/etc, which cannot be parsed and must not be read.
+*/
+
+static int
+check_key(econf_file *key_file, char *key, char *expected_val)
+{
+  char *val = NULL;
+  econf_err error = econf_getStringValue (key_file, "", key, &val);
+  if (expected_val == NULL)
+    {
+      if (val == NULL)
+        return 0;
+
+      fprintf (stderr, "ERROR: %s has value \"%s\"\n", key, val);
+      return 1;
+    }
+  if (val == NULL || strlen(val) == 0)
+    {
+      fprintf (stderr, "ERROR: %s returns nothing! (%s)\n", key,
+               econf_errString(error));
+      return 1;
+    }
+  if (strcmp (val, expected_val) != 0)
+    {
+      fprintf (stderr, "ERROR: %s is not \"%s\"\n", key, expected_val);
+      return 1;
+    }
+
+  printf("Ok: %s=%s\n", key, val);
+  free (val);
+  return 0;
+}
+
+static int
+check_order(void)
+{
+  static const char *const expected[] = {
+    "usr/etc/override.conf",
+    "usr/etc/override.conf.d/10-vendor.conf",
+    "usr/etc/override.conf.d/90-vendor.conf",
+    "etc/override.conf.d/20-admin.conf",
+    "etc/override.conf.d/50-shadowed.conf"
+  };
+  econf_file **key_files;
+  size_t size;
+  econf_err error;
+  int retval = 0;
+
+  error = econf_readDirsHistory (&key_files, &size,
+				 TESTSDIR"tst-getconfdirs8-data/usr/etc",
+				 TESTSDIR"tst-getconfdirs8-data/etc",
+				 "override", "conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirsHistory: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (size != sizeof(expected) / sizeof(expected[0]))
+    {
+      fprintf (stderr, "ERROR: %zu files have been read\n", size);
+      retval = 1;
+    }
+  for (size_t i = 0; i < size; i++)
+    {
+      char *path = econf_getPath (key_files[i]);
+      if (!retval && (path == NULL ||
+		      strcmp (path + strlen(TESTSDIR"tst-getconfdirs8-data/"),
+			      expected[i]) != 0))
+	{
+	  fprintf (stderr, "ERROR: file %zu is %s\n", i, path);
+	  retval = 1;
+	}
+      free (path);
+      econf_free (key_files[i]);
+    }
+  free (key_files);
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  int retval = 0;
+  econf_err error;
+
+  error = econf_readDirs (&key_file,
+			  TESTSDIR"tst-getconfdirs8-data/usr/etc",
+			  TESTSDIR"tst-getconfdirs8-data/etc",
+			  "override", "conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirs: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  if (check_key(key_file, "KEY1", "etc20") != 0)
+    retval = 1;
+  if (check_key(key_file, "USR", "true") != 0)
+    retval = 1;
+  if (check_key(key_file, "USR10", "true") != 0)
+    retval = 1;
+  if (check_key(key_file, "ETC20", "true") != 0)
+    retval = 1;
+  if (check_key(key_file, "ETC50", "true") != 0)
+    retval = 1;
+  if (check_key(key_file, "USR90", "true") != 0)
+    retval = 1;
+  if (check_key(key_file, "SHADOWED", NULL) != 0)
+    retval = 1;
+
+  econf_free (key_file);
+
+  if (check_order() != 0)
+    retval = 1;
+
+  return retval;
+}
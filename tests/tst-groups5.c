@@ -0,0 +1,91 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   Add keys to an already existing group after another group has been
+   created. econf_getGroups() and econf_getKeys() have to return every
+   group and key exactly once.
+*/
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  char **groups, **keys;
+  size_t group_number, key_number;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_newIniFile (&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  econf_setStringValue(key_file, "first", "key1", "value");
+  econf_setStringValue(key_file, "second", "key1", "value");
+  econf_setStringValue(key_file, "first", "key2", "value");
+  econf_setStringValue(key_file, "[first]", "key1", "changed");
+  econf_setStringValue(key_file, NULL, "key3", "value");
+
+  if ((error = econf_getGroups(key_file, &group_number, &groups)))
+    {
+      fprintf (stderr, "Error getting all groups: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (group_number != 2 || strcmp(groups[0], "[first]") != 0 ||
+      strcmp(groups[1], "[second]") != 0)
+    {
+      fprintf (stderr, "Wrong groups (got %zu, expected 2):\n", group_number);
+      for (size_t i = 0; i < group_number; i++)
+	fprintf (stderr, "%zu: %s\n", i, groups[i]);
+      retval = 1;
+    }
+  econf_free (groups);
+
+  if ((error = econf_getKeys(key_file, "first", &key_number, &keys)))
+    {
+      fprintf (stderr, "Error getting keys: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (key_number != 2 || strcmp(keys[0], "key1") != 0 ||
+      strcmp(keys[1], "key2") != 0)
+    {
+      fprintf (stderr, "Wrong keys (got %zu, expected 2):\n", key_number);
+      for (size_t i = 0; i < key_number; i++)
+	fprintf (stderr, "%zu: %s\n", i, keys[i]);
+      retval = 1;
+    }
+  econf_free (keys);
+
+  if ((error = econf_getKeys(key_file, NULL, &key_number, &keys)))
+    {
+      fprintf (stderr, "Error getting keys without group: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (key_number != 1 || strcmp(keys[0], "key3") != 0)
+    {
+      fprintf (stderr, "Wrong keys without group (got %zu, expected 1)\n",
+	       key_number);
+      retval = 1;
+    }
+  econf_free (keys);
+
+  if (econf_getKeys(key_file, "third", &key_number, &keys) != ECONF_NOKEY)
+    {
+      fprintf (stderr, "Keys found for a not existing group\n");
+      retval = 1;
+    }
+
+  econf_free (key_file);
+
+  return retval;
+}
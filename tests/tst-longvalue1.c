@@ -0,0 +1,119 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read a file with a value of several megabytes in one line and a
+   multiline value of several megabytes. Long lines must not be split
+   into continuation lines and econf_getExtValue has to return all
+   lines of the multiline value completely.
+*/
+
+#define CERT_LENGTH (3 * 1024 * 1024)
+#define HOSTS 100000
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_ext_value *ext_val;
+  econf_err error;
+  char dir[] = "/tmp/tst-longvalue1-XXXXXX";
+  char *path, *cert, *value;
+  char host[64];
+  int retval = 0;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  if (asprintf(&path, "%s/test.conf", dir) < 0)
+    return 1;
+
+  cert = malloc(CERT_LENGTH + 1);
+  if (cert == NULL)
+    return 1;
+  for (size_t i = 0; i < CERT_LENGTH; i++)
+    cert[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i % 64];
+  cert[CERT_LENGTH] = '\0';
+
+  FILE *out = fopen(path, "w");
+  if (out == NULL)
+    {
+      perror("fopen");
+      return 1;
+    }
+  fprintf(out, "# certificate\ncert = %s\nhosts = host-000000.example.com\n", cert);
+  for (size_t i = 1; i < HOSTS; i++)
+    fprintf(out, "  host-%06zu.example.com\n", i);
+  fprintf(out, "last = 1\n");
+  fclose(out);
+
+  if ((error = econf_readFile (&key_file, path, "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  if ((error = econf_getStringValue(key_file, NULL, "cert", &value)))
+    {
+      fprintf (stderr, "ERROR: couldn't get cert: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (strcmp(value, cert) != 0)
+    {
+      fprintf (stderr, "ERROR: cert has been changed (length %zu)\n",
+	       strlen(value));
+      retval = 1;
+    }
+  free(value);
+
+  if ((error = econf_getStringValue(key_file, NULL, "last", &value)) ||
+      strcmp(value, "1") != 0)
+    {
+      fprintf (stderr, "ERROR: wrong value of last\n");
+      return 1;
+    }
+  free(value);
+
+  if ((error = econf_getExtValue(key_file, NULL, "hosts", &ext_val)))
+    {
+      fprintf (stderr, "ERROR: couldn't get hosts: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  size_t i;
+  for (i = 0; ext_val->values[i] != NULL; i++)
+    {
+      snprintf(host, sizeof(host), "host-%06zu.example.com", i);
+      if (strcmp(ext_val->values[i], host) != 0)
+	{
+	  fprintf (stderr, "ERROR: host %zu is %s\n", i, ext_val->values[i]);
+	  retval = 1;
+	  break;
+	}
+    }
+  if (retval == 0 && i != HOSTS)
+    {
+      fprintf (stderr, "ERROR: expected %d hosts, got %zu\n", HOSTS, i);
+      retval = 1;
+    }
+  econf_freeExtValue(ext_val);
+
+  econf_free(key_file);
+  free(cert);
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
@@ -0,0 +1,135 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read a file with ECONF_OPT_PROFILE_LOOKUPS and look up some keys.
+   econf_getLookups() returns the keys which have been read, most
+   frequently read first, followed by the keys which have never been read
+   and the missing keys. Without the option there is no profile.
+*/
+
+#define TEST_FILE TESTSDIR"tst-options1-data/test.conf"
+
+struct expected {
+  const char *group, *key;
+  uint64_t count;
+  bool found;
+};
+
+static int
+check_lookups(econf_file *key_file, const struct expected *expected,
+	      size_t expected_length)
+{
+  econf_lookup *lookups;
+  size_t length;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_getLookups(key_file, &lookups, &length)))
+    {
+      fprintf (stderr, "ERROR: econf_getLookups: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (length != expected_length)
+    {
+      fprintf (stderr, "ERROR: %zu lookups, expected %zu\n", length,
+	       expected_length);
+      retval = 1;
+    }
+  for (size_t i = 0; !retval && i < length; i++)
+    {
+      const econf_lookup *l = &lookups[i];
+      const struct expected *e = &expected[i];
+      if ((l->group == NULL) != (e->group == NULL) ||
+	  (l->group && strcmp(l->group, e->group) != 0) ||
+	  strcmp(l->key, e->key) != 0 || l->count != e->count ||
+	  l->found != e->found)
+	{
+	  fprintf (stderr, "ERROR: lookup %zu is %s%s %llu %d, expected "
+		   "%s%s %llu %d\n", i, l->group ? l->group : "", l->key,
+		   (unsigned long long)l->count, l->found,
+		   e->group ? e->group : "", e->key,
+		   (unsigned long long)e->count, e->found);
+	  retval = 1;
+	}
+    }
+  econf_freeLookups(lookups);
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_options *options = NULL;
+  econf_file *key_file = NULL;
+  econf_lookup *lookups;
+  size_t length;
+  econf_err error;
+  int32_t i;
+  char *s;
+
+  if ((error = econf_newOptions(&options)) ||
+      (error = econf_setOpt(options, ECONF_OPT_PROFILE_LOOKUPS, true)) ||
+      (error = econf_readFileWithOptions(&key_file, TEST_FILE, "=", "#",
+					 options)))
+    {
+      fprintf (stderr, "ERROR: couldn't read %s: %s\n", TEST_FILE,
+	       econf_errString(error));
+      return 1;
+    }
+  econf_freeOptions(options);
+
+  /* test.conf: a = 1, b = first\nsecond, [group] c = 3, c = 4 */
+  static const struct expected unread[] = {
+    { NULL, "a", 0, true },
+    { NULL, "b", 0, true },
+    { "[group]", "c", 0, true },
+    { "[group]", "c", 0, true },
+  };
+  if (check_lookups(key_file, unread, 4))
+    return 1;
+
+  for (int n = 0; n < 3; n++)
+    econf_getIntValue(key_file, "group", "c", &i);
+  econf_getIntValue(key_file, NULL, "a", &i);
+  econf_getStringValue(key_file, "", "missing", &s);
+  econf_getStringValue(key_file, "group", "missing", &s);
+  econf_getStringValue(key_file, "[group]", "missing", &s);
+  /* Setting a key is not a lookup */
+  econf_setIntValue(key_file, NULL, "a", 2);
+
+  static const struct expected read[] = {
+    { "[group]", "c", 3, true },
+    { NULL, "a", 1, true },
+    { NULL, "b", 0, true },
+    { "[group]", "c", 0, true },
+    { "[group]", "missing", 2, false },
+    { NULL, "missing", 1, false },
+  };
+  if (check_lookups(key_file, read, 6))
+    return 1;
+  econf_free(key_file);
+
+  if ((error = econf_readFile(&key_file, TEST_FILE, "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read %s: %s\n", TEST_FILE,
+	       econf_errString(error));
+      return 1;
+    }
+  econf_getIntValue(key_file, NULL, "a", &i);
+  if (econf_getLookups(key_file, &lookups, &length) != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: lookups without ECONF_OPT_PROFILE_LOOKUPS\n");
+      return 1;
+    }
+  econf_free(key_file);
+
+  return 0;
+}
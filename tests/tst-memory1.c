@@ -0,0 +1,105 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Check the memory usage of a file which has been read with and without
+   comments. The index is built while reading, lookups do not allocate
+   anything, and the total is the sum of all parts.
+*/
+
+#define TEST_FILE TESTSDIR"tst-options1-data/test.conf"
+
+static int
+get_usage(econf_file *key_file, econf_memory_usage *usage)
+{
+  econf_err error = econf_memoryUsage(key_file, usage);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_memoryUsage: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  size_t sum = usage->entries + usage->slack + usage->strings +
+    usage->comments + usage->caches + usage->source + usage->index +
+    usage->other;
+  if (usage->total != sum)
+    {
+      fprintf (stderr, "ERROR: total %zu is not the sum %zu\n", usage->total,
+	       sum);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_options *options = NULL;
+  econf_file *key_file = NULL;
+  econf_memory_usage usage;
+  econf_err error;
+  int32_t value;
+  int retval = 0;
+
+  if ((error = econf_readFile(&key_file, TEST_FILE, "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read %s: %s\n", TEST_FILE,
+	       econf_errString(error));
+      return 1;
+    }
+  if (get_usage(key_file, &usage))
+    return 1;
+  if (usage.entry_count != 4 || usage.entries == 0 || usage.strings == 0 ||
+      usage.comments == 0 || usage.source == 0 || usage.index == 0)
+    {
+      fprintf (stderr, "ERROR: wrong usage after reading: %zu entries, "
+	       "strings %zu, comments %zu, source %zu, index %zu\n",
+	       usage.entry_count, usage.strings, usage.comments, usage.source,
+	       usage.index);
+      retval = 1;
+    }
+  econf_getIntValue(key_file, NULL, "a", &value);
+  size_t total = usage.total;
+  if (get_usage(key_file, &usage))
+    return 1;
+  if (usage.total != total)
+    {
+      fprintf (stderr, "ERROR: lookup changed the usage from %zu to %zu\n",
+	       total, usage.total);
+      retval = 1;
+    }
+  econf_free(key_file);
+
+  if ((error = econf_newOptions(&options)) ||
+      (error = econf_setOpt(options, ECONF_OPT_DISCARD_COMMENTS, true)) ||
+      (error = econf_readFileWithOptions(&key_file, TEST_FILE, "=", "#",
+					 options)))
+    {
+      fprintf (stderr, "ERROR: couldn't read %s without comments: %s\n",
+	       TEST_FILE, econf_errString(error));
+      return 1;
+    }
+  econf_freeOptions(options);
+  if (get_usage(key_file, &usage))
+    return 1;
+  if (usage.comments != 0 || usage.source != 0)
+    {
+      fprintf (stderr, "ERROR: comments %zu, source %zu without comments\n",
+	       usage.comments, usage.source);
+      retval = 1;
+    }
+  econf_free(key_file);
+
+  if (econf_memoryUsage(NULL, &usage) != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: econf_memoryUsage(NULL) succeeded\n");
+      retval = 1;
+    }
+
+  return retval;
+}
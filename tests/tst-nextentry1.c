@@ -0,0 +1,119 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Iterate over all entries of tst-groups3-data/groups.conf with
+   econf_nextEntry() and compare them with the expected groups, keys
+   and values. Keys which have been appended to an earlier group are
+   returned with that group and deleted keys are skipped.
+*/
+
+static int
+check_unordered(void)
+{
+  econf_file *key_file = NULL;
+  econf_entry entry;
+  econf_err error;
+  static const char *expected[] = {"[a]x", "[a]z", "[c]w"};
+
+  if ((error = econf_newIniFile (&key_file)))
+    return 1;
+  econf_setStringValue (key_file, "a", "x", "1");
+  econf_setStringValue (key_file, "b", "y", "2");
+  econf_setStringValue (key_file, "a", "z", "3");
+  econf_setStringValue (key_file, "c", "w", "4");
+  econf_deleteKey (key_file, "b", "y");
+
+  /* The file is not reordered, so a second iteration is the same */
+  for (int round = 0; round < 2; round++)
+    {
+      size_t cursor = 0, count = 0;
+      char name[16];
+      while ((error = econf_nextEntry (key_file, &cursor, &entry)) ==
+	     ECONF_SUCCESS)
+	{
+	  snprintf (name, sizeof(name), "%s%s", entry.group, entry.key);
+	  if (count >= sizeof(expected)/sizeof(expected[0]) ||
+	      strcmp (name, expected[count]) != 0)
+	    {
+	      fprintf (stderr, "ERROR: unexpected entry %zu: %s\n", count,
+		       name);
+	      return 1;
+	    }
+	  count++;
+	}
+      if (error != ECONF_NOKEY || count != sizeof(expected)/sizeof(expected[0]))
+	{
+	  fprintf (stderr, "ERROR: got %zu entries: %s\n", count,
+		   econf_errString(error));
+	  return 1;
+	}
+    }
+
+  econf_free (key_file);
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_entry entry;
+  size_t cursor = 0, count = 0;
+  econf_err error;
+  static const char *groups[] = {"[global]", "[section2]", "[section2]",
+    "[section2]", "[blablabla]", "[section5]", "[section6]"};
+  static const char *keys[] = {"key", "key", "section3", "key", "key",
+    "key", "key"};
+  static const char *values[] = {"global", "section2", NULL, "section3",
+    "blablabla", "section5", "section6"};
+
+  if ((error = econf_readFile (&key_file, TESTSDIR"tst-groups3-data/groups.conf", "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read configuration file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  while ((error = econf_nextEntry (key_file, &cursor, &entry)) == ECONF_SUCCESS)
+    {
+      if (count >= sizeof(groups)/sizeof(groups[0]))
+	{
+	  fprintf (stderr, "ERROR: too many entries\n");
+	  return 1;
+	}
+      if (entry.group == NULL || strcmp (entry.group, groups[count]) != 0 ||
+	  strcmp (entry.key, keys[count]) != 0 ||
+	  (entry.value == NULL) != (values[count] == NULL) ||
+	  (entry.value && strcmp (entry.value, values[count]) != 0))
+	{
+	  fprintf (stderr, "ERROR: entry %zu: got %s %s=%s\n", count,
+		   entry.group ? entry.group : "(null)", entry.key,
+		   entry.value ? entry.value : "(null)");
+	  return 1;
+	}
+      count++;
+    }
+
+  if (error != ECONF_NOKEY)
+    {
+      fprintf (stderr, "ERROR: iteration failed: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (count != sizeof(groups)/sizeof(groups[0]))
+    {
+      fprintf (stderr, "ERROR: expected %zu entries, got %zu\n",
+	       sizeof(groups)/sizeof(groups[0]), count);
+      return 1;
+    }
+
+  econf_free (key_file);
+
+  return check_unordered();
+}
@@ -0,0 +1,151 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read the same file with the default options and with every option
+   enabled. Discarded comments are NULL, without multiline values the
+   continuation line is a key of its own and joined entries contain
+   the values of all entries with the same name.
+*/
+
+#define TEST_FILE TESTSDIR"tst-options1-data/test.conf"
+
+static int
+check_string(econf_file *key_file, const char *group, const char *key,
+	     const char *expected)
+{
+  char *value = NULL;
+  econf_err error = econf_getStringValue(key_file, group, key, &value);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't get %s: %s\n", key,
+	       econf_errString(error));
+      return 1;
+    }
+  int retval = strcmp(value, expected) != 0;
+  if (retval)
+    fprintf (stderr, "ERROR: %s is \"%s\", expected \"%s\"\n", key, value,
+	     expected);
+  free(value);
+  return retval;
+}
+
+static int
+check_comment(econf_file *key_file, const char *key, const char *expected)
+{
+  econf_ext_value *ext_val;
+  econf_err error = econf_getExtValue(key_file, NULL, key, &ext_val);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't get %s: %s\n", key,
+	       econf_errString(error));
+      return 1;
+    }
+  const char *comment = ext_val->comment_before_key;
+  int retval = expected ? comment == NULL || strcmp(comment, expected) != 0
+			: comment != NULL;
+  if (retval)
+    fprintf (stderr, "ERROR: comment of %s is \"%s\", expected \"%s\"\n", key,
+	     comment ? comment : "(null)", expected ? expected : "(null)");
+  econf_freeExtValue(ext_val);
+  return retval;
+}
+
+static econf_file *
+read_with(econf_option option)
+{
+  econf_options *options;
+  econf_file *key_file = NULL;
+  econf_err error;
+
+  if ((error = econf_newOptions(&options)) ||
+      (error = econf_setOpt(options, option, true)) ||
+      (error = econf_readFileWithOptions(&key_file, TEST_FILE, "=", "#",
+					 options)))
+    fprintf (stderr, "ERROR: couldn't read with option %d: %s\n", option,
+	     econf_errString(error));
+  econf_freeOptions(options);
+  return key_file;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_options *options = NULL;
+  econf_err error;
+  char *value;
+  int retval = 0;
+
+  error = econf_readFile (&key_file, TEST_FILE, "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't read configuration file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  retval |= check_comment(key_file, "a", " comment of a");
+  retval |= check_string(key_file, NULL, "b", "first\nsecond");
+  retval |= check_string(key_file, "group", "c", "3");
+  econf_free(key_file);
+
+  if ((key_file = read_with(ECONF_OPT_DISCARD_COMMENTS)) == NULL)
+    return 1;
+  retval |= check_comment(key_file, "a", NULL);
+  retval |= check_string(key_file, NULL, "a", "1");
+  retval |= check_string(key_file, NULL, "b", "first\nsecond");
+  econf_free(key_file);
+
+  if ((key_file = read_with(ECONF_OPT_NO_MULTILINE)) == NULL)
+    return 1;
+  retval |= check_comment(key_file, "a", " comment of a");
+  retval |= check_string(key_file, NULL, "b", "first");
+  if (econf_getStringValue(key_file, NULL, "second", &value) == ECONF_NOKEY)
+    {
+      fprintf (stderr, "ERROR: continuation line is not a key\n");
+      retval = 1;
+    }
+  else
+    free(value);
+  econf_free(key_file);
+
+  if ((key_file = read_with(ECONF_OPT_JOIN_SAME_ENTRIES)) == NULL)
+    return 1;
+  retval |= check_string(key_file, "group", "c", "3\n4");
+  econf_free(key_file);
+
+  /* Options are checked */
+  if ((error = econf_newOptions(&options)))
+    return 1;
+  if (econf_setOpt(options, (econf_option) 42, true) != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: unknown option has been accepted\n");
+      retval = 1;
+    }
+
+  /* Options are used for all files of econf_readDirsWithOptions */
+  econf_setOpt(options, ECONF_OPT_DISCARD_COMMENTS, true);
+  econf_setOpt(options, ECONF_OPT_NO_MULTILINE, true);
+  error = econf_readDirsWithOptions (&key_file,
+				     TESTSDIR"tst-getconfdirs1-data/usr/etc",
+				     TESTSDIR"tst-getconfdirs1-data/etc",
+				     "getconfdir", "conf", "=", "#", options);
+  econf_freeOptions(options);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirsWithOptions: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  retval |= check_string(key_file, NULL, "KEY1", "etcconfd");
+  retval |= check_string(key_file, NULL, "OVERRIDE", "true");
+  econf_free(key_file);
+
+  return retval;
+}
@@ -0,0 +1,153 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Parse a file with econf_parseFile and check that every line, group,
+   entry and comment is reported in the order of the file. The reported
+   value offsets have to point to the value in the original line.
+*/
+
+struct parse_result {
+  char content[1024];
+  size_t length;
+  size_t lines, groups, entries, comments;
+  int retval;
+};
+
+static econf_err
+on_line(void *data, const char *line, size_t length, uint64_t line_number)
+{
+  struct parse_result *result = data;
+  if (line_number != ++result->lines ||
+      result->length + length > sizeof(result->content))
+    return ECONF_ERROR;
+  memcpy(result->content + result->length, line, length);
+  result->length += length;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+on_group(void *data, const char *group, uint64_t line_number)
+{
+  struct parse_result *result = data;
+  static const char *const expected[] = { "[first]", "[second]" };
+  if (result->groups >= 2 || strcmp(group, expected[result->groups]) != 0)
+    {
+      fprintf (stderr, "Unexpected group %s in line %lu\n", group,
+	       (unsigned long) line_number);
+      result->retval = 1;
+    }
+  result->groups++;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+on_entry(void *data, const econf_parse_entry *entry)
+{
+  struct parse_result *result = data;
+  static const char *const expected[][3] = {
+    { NULL, "global", "1" },
+    { "[first]", "a", "old value" },
+    { "[first]", "b", "2" },
+    { "[first]", "c", "3" },
+    { "[second]", "x", "10" },
+  };
+  size_t i = result->entries++;
+  if (i >= sizeof(expected)/sizeof(expected[0]) || entry->continuation ||
+      (entry->group == NULL) != (expected[i][0] == NULL) ||
+      (entry->group && strcmp(entry->group, expected[i][0]) != 0) ||
+      strcmp(entry->key, expected[i][1]) != 0 ||
+      strcmp(entry->value, expected[i][2]) != 0)
+    {
+      fprintf (stderr, "Unexpected entry %s in line %lu\n", entry->key,
+	       (unsigned long) entry->line_number);
+      result->retval = 1;
+      return ECONF_SUCCESS;
+    }
+  /* The value offsets refer to the lines reported so far */
+  size_t length = entry->value_end - entry->value_start;
+  if (entry->value_end > result->length ||
+      length != strlen(entry->value) ||
+      strncmp(result->content + entry->value_start, entry->value, length) != 0)
+    {
+      fprintf (stderr, "Wrong value offsets of %s\n", entry->key);
+      result->retval = 1;
+    }
+  if (strcmp(entry->key, "a") == 0 &&
+      (entry->comment_before_key == NULL ||
+       strcmp(entry->comment_before_key, " comment before a") != 0 ||
+       entry->comment_after_value == NULL ||
+       strcmp(entry->comment_after_value, " trailing comment") != 0))
+    {
+      fprintf (stderr, "Wrong comments of %s\n", entry->key);
+      result->retval = 1;
+    }
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+on_comment(void *data, const char *comment __attribute__((unused)),
+	   bool after_value __attribute__((unused)),
+	   uint64_t line_number __attribute__((unused)))
+{
+  struct parse_result *result = data;
+  result->comments++;
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+stop_on_group(void *data __attribute__((unused)),
+	      const char *group __attribute__((unused)),
+	      uint64_t line_number __attribute__((unused)))
+{
+  return ECONF_ERROR;
+}
+
+int
+main(void)
+{
+  struct parse_result result = { .length = 0 };
+  econf_parse_callbacks callbacks = {
+    .on_line = on_line,
+    .on_group = on_group,
+    .on_entry = on_entry,
+    .on_comment = on_comment,
+  };
+  econf_err error;
+
+  error = econf_parseFile(TESTSDIR"tst-writefile3-data/test.conf", "=", "#",
+			  &callbacks, &result);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't parse file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (result.lines != 11 || result.groups != 2 || result.entries != 5 ||
+      result.comments != 3)
+    {
+      fprintf (stderr, "Wrong number of callbacks: %zu lines, %zu groups, "
+	       "%zu entries, %zu comments\n", result.lines, result.groups,
+	       result.entries, result.comments);
+      return 1;
+    }
+
+  /* An error returned by a callback stops parsing */
+  callbacks = (econf_parse_callbacks) { .on_group = stop_on_group };
+  error = econf_parseFile(TESTSDIR"tst-writefile3-data/test.conf", "=", "#",
+			  &callbacks, NULL);
+  if (error != ECONF_ERROR)
+    {
+      fprintf (stderr, "Callback error not returned: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  return result.retval;
+}
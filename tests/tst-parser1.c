@@ -0,0 +1,137 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Feed a file to an econf_parser in chunks of every size and compare
+   the reported entries with the ones of econf_parseFile. Multiline
+   values and comments have to be reported the same way independent
+   of where the chunks end.
+*/
+
+#define FILENAME TESTSDIR"tst-parser1-data/test.conf"
+
+static econf_err
+on_entry(void *data, const econf_parse_entry *entry)
+{
+  FILE *out = data;
+  fprintf(out, "%s|%s|%s|%s|%s|%lu|%d|%zu|%zu\n",
+	  entry->group ? entry->group : "", entry->key ? entry->key : "",
+	  entry->value ? entry->value : "(null)",
+	  entry->comment_before_key ? entry->comment_before_key : "",
+	  entry->comment_after_value ? entry->comment_after_value : "",
+	  (unsigned long) entry->line_number, entry->continuation,
+	  entry->value_start, entry->value_end);
+  return ECONF_SUCCESS;
+}
+
+static const econf_parse_callbacks callbacks = { .on_entry = on_entry };
+
+static char *
+parse_chunks(const char *content, size_t length, size_t chunk_size)
+{
+  char *result = NULL;
+  size_t result_length;
+  FILE *out = open_memstream(&result, &result_length);
+  econf_parser *parser;
+  econf_err error;
+
+  if (out == NULL)
+    return NULL;
+  if ((error = econf_newParser(&parser, "=", "#", &callbacks, out)))
+    {
+      fprintf (stderr, "ERROR: couldn't create parser: %s\n",
+	       econf_errString(error));
+      fclose(out);
+      free(result);
+      return NULL;
+    }
+  for (size_t i = 0; !error && i < length; i += chunk_size)
+    error = econf_parserFeed(parser, content + i,
+			     length - i < chunk_size ? length - i : chunk_size);
+  if (!error)
+    error = econf_parserFinish(parser);
+  econf_freeParser(parser);
+  fclose(out);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: parsing chunks of %zu: %s\n", chunk_size,
+	       econf_errString(error));
+      free(result);
+      return NULL;
+    }
+  return result;
+}
+
+int
+main(void)
+{
+  char *expected = NULL, *content = NULL;
+  size_t expected_length, length;
+  FILE *out, *in;
+  econf_err error;
+  int retval = 0;
+
+  out = open_memstream(&expected, &expected_length);
+  if (out == NULL)
+    return 1;
+  error = econf_parseFile(FILENAME, "=", "#", &callbacks, out);
+  fclose(out);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't parse file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  in = fopen(FILENAME, "r");
+  if (in == NULL)
+    return 1;
+  out = open_memstream(&content, &length);
+  if (out == NULL)
+    return 1;
+  int c;
+  while ((c = getc(in)) != EOF)
+    putc(c, out);
+  fclose(in);
+  fclose(out);
+
+  for (size_t chunk_size = 1; chunk_size <= length; chunk_size++)
+    {
+      char *result = parse_chunks(content, length, chunk_size);
+      if (result == NULL)
+	{
+	  retval = 1;
+	  break;
+	}
+      if (strcmp(result, expected) != 0)
+	{
+	  fprintf (stderr, "ERROR: chunks of %zu differ:\n%s\nexpected:\n%s\n",
+		   chunk_size, result, expected);
+	  retval = 1;
+	}
+      free(result);
+      if (retval)
+	break;
+    }
+
+  /* The last line is parsed by econf_parserFinish() */
+  char *result = parse_chunks("a=1\nb=2", 7, 3);
+  if (result == NULL || strcmp(result, "|a|1|||1|0|2|3\n|b|2|||2|0|6|7\n") != 0)
+    {
+      fprintf (stderr, "ERROR: last line without newline: %s\n",
+	       result ? result : "(null)");
+      retval = 1;
+    }
+  free(result);
+
+  free(content);
+  free(expected);
+  return retval;
+}
@@ -0,0 +1,100 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read a configuration file with drop-ins. econf_getExtValue and
+   econf_nextEntry have to report the file and line which has set the
+   value, not the path of the merged file.
+*/
+
+static int
+ends_with(const char *string, const char *suffix)
+{
+  size_t length = strlen(string), suffix_length = strlen(suffix);
+  return length >= suffix_length &&
+    strcmp(string + length - suffix_length, suffix) == 0;
+}
+
+static int
+check_source(econf_file *key_file, const char *key, const char *file,
+	     uint64_t line_number)
+{
+  econf_ext_value *ext_val;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_getExtValue(key_file, NULL, key, &ext_val)))
+    {
+      fprintf (stderr, "ERROR: couldn't get %s: %s\n", key,
+	       econf_errString(error));
+      return 1;
+    }
+  if (ext_val->file == NULL || !ends_with(ext_val->file, file) ||
+      ext_val->line_number != line_number)
+    {
+      fprintf (stderr, "ERROR: %s has been set in %s:%lu, expected %s:%lu\n",
+	       key, ext_val->file ? ext_val->file : "(null)",
+	       (unsigned long) ext_val->line_number, file,
+	       (unsigned long) line_number);
+      retval = 1;
+    }
+  econf_freeExtValue(ext_val);
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_entry entry;
+  size_t cursor = 0;
+  econf_err error;
+  int retval = 0;
+
+  error = econf_readDirs (&key_file,
+			  TESTSDIR"tst-getconfdirs1-data/usr/etc",
+			  TESTSDIR"tst-getconfdirs1-data/etc",
+			  "getconfdir", "conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirs: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  retval |= check_source(key_file, "KEY1",
+			 "/etc/getconfdir.conf.d/1-override.conf", 1);
+  retval |= check_source(key_file, "ETC", "/etc/getconfdir.conf", 2);
+  retval |= check_source(key_file, "OVERRIDE",
+			 "/etc/getconfdir.conf.d/5-override.conf", 1);
+
+  while (econf_nextEntry(key_file, &cursor, &entry) == ECONF_SUCCESS)
+    {
+      if (entry.file == NULL || !ends_with(entry.file, ".conf"))
+	{
+	  fprintf (stderr, "ERROR: no file for entry %s\n", entry.key);
+	  retval = 1;
+	}
+    }
+
+  /* Keys which have been set by the application have no file */
+  econf_setStringValue(key_file, NULL, "NEW", "value");
+  cursor = 0;
+  while (econf_nextEntry(key_file, &cursor, &entry) == ECONF_SUCCESS)
+    {
+      if (strcmp(entry.key, "NEW") == 0 && entry.file != NULL)
+	{
+	  fprintf (stderr, "ERROR: new key has file %s\n", entry.file);
+	  retval = 1;
+	}
+    }
+
+  econf_free(key_file);
+  return retval;
+}
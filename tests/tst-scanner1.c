@@ -0,0 +1,396 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Differential test of the parser. Random files are parsed by the
+   parser of the library and by the former strchr() based parser which
+   is included below as reference. Both have to report the same groups,
+   comments, entries and errors.
+*/
+
+struct trace {
+  FILE *out;
+  char *text;
+  size_t length;
+};
+
+static void
+trace_entry(FILE *out, const econf_parse_entry *entry)
+{
+  fprintf(out, "E|%s|%s|%s|%s|%s|%lu|%d|%zu|%zu\n",
+	  entry->group ? entry->group : "", entry->key ? entry->key : "",
+	  entry->value ? entry->value : "(null)",
+	  entry->comment_before_key ? entry->comment_before_key : "",
+	  entry->comment_after_value ? entry->comment_after_value : "",
+	  (unsigned long) entry->line_number, entry->continuation,
+	  entry->value_start, entry->value_end);
+}
+
+static void
+trace_group(FILE *out, const char *group, uint64_t line_number)
+{
+  fprintf(out, "G|%s|%lu\n", group, (unsigned long) line_number);
+}
+
+static void
+trace_comment(FILE *out, const char *comment, bool after_value,
+	      uint64_t line_number)
+{
+  fprintf(out, "C|%s|%d|%lu\n", comment, after_value,
+	  (unsigned long) line_number);
+}
+
+/* Reference parser */
+
+struct ref_parser {
+  const char *delim, *comment;
+  bool has_wsp, has_nonwsp;
+  char *current_group;
+  char *current_comment_before_key;
+  char *current_comment_after_value;
+  uint64_t line, last_entry_line;
+  size_t offset;
+  FILE *out;
+};
+
+static void
+ref_append_comment(char **comment, const char *text)
+{
+  if (*comment == NULL) {
+    *comment = strdup(text);
+    return;
+  }
+  char *content = *comment;
+  if (asprintf(comment, "%s\n%s", content, text) < 0)
+    abort();
+  free(content);
+}
+
+static econf_err
+ref_parse_line(struct ref_parser *parser, char *buf, size_t length)
+{
+  const char *delim = parser->delim, *comment = parser->comment;
+  char *p, *name, *data = NULL;
+  bool quote_seen = false, delim_seen = false;
+  size_t line_start = parser->offset, line_end = parser->offset + length;
+  char *org_buf = strdup(buf);
+
+  parser->offset = line_end;
+  parser->line++;
+
+  size_t n = strlen(buf);
+  if (n && *(buf + n - 1) == '\n')
+    *(buf + n - 1) = '\0';
+
+  econf_err retval = ECONF_SUCCESS;
+  if (!*buf)
+    goto out;
+
+  name = buf;
+  while (*name && isspace((unsigned)*name))
+    name++;
+
+  for (size_t i = 0; i < strlen(comment); i++) {
+    p = strchr(name, comment[i]);
+    if (p) {
+      if (p == name)
+	ref_append_comment(&parser->current_comment_before_key, p+1);
+      else
+	ref_append_comment(&parser->current_comment_after_value, p+1);
+      trace_comment(parser->out, p+1, p != name, parser->line);
+      *p = '\0';
+    }
+  }
+
+  if (!*buf)
+    goto out;
+
+  if (name[0] == '[') {
+    p = name + strlen(name) - 1;
+    while (isspace (*p)) p--;
+    if (*p != ']') {
+      retval = strchr(name,']') == NULL ? ECONF_MISSING_BRACKET
+					: ECONF_TEXT_AFTER_SECTION;
+      goto out;
+    }
+    p++;
+    *p = '\0';
+    if (strlen(name) <= 2) {
+      retval = ECONF_EMPTY_SECTION_NAME;
+      goto out;
+    }
+    free (parser->current_group);
+    parser->current_group = strdup (name);
+    trace_group(parser->out, name, parser->line);
+    goto out;
+  }
+
+  data = name;
+  while (*data && !(isspace((unsigned)*data) ||
+		    strchr(delim, *data) != NULL))
+    data++;
+  if (data > name && *data) {
+    if (parser->has_wsp && parser->has_nonwsp)
+      delim_seen = !isspace((unsigned)*data) && strchr(delim, *data) != NULL;
+    else
+      delim_seen = strchr(delim, *data) != NULL;
+    *data++ = '\0';
+  }
+
+  econf_parse_entry entry = {
+    .group = parser->current_group,
+    .comment_before_key = parser->current_comment_before_key,
+    .comment_after_value = parser->current_comment_after_value,
+    .line_number = parser->line,
+    .line_start = line_start,
+    .line_end = line_end,
+  };
+
+  bool found_delim = delim_seen;
+  if (!found_delim) {
+    char *c = data;
+    while (*c && !(strchr(delim, *c) != NULL))
+      c++;
+    if (*c)
+      found_delim = true;
+  }
+  if (!found_delim && parser->last_entry_line > 0 &&
+      parser->last_entry_line+1 == parser->line) {
+    for (size_t i = 0; i < strlen(comment); i++) {
+      char *pt = strchr(org_buf, comment[i]);
+      if (pt)
+	*pt = '\0';
+    }
+    if (org_buf[strlen(org_buf)-1] == '\n')
+      org_buf[strlen(org_buf)-1] = 0;
+    entry.value = org_buf;
+    entry.continuation = true;
+  } else {
+    if (!*name || data == name)
+      goto out;
+
+    if (*data == '\0')
+      data = NULL;
+    else {
+      while (*data && isspace((unsigned)*data))
+	data++;
+      if (!parser->has_wsp && !delim_seen) {
+	if (!*data || strchr(delim, *data) == NULL) {
+	  retval = ECONF_MISSING_DELIMITER;
+	  goto out;
+	}
+	data++;
+	while (*data && isspace((unsigned)*data))
+	  data++;
+      } else if (parser->has_wsp && parser->has_nonwsp && !delim_seen &&
+		 *data && strchr(delim, *data) != NULL) {
+	data++;
+	while (*data && isspace((unsigned)*data))
+	  data++;
+      }
+      if (*data == '"') {
+	quote_seen = true;
+	data++;
+      }
+
+      p = data + strlen(data);
+      if (p > data)
+	p--;
+      while (p > data && (isspace((unsigned)*p)))
+	p--;
+      if (p > data && quote_seen) {
+	if (*p == '"')
+	  p--;
+	else
+	  data--;
+      }
+      if (*(p + 1) != '\0')
+	*(p + 1) = '\0';
+    }
+
+    entry.key = name;
+    entry.value = data;
+    if (data) {
+      entry.value_start = line_start + (size_t) (data - buf);
+      entry.value_end = entry.value_start + strlen(data);
+    }
+  }
+
+  trace_entry(parser->out, &entry);
+  parser->last_entry_line = parser->line;
+  free(parser->current_comment_before_key);
+  parser->current_comment_before_key = NULL;
+  free(parser->current_comment_after_value);
+  parser->current_comment_after_value = NULL;
+
+ out:
+  free(org_buf);
+  return retval;
+}
+
+static econf_err
+ref_parse(const char *text, const char *delim, const char *comment, FILE *out)
+{
+  struct ref_parser parser = {
+    .delim = delim,
+    .comment = comment,
+    .out = out,
+  };
+  econf_err retval = ECONF_SUCCESS;
+
+  for (const char *p = delim; *p; p++) {
+    if (isspace((unsigned char) *p))
+      parser.has_wsp = true;
+    else
+      parser.has_nonwsp = true;
+  }
+
+  while (*text && !retval) {
+    const char *newline = strchr(text, '\n');
+    size_t length = newline ? (size_t) (newline - text) + 1 : strlen(text);
+    /* The former parser could read behind the end of the line */
+    char *buf = calloc(length + 2, 1);
+    memcpy(buf, text, length);
+    retval = ref_parse_line(&parser, buf, length);
+    free(buf);
+    text += length;
+  }
+
+  free(parser.current_group);
+  free(parser.current_comment_before_key);
+  free(parser.current_comment_after_value);
+  return retval;
+}
+
+/* Parser of the library */
+
+static econf_err
+on_group(void *data, const char *group, uint64_t line_number)
+{
+  trace_group(data, group, line_number);
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+on_entry(void *data, const econf_parse_entry *entry)
+{
+  trace_entry(data, entry);
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+on_comment(void *data, const char *comment, bool after_value,
+	   uint64_t line_number)
+{
+  trace_comment(data, comment, after_value, line_number);
+  return ECONF_SUCCESS;
+}
+
+static econf_err
+lib_parse(const char *text, const char *delim, const char *comment, FILE *out)
+{
+  static const econf_parse_callbacks callbacks = {
+    .on_group = on_group,
+    .on_entry = on_entry,
+    .on_comment = on_comment,
+  };
+  econf_parser *parser;
+  econf_err error = econf_newParser(&parser, delim, comment, &callbacks, out);
+  if (error)
+    return error;
+  error = econf_parserFeed(parser, text, strlen(text));
+  if (!error)
+    error = econf_parserFinish(parser);
+  econf_freeParser(parser);
+  return error;
+}
+
+/* Random files */
+
+static const char *const tokens[] = {
+  "key", "k_2", "value", "a.b", " ", "  ", "\t", "=", "==", ":", "#", ";",
+  "!", "\"", "\"quoted value\"", "]", "[x]", "0123456789abcdef",
+  "a_rather_long_token_for_the_vectorized_path"
+};
+
+static char *
+random_text(size_t lines)
+{
+  char *text = NULL;
+  size_t length;
+  FILE *out = open_memstream(&text, &length);
+
+  for (size_t i = 0; i < lines; i++) {
+    if (rand() % 8 == 0)
+      fputs(rand() % 2 ? "[group]" : " [other] ", out);
+    else {
+      int count = rand() % 10;
+      for (int j = 0; j < count; j++)
+	fputs(tokens[rand() % (sizeof(tokens) / sizeof(tokens[0]))], out);
+    }
+    if (i + 1 < lines || rand() % 2)
+      fputc('\n', out);
+  }
+  fclose(out);
+  return text;
+}
+
+int
+main(void)
+{
+  static const char *const formats[][2] = {
+    { "=", "#" },
+    { " \t=", "#" },
+    { " \t", "#;" },
+    { ":", "#;!" },
+    { "=:", ";#" },
+  };
+  size_t files = 0, errors = 0;
+
+  srand(37);
+  for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+    const char *delim = formats[f][0], *comment = formats[f][1];
+    for (int i = 0; i < 2000; i++) {
+      char *text = random_text(1 + rand() % 8);
+      struct trace expected, result;
+      econf_err expected_error, result_error;
+
+      expected.out = open_memstream(&expected.text, &expected.length);
+      expected_error = ref_parse(text, delim, comment, expected.out);
+      fclose(expected.out);
+      result.out = open_memstream(&result.text, &result.length);
+      result_error = lib_parse(text, delim, comment, result.out);
+      fclose(result.out);
+
+      if (expected_error != result_error ||
+	  strcmp(expected.text, result.text) != 0) {
+	fprintf(stderr, "ERROR: delim \"%s\", comment \"%s\", text:\n%s\n"
+		"expected (%d):\n%s\ngot (%d):\n%s\n", delim, comment, text,
+		expected_error, expected.text, result_error, result.text);
+	return 1;
+      }
+      files++;
+      if (expected_error)
+	errors++;
+      free(expected.text);
+      free(result.text);
+      free(text);
+    }
+  }
+
+  /* Make sure that not only errors have been compared */
+  if (errors * 2 > files) {
+    fprintf(stderr, "ERROR: %zu of %zu files could not be parsed\n",
+	    errors, files);
+    return 1;
+  }
+  return 0;
+}
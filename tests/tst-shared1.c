@@ -0,0 +1,188 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Publish a merged configuration and attach it again, also in a child
+   process. The attached configuration has the same entries, can be read
+   with the getters but cannot be changed. Files which are not a sealed
+   configuration are rejected, also regular files with valid content.
+*/
+
+#define TEST_DIR TESTSDIR"tst-getconfdirs1-data"
+
+static int
+same_string(const char *a, const char *b)
+{
+  return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static int
+compare(econf_file *expected, econf_file *attached)
+{
+  econf_entry e, a;
+  size_t ce = 0, ca = 0;
+  econf_err error;
+
+  while ((error = econf_nextEntry(expected, &ce, &e)) == ECONF_SUCCESS)
+    {
+      if (econf_nextEntry(attached, &ca, &a))
+	{
+	  fprintf (stderr, "ERROR: attached file has too few entries\n");
+	  return 1;
+	}
+      if (!same_string(e.group, a.group) || !same_string(e.key, a.key) ||
+	  !same_string(e.value, a.value) ||
+	  !same_string(e.comment_before_key, a.comment_before_key) ||
+	  !same_string(e.comment_after_value, a.comment_after_value) ||
+	  !same_string(e.file, a.file) || e.line_number != a.line_number)
+	{
+	  fprintf (stderr, "ERROR: entry %s differs: %s != %s\n", e.key,
+		   e.value ? e.value : "(null)", a.value ? a.value : "(null)");
+	  return 1;
+	}
+    }
+  if (econf_nextEntry(attached, &ca, &a) != ECONF_NOKEY)
+    {
+      fprintf (stderr, "ERROR: attached file has too many entries\n");
+      return 1;
+    }
+  return 0;
+}
+
+static int
+check_attached(econf_file *key_file, int fd)
+{
+  econf_file *attached = NULL;
+  econf_memory_usage usage;
+  econf_err error;
+  char *value;
+
+  if ((error = econf_attach(&attached, fd)))
+    {
+      fprintf (stderr, "ERROR: econf_attach: %s\n", econf_errString(error));
+      return 1;
+    }
+  int retval = compare(key_file, attached);
+  if ((error = econf_getStringValue(attached, NULL, "KEY1", &value)) ||
+      strcmp(value, "etcconfd") != 0)
+    {
+      fprintf (stderr, "ERROR: wrong value of KEY1\n");
+      retval = 1;
+    }
+  else
+    free(value);
+  if (econf_setStringValue(attached, NULL, "KEY1", "changed") != ECONF_ERROR ||
+      econf_deleteKey(attached, NULL, "KEY1") != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: attached configuration has been changed\n");
+      retval = 1;
+    }
+  if (econf_memoryUsage(attached, &usage) || usage.shared == 0 ||
+      usage.strings != 0)
+    {
+      fprintf (stderr, "ERROR: wrong memory usage of attached file\n");
+      retval = 1;
+    }
+  econf_free(attached);
+  return retval;
+}
+
+static int
+check_rejected(int fd, const char *what)
+{
+  econf_file *attached = NULL;
+  if (econf_attach(&attached, fd) != ECONF_ERROR || attached != NULL)
+    {
+      fprintf (stderr, "ERROR: %s has been attached\n", what);
+      return 1;
+    }
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  int fd, retval = 0;
+
+  error = econf_readDirs(&key_file, TEST_DIR"/usr/etc", TEST_DIR"/etc",
+			 "getconfdir", "conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirs: %s\n", econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_publish(key_file, &fd)))
+    {
+      fprintf (stderr, "ERROR: econf_publish: %s\n", econf_errString(error));
+      return 1;
+    }
+
+  retval |= check_attached(key_file, fd);
+
+  /* A regular file could be truncated while it is mapped */
+  char path[] = "/tmp/tst-shared1-XXXXXX";
+  int file_fd = mkstemp(path);
+  if (file_fd >= 0)
+    {
+      char buffer[4096];
+      ssize_t length;
+      unlink(path);
+      while ((length = pread(fd, buffer, sizeof(buffer),
+			     lseek(file_fd, 0, SEEK_CUR))) > 0 &&
+	     write(file_fd, buffer, (size_t) length) == length)
+	;
+      retval |= check_rejected(file_fd, "regular file");
+      close(file_fd);
+    }
+
+  pid_t pid = fork();
+  if (pid == 0)
+    _exit(check_attached(key_file, fd));
+  int status;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0)
+    {
+      fprintf (stderr, "ERROR: attaching in child failed\n");
+      retval = 1;
+    }
+  close(fd);
+
+  /* Not a regular file */
+  int pipefd[2];
+  if (pipe(pipefd) == 0)
+    {
+      retval |= check_rejected(pipefd[0], "pipe");
+      close(pipefd[0]);
+      close(pipefd[1]);
+    }
+
+  /* Memory files which are not sealed or contain garbage */
+  fd = memfd_create("test", MFD_ALLOW_SEALING);
+  if (fd >= 0)
+    {
+      char garbage[4096];
+      memset(garbage, 'x', sizeof(garbage));
+      if (write(fd, garbage, sizeof(garbage)) == sizeof(garbage))
+	{
+	  retval |= check_rejected(fd, "unsealed file");
+	  fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE);
+	  retval |= check_rejected(fd, "garbage");
+	}
+      close(fd);
+    }
+
+  econf_free(key_file);
+  return retval;
+}
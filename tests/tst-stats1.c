@@ -0,0 +1,140 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read a configuration with ECONF_OPT_STATS. The totals are the sums
+   of the statistics of every file and the sizes are the sizes of the
+   files. Without the option there are no statistics.
+*/
+
+#define TEST_DIR TESTSDIR"tst-getconfdirs1-data"
+
+static int
+check_stats(const econf_stats *stats)
+{
+  uint64_t bytes = 0, lines = 0, entries = 0;
+  int retval = 0;
+
+  if (stats->files == 0 || stats->files != stats->file_stats_length)
+    {
+      fprintf (stderr, "ERROR: %llu files, %zu file statistics\n",
+	       (unsigned long long)stats->files, stats->file_stats_length);
+      return 1;
+    }
+  for (size_t i = 0; i < stats->file_stats_length; i++)
+    {
+      const econf_file_stats *fs = &stats->file_stats[i];
+      struct stat st;
+      if (stat(fs->path, &st) != 0 || (uint64_t)st.st_size != fs->bytes)
+	{
+	  fprintf (stderr, "ERROR: wrong size of %s: %llu\n", fs->path,
+		   (unsigned long long)fs->bytes);
+	  retval = 1;
+	}
+      if (fs->lines == 0 || fs->entries == 0)
+	{
+	  fprintf (stderr, "ERROR: %s has %llu lines and %llu entries\n",
+		   fs->path, (unsigned long long)fs->lines,
+		   (unsigned long long)fs->entries);
+	  retval = 1;
+	}
+      bytes += fs->bytes;
+      lines += fs->lines;
+      entries += fs->entries;
+    }
+  if (bytes != stats->bytes || lines != stats->lines ||
+      entries != stats->entries)
+    {
+      fprintf (stderr, "ERROR: totals are not the sums of the files\n");
+      retval = 1;
+    }
+  if (stats->allocations == 0 ||
+      stats->total_ns < stats->parse_ns + stats->join_ns + stats->merge_ns)
+    {
+      fprintf (stderr, "ERROR: wrong allocations or times\n");
+      retval = 1;
+    }
+  return retval;
+}
+
+int
+main(void)
+{
+  econf_options *options = NULL;
+  econf_file *key_file = NULL;
+  econf_stats stats;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_newOptions(&options)) ||
+      (error = econf_setOpt(options, ECONF_OPT_STATS, true)))
+    {
+      fprintf (stderr, "ERROR: couldn't create options: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  error = econf_readDirsWithOptions(&key_file, TEST_DIR"/usr/etc",
+				    TEST_DIR"/etc", "getconfdir", "conf",
+				    "=", "#", options);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readDirsWithOptions: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if ((error = econf_getStats(key_file, &stats)))
+    {
+      fprintf (stderr, "ERROR: econf_getStats: %s\n", econf_errString(error));
+      return 1;
+    }
+  /* getconfdir.conf in /etc and two drop-in files */
+  if (stats.files != 3)
+    {
+      fprintf (stderr, "ERROR: %llu files read, expected 3\n",
+	       (unsigned long long)stats.files);
+      retval = 1;
+    }
+  retval |= check_stats(&stats);
+  econf_free(key_file);
+
+  error = econf_readFileWithOptions(&key_file, TEST_DIR"/etc/getconfdir.conf",
+				    "=", "#", options);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readFileWithOptions: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (econf_getStats(key_file, &stats) || stats.files != 1)
+    {
+      fprintf (stderr, "ERROR: no statistics of a single file\n");
+      retval = 1;
+    }
+  else
+    retval |= check_stats(&stats);
+  econf_free(key_file);
+  econf_freeOptions(options);
+
+  error = econf_readFile(&key_file, TEST_DIR"/etc/getconfdir.conf", "=", "#");
+  if (error)
+    {
+      fprintf (stderr, "ERROR: econf_readFile: %s\n", econf_errString(error));
+      return 1;
+    }
+  if (econf_getStats(key_file, &stats) != ECONF_ERROR)
+    {
+      fprintf (stderr, "ERROR: statistics without ECONF_OPT_STATS\n");
+      retval = 1;
+    }
+  econf_free(key_file);
+
+  return retval;
+}
@@ -0,0 +1,200 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Read a file once and look up its values from several threads at the
+   same time. Lookups must not change the econf_file, so all threads
+   have to get the same results, and the profile of the lookups must
+   count all of them. The test is most useful if built with
+   -fsanitize=thread.
+*/
+
+#define THREADS 4
+#define ROUNDS 200
+#define GROUPS 20
+#define KEYS 20
+
+static econf_file *key_file;
+
+/* Write GROUPS groups with KEYS keys each */
+static int
+generate(const char *path)
+{
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL)
+    return 1;
+  for (int g = 0; g < GROUPS; g++)
+    {
+      fprintf(fp, "[group%d]\n", g);
+      for (int k = 0; k < KEYS; k++)
+	fprintf(fp, "key%d = %d\n", k, g * KEYS + k);
+      fprintf(fp, "flag = %s\nlist = a\n  b\n  c\n", g % 2 ? "yes" : "no");
+    }
+  return fclose(fp) != 0;
+}
+
+static void *
+lookup(void *arg)
+{
+  /* Every thread starts at another group, so they meet on the same
+     entries in different orders.  */
+  int offset = *(int *) arg;
+  char group[32], key[32];
+
+  for (int round = 0; round < ROUNDS; round++)
+    {
+      int g = (round + offset) % GROUPS;
+      snprintf(group, sizeof(group), "group%d", g);
+      for (int k = 0; k < KEYS; k++)
+	{
+	  int32_t ival;
+	  double dval;
+	  snprintf(key, sizeof(key), "key%d", k);
+	  if (econf_getIntValue(key_file, group, key, &ival) ||
+	      ival != g * KEYS + k)
+	    {
+	      fprintf (stderr, "ERROR: %s/%s is not %d\n", group, key,
+		       g * KEYS + k);
+	      return arg;
+	    }
+	  /* Another type is converted but not cached */
+	  if (econf_getDoubleValue(key_file, group, key, &dval) ||
+	      dval != g * KEYS + k)
+	    {
+	      fprintf (stderr, "ERROR: %s/%s is not %d as double\n", group,
+		       key, g * KEYS + k);
+	      return arg;
+	    }
+	}
+
+      bool bval;
+      econf_ext_value_view view;
+      if (econf_getBoolValue(key_file, group, "flag", &bval) ||
+	  bval != (g % 2))
+	{
+	  fprintf (stderr, "ERROR: wrong flag in %s\n", group);
+	  return arg;
+	}
+      if (econf_getExtValueView(key_file, group, "list", &view) ||
+	  view.values_length != 3 || view.values[2].length != 1 ||
+	  view.values[2].start[0] != 'c')
+	{
+	  fprintf (stderr, "ERROR: wrong list in %s\n", group);
+	  return arg;
+	}
+      if (econf_getIntValue(key_file, group, "missing", &(int32_t){0}) !=
+	  ECONF_NOKEY)
+	{
+	  fprintf (stderr, "ERROR: found a missing key in %s\n", group);
+	  return arg;
+	}
+
+      size_t length;
+      char **keys;
+      if (econf_getKeys(key_file, group, &length, &keys) ||
+	  length != KEYS + 2)
+	{
+	  fprintf (stderr, "ERROR: wrong keys in %s\n", group);
+	  return arg;
+	}
+      econf_freeArray(keys);
+    }
+  return NULL;
+}
+
+int
+main(void)
+{
+  char path[] = "/tmp/tst-threads1-XXXXXX";
+  pthread_t threads[THREADS];
+  int offsets[THREADS];
+  econf_options *options = NULL;
+  econf_err error;
+  int retval = 0;
+
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return 1;
+  close(fd);
+  if (generate(path))
+    {
+      unlink(path);
+      return 1;
+    }
+  if ((error = econf_newOptions(&options)) ||
+      (error = econf_setOpt(options, ECONF_OPT_PROFILE_LOOKUPS, true)))
+    {
+      unlink(path);
+      return 1;
+    }
+  error = econf_readFileWithOptions(&key_file, path, "=", "#", options);
+  econf_freeOptions(options);
+  unlink(path);
+  if (error)
+    {
+      fprintf (stderr, "ERROR: couldn't read %s: %s\n", path,
+	       econf_errString(error));
+      return 1;
+    }
+
+  for (int i = 0; i < THREADS; i++)
+    {
+      offsets[i] = i * GROUPS / THREADS;
+      if (pthread_create(&threads[i], NULL, lookup, &offsets[i]))
+	{
+	  fprintf (stderr, "ERROR: couldn't create thread %d\n", i);
+	  return 1;
+	}
+    }
+  for (int i = 0; i < THREADS; i++)
+    {
+      void *result;
+      pthread_join(threads[i], &result);
+      if (result)
+	retval = 1;
+    }
+
+  /* Every group has been visited ROUNDS / GROUPS times by every thread,
+     which reads every number twice and looks up one missing key.  */
+  econf_lookup *lookups;
+  size_t length;
+  if ((error = econf_getLookups(key_file, &lookups, &length)))
+    {
+      fprintf (stderr, "ERROR: econf_getLookups: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  uint64_t visits = THREADS * ROUNDS / GROUPS;
+  for (size_t i = 0; i < length; i++)
+    {
+      uint64_t expected = !lookups[i].found ? visits :
+	strncmp(lookups[i].key, "key", 3) == 0 ? 2 * visits : visits;
+      if (lookups[i].count != expected)
+	{
+	  fprintf (stderr, "ERROR: %s %s has been looked up %" PRIu64
+		   " times instead of %" PRIu64 "\n", lookups[i].group,
+		   lookups[i].key, lookups[i].count, expected);
+	  retval = 1;
+	  break;
+	}
+    }
+  if (length != GROUPS * (KEYS + 3))
+    {
+      fprintf (stderr, "ERROR: %zu lookups\n", length);
+      retval = 1;
+    }
+  econf_freeLookups(lookups);
+
+  econf_free(key_file);
+  return retval;
+}
@@ -0,0 +1,98 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   The typed getters cache the converted value per entry. Check that
+   the cache is invalidated by the setters, that switching between types
+   returns correct values and that reading a bool does not modify the
+   stored string.
+*/
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  int32_t ival;
+  double dval;
+  bool bval;
+  char *sval;
+
+  if ((error = econf_newIniFile(&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  econf_setIntValue(key_file, "group", "key", 1);
+  for (int i = 0; i < 2; i++)
+    {
+      if ((error = econf_getIntValue(key_file, "group", "key", &ival)) ||
+	  ival != 1)
+	{
+	  fprintf (stderr, "ERROR: expected 1, got %d (%s)\n", ival,
+		   econf_errString(error));
+	  return 1;
+	}
+    }
+
+  econf_setIntValue(key_file, "group", "key", 2);
+  if ((error = econf_getIntValue(key_file, "group", "key", &ival)) || ival != 2)
+    {
+      fprintf (stderr, "ERROR: cache not invalidated, expected 2, got %d\n",
+	       ival);
+      return 1;
+    }
+
+  if ((error = econf_getDoubleValue(key_file, "group", "key", &dval)) ||
+      dval != 2.0)
+    {
+      fprintf (stderr, "ERROR: expected 2.0, got %f\n", dval);
+      return 1;
+    }
+
+  econf_setStringValue(key_file, "group", "key", "YES");
+  if ((error = econf_getBoolValue(key_file, "group", "key", &bval)) || !bval)
+    {
+      fprintf (stderr, "ERROR: expected true for 'YES'\n");
+      return 1;
+    }
+  if ((error = econf_getStringValue(key_file, "group", "key", &sval)))
+    {
+      fprintf (stderr, "ERROR: couldn't get string: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (strcmp(sval, "YES") != 0)
+    {
+      fprintf (stderr, "ERROR: value has been modified: '%s'\n", sval);
+      free(sval);
+      return 1;
+    }
+  free(sval);
+
+  econf_setBoolValue(key_file, "group", "key", "no");
+  if ((error = econf_getBoolValue(key_file, "group", "key", &bval)) || bval)
+    {
+      fprintf (stderr, "ERROR: cache not invalidated, expected false\n");
+      return 1;
+    }
+
+  econf_setStringValue(key_file, "group", "key", "maybe");
+  if (econf_getBoolValue(key_file, "group", "key", &bval) != ECONF_PARSE_ERROR)
+    {
+      fprintf (stderr, "ERROR: 'maybe' should not be parsed as bool\n");
+      return 1;
+    }
+
+  econf_free (key_file);
+
+  return 0;
+}
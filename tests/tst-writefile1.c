@@ -0,0 +1,101 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf_ext.h"
+
+/* Test case:
+   Set keys of different groups in mixed order, write the file and read
+   it again. Every group has to be written only once, containing all of
+   its keys in the order they have been set.
+*/
+
+int
+main(void)
+{
+  econf_file *key_file = NULL, *read_file = NULL;
+  econf_entry entry;
+  size_t cursor = 0, count = 0;
+  econf_err error;
+  char dir[] = "/tmp/tst-writefile1-XXXXXX";
+  char *path;
+  int retval = 0;
+  static const struct {
+    const char *const group;
+    const char *const key;
+  } expected[] = {
+    { "[first]", "key1" },
+    { "[first]", "key2" },
+    { "[first]", "key3" },
+    { "[second]", "key1" },
+    { "[second]", "key2" },
+  };
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+
+  if ((error = econf_newIniFile (&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  econf_setStringValue(key_file, "first", "key1", "1");
+  econf_setStringValue(key_file, "second", "key1", "1");
+  econf_setStringValue(key_file, "first", "key2", "2");
+  econf_setStringValue(key_file, "second", "key2", "2");
+  econf_setStringValue(key_file, "first", "key3", "3");
+
+  if ((error = econf_writeFile(key_file, dir, "test.conf")))
+    {
+      fprintf (stderr, "ERROR: couldn't write file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  econf_free (key_file);
+
+  if (asprintf(&path, "%s/test.conf", dir) < 0)
+    return 1;
+  if ((error = econf_readFile (&read_file, path, "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read written file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  while (econf_nextEntry (read_file, &cursor, &entry) == ECONF_SUCCESS)
+    {
+      if (count >= sizeof(expected)/sizeof(expected[0]) ||
+	  strcmp (entry.group, expected[count].group) != 0 ||
+	  strcmp (entry.key, expected[count].key) != 0)
+	{
+	  fprintf (stderr, "ERROR: unexpected entry %zu: %s %s\n", count,
+		   entry.group, entry.key);
+	  retval = 1;
+	  break;
+	}
+      count++;
+    }
+  if (retval == 0 && count != sizeof(expected)/sizeof(expected[0]))
+    {
+      fprintf (stderr, "ERROR: expected %zu entries, got %zu\n",
+	       sizeof(expected)/sizeof(expected[0]), count);
+      retval = 1;
+    }
+
+  econf_free (read_file);
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
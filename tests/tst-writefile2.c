@@ -0,0 +1,214 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   Replace an existing file with econf_writeFileWithFlags(). The
+   permissions and the owner of the file have to be kept and no temporary
+   file may be left in the directory. Writing to a symbolic link replaces
+   the file it points to, writing to a dangling link and into a not
+   existing directory fails. A user who may write the file but cannot
+   give a new file its owner or cannot create files in the directory
+   overwrites it in place.
+*/
+
+/* Value of group/key in the file path */
+static int
+check_value(const char *path, const char *expected)
+{
+  econf_file *read_file = NULL;
+  char *value = NULL;
+  econf_err error;
+  int retval = 0;
+
+  if ((error = econf_readFile (&read_file, path, "=", "#")) ||
+      (error = econf_getStringValue (read_file, "group", "key", &value)) ||
+      strcmp(value, expected) != 0)
+    {
+      fprintf (stderr, "ERROR: wrong content of %s: %s\n", path,
+	       value ? value : econf_errString(error));
+      retval = 1;
+    }
+  free(value);
+  econf_free (read_file);
+  return retval;
+}
+
+/* Write value into dir/test.conf as user nobody, whose directory may
+   be written depending on dir_mode. The file stays owned by root.  */
+static int
+write_as_other_user(econf_file *key_file, const char *dir, const char *path,
+		    mode_t dir_mode, const char *value)
+{
+  struct stat st;
+  int status;
+
+  if (chown(path, 0, 0) || chmod(path, 0666) || chmod(dir, dir_mode))
+    return 1;
+  econf_setStringValue(key_file, "group", "key", value);
+  pid_t pid = fork();
+  if (pid < 0)
+    return 1;
+  if (pid == 0)
+    {
+      econf_err error;
+      if (setgid(65534) || setuid(65534))
+	_exit(2);
+      if ((error = econf_writeFile(key_file, dir, "test.conf")))
+	{
+	  fprintf (stderr, "ERROR: couldn't write the file of another user "
+		   "in a directory with mode %o: %s\n", (unsigned int) dir_mode,
+		   econf_errString(error));
+	  _exit(1);
+	}
+      _exit(0);
+    }
+  waitpid(pid, &status, 0);
+  chmod(dir, 0700);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return 1;
+  if (stat(path, &st) || st.st_uid != 0 || (st.st_mode & 07777) != 0666)
+    {
+      fprintf (stderr, "ERROR: file of another user has been replaced\n");
+      return 1;
+    }
+  return check_value(path, value);
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  char dir[] = "/tmp/tst-writefile2-XXXXXX";
+  char *path;
+  struct stat st;
+  int retval = 0;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  if (asprintf(&path, "%s/test.conf", dir) < 0)
+    return 1;
+
+  if ((error = econf_newIniFile (&key_file)))
+    {
+      fprintf (stderr, "ERROR: couldn't create key file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  econf_setStringValue(key_file, "group", "key", "value");
+
+  if ((error = econf_writeFile(key_file, dir, "test.conf")))
+    {
+      fprintf (stderr, "ERROR: couldn't write file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  chmod(path, 0640);
+
+  econf_setStringValue(key_file, "group", "key", "changed");
+  if ((error = econf_writeFileWithFlags(key_file, dir, "test.conf",
+					ECONF_WRITE_SYNC)))
+    {
+      fprintf (stderr, "ERROR: couldn't write file with ECONF_WRITE_SYNC: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  if (stat(path, &st) || (st.st_mode & 07777) != 0640)
+    {
+      fprintf (stderr, "ERROR: permissions have not been kept: %o\n",
+	       (unsigned int) (st.st_mode & 07777));
+      retval = 1;
+    }
+
+  retval |= check_value(path, "changed");
+
+  DIR *d = opendir(dir);
+  struct dirent *de;
+  int files = 0;
+  while (d && (de = readdir(d)) != NULL)
+    if (de->d_name[0] != '.')
+      files++;
+  if (d)
+    closedir(d);
+  if (files != 1)
+    {
+      fprintf (stderr, "ERROR: %d files found in %s, expected 1\n", files, dir);
+      retval = 1;
+    }
+
+  /* Only root can give the file to somebody else */
+  if (geteuid() == 0)
+    {
+      if (chown(path, 65534, 65534) ||
+	  (error = econf_writeFile(key_file, dir, "test.conf")) ||
+	  stat(path, &st) || st.st_uid != 65534 || st.st_gid != 65534)
+	{
+	  fprintf (stderr, "ERROR: owner has not been kept\n");
+	  retval = 1;
+	}
+      retval |= write_as_other_user(key_file, dir, path, 0777, "in place");
+      retval |= write_as_other_user(key_file, dir, path, 0755, "no tmp file");
+    }
+
+  char *link_path, *dangling_path;
+  if (asprintf(&link_path, "%s/link.conf", dir) < 0 ||
+      asprintf(&dangling_path, "%s/dangling.conf", dir) < 0)
+    return 1;
+  if (symlink("test.conf", link_path) ||
+      symlink("missing.conf", dangling_path))
+    {
+      perror("symlink");
+      return 1;
+    }
+  econf_setStringValue(key_file, "group", "key", "linked");
+  if ((error = econf_writeFile(key_file, dir, "link.conf")))
+    {
+      fprintf (stderr, "ERROR: couldn't write through a link: %s\n",
+	       econf_errString(error));
+      retval = 1;
+    }
+  if (lstat(link_path, &st) || !S_ISLNK(st.st_mode))
+    {
+      fprintf (stderr, "ERROR: link has been replaced\n");
+      retval = 1;
+    }
+  retval |= check_value(path, "linked");
+  if (econf_writeFile(key_file, dir, "dangling.conf") != ECONF_WRITEERROR ||
+      lstat(dangling_path, &st) || !S_ISLNK(st.st_mode))
+    {
+      fprintf (stderr, "ERROR: dangling link has been written\n");
+      retval = 1;
+    }
+  unlink(link_path);
+  unlink(dangling_path);
+  free(link_path);
+  free(dangling_path);
+
+  if (econf_writeFile(key_file, "/tmp/tst-writefile2-does-not-exist",
+		      "test.conf") != ECONF_NOFILE)
+    {
+      fprintf (stderr, "ERROR: writing into a not existing directory\n");
+      retval = 1;
+    }
+
+  econf_free (key_file);
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
@@ -0,0 +1,129 @@
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+
+/* Test case:
+   Write a file which has been read with ECONF_WRITE_LOSSLESS. Without
+   changes the written file has to be identical to the original. After
+   changing, deleting and adding keys only these lines may differ.
+*/
+
+static const char *expected =
+  "# global comment\n"
+  "global = 1\n"
+  "global2=2\n"
+  "\n"
+  "[first]\n"
+  "# comment before a\n"
+  "a = \"new value\"   # trailing comment\n"
+  "c = 3\n"
+  "d=4\n"
+  "\n"
+  "[second]\n"
+  "x = 10\n"
+  "\n"
+  "[third]\n"
+  "y=5\n";
+
+static char *
+read_content(const char *path)
+{
+  char *content = NULL;
+  size_t length = 0;
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL)
+    return NULL;
+  if (getdelim(&content, &length, '\0', fp) < 0)
+    {
+      free(content);
+      content = NULL;
+    }
+  fclose(fp);
+  return content;
+}
+
+static int
+write_and_compare(econf_file *key_file, const char *dir, const char *path,
+		  const char *content)
+{
+  econf_err error;
+  if ((error = econf_writeFileWithFlags(key_file, dir, "test.conf",
+					ECONF_WRITE_LOSSLESS)))
+    {
+      fprintf (stderr, "ERROR: couldn't write file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+  char *written = read_content(path);
+  if (written == NULL || strcmp(written, content) != 0)
+    {
+      fprintf (stderr, "ERROR: written file differs:\n%s\nexpected:\n%s\n",
+	       written ? written : "(null)", content);
+      free(written);
+      return 1;
+    }
+  free(written);
+  return 0;
+}
+
+int
+main(void)
+{
+  econf_file *key_file = NULL;
+  econf_err error;
+  char dir[] = "/tmp/tst-writefile3-XXXXXX";
+  char *path, *original;
+  int retval = 0;
+
+  if (mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  if (asprintf(&path, "%s/test.conf", dir) < 0)
+    return 1;
+
+  original = read_content(TESTSDIR"tst-writefile3-data/test.conf");
+  if (original == NULL)
+    {
+      fprintf (stderr, "ERROR: couldn't read test data\n");
+      return 1;
+    }
+
+  if ((error = econf_readFile (&key_file, TESTSDIR"tst-writefile3-data/test.conf",
+			       "=", "#")))
+    {
+      fprintf (stderr, "ERROR: couldn't read configuration file: %s\n",
+	       econf_errString(error));
+      return 1;
+    }
+
+  retval |= write_and_compare(key_file, dir, path, original);
+
+  econf_setStringValue(key_file, "first", "a", "new value");
+  econf_deleteKey(key_file, "first", "b");
+  econf_setIntValue(key_file, "first", "d", 4);
+  econf_setIntValue(key_file, "third", "y", 5);
+  econf_setIntValue(key_file, NULL, "global2", 2);
+
+  retval |= write_and_compare(key_file, dir, path, expected);
+
+  /* The deleted key stays deleted after the file has been compacted */
+  econf_compact(key_file);
+  retval |= write_and_compare(key_file, dir, path, expected);
+
+  econf_free (key_file);
+  free(original);
+  unlink(path);
+  rmdir(dir);
+  free(path);
+
+  return retval;
+}
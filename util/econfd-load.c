@@ -0,0 +1,314 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/* Load test of econfd: some clients look up the same key as fast as
+   they can and the throughput and the latency of the round trips are
+   reported. */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+#include "libeconf_client.h"
+
+/* Latencies which are recorded per client at most */
+#define MAX_SAMPLES (4 * 1024 * 1024)
+
+static const char *utilname = "econfd-load";
+
+struct result {
+    uint64_t lookups;
+    uint64_t errors;
+    uint64_t samples;
+};
+
+/**
+ * @brief Shows the usage.
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [OPTIONS] <filename>.conf [GROUP] KEY\n\n", utilname);
+    fprintf(stderr, "Looks up KEY with econfd and reports lookups/sec and the latency.\n");
+    fprintf(stderr, "  -s, --socket=PATH:   socket of econfd, default %s\n", ECONFD_SOCKET);
+    fprintf(stderr, "  -c, --clients=N:     number of connections (processes), default 4\n");
+    fprintf(stderr, "  -b, --batch=N:       lookups per round trip, default 1\n");
+    fprintf(stderr, "  -d, --duration=SEC:  duration of the test, default 5\n");
+    fprintf(stderr, "  -t, --type=TYPE:     string, int, int64, uint, uint64, float, double\n");
+    fprintf(stderr, "                       or bool, default string\n\n");
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static int write_all(int fd, const void *data, size_t length)
+{
+    const char *cp = data;
+    while (length > 0) {
+        ssize_t n = write(fd, cp, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        cp += n;
+        length -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t length)
+{
+    char *cp = data;
+    while (length > 0) {
+        ssize_t n = read(fd, cp, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        cp += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Run one client until the deadline and write its result and
+ *        latencies to fd.
+ */
+static int run_client(int fd, const char *socket_path, econf_client_request *requests,
+                      size_t batch, uint64_t deadline)
+{
+    struct result result = { 0, 0, 0 };
+    uint64_t *samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+    econf_client *client;
+    econf_err error;
+
+    if (samples == NULL) {
+        fprintf(stderr, "%s: out of memory\n", utilname);
+        return EXIT_FAILURE;
+    }
+    if ((error = econf_clientConnect(&client, socket_path))) {
+        fprintf(stderr, "%s: cannot connect to %s: %s\n", utilname,
+                socket_path ? socket_path : ECONFD_SOCKET, econf_errString(error));
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start = now_ns();
+    while (start < deadline) {
+        if ((error = econf_clientBatch(client, requests, batch))) {
+            fprintf(stderr, "%s: connection failed: %s\n", utilname,
+                    econf_errString(error));
+            break;
+        }
+        uint64_t end = now_ns();
+        for (size_t i = 0; i < batch; i++) {
+            if (requests[i].error)
+                result.errors++;
+            else if (requests[i].type == ECONFD_GET_STRING)
+                free(requests[i].value.s);
+        }
+        result.lookups += batch;
+        if (result.samples < MAX_SAMPLES)
+            samples[result.samples++] = end - start;
+        start = end;
+    }
+    econf_clientDisconnect(client);
+
+    int ret = write_all(fd, &result, sizeof(result)) ||
+        write_all(fd, samples, result.samples * sizeof(uint64_t));
+    free(samples);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void print_latency(const char *name, uint64_t ns)
+{
+    if (ns >= 1000000)
+        printf("  %s %.2f ms", name, ns / 1e6);
+    else
+        printf("  %s %.1f us", name, ns / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option longopts[] = {
+        {"socket", required_argument, NULL, 's'},
+        {"clients", required_argument, NULL, 'c'},
+        {"batch", required_argument, NULL, 'b'},
+        {"duration", required_argument, NULL, 'd'},
+        {"type", required_argument, NULL, 't'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    static const char *const types[] = {
+        "string", "int", "int64", "uint", "uint64", "float", "double", "bool"
+    };
+    const char *socket_path = NULL;
+    long clients = 4, batch = 1;
+    double duration = 5;
+    econfd_request_type type = ECONFD_GET_STRING;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "hs:c:b:d:t:", longopts, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'c':
+            clients = strtol(optarg, NULL, 10);
+            break;
+        case 'b':
+            batch = strtol(optarg, NULL, 10);
+            break;
+        case 'd':
+            duration = strtod(optarg, NULL);
+            break;
+        case 't': {
+            size_t i;
+            for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+                if (strcmp(optarg, types[i]) == 0)
+                    break;
+            }
+            if (i == sizeof(types) / sizeof(types[0])) {
+                usage();
+                return EXIT_FAILURE;
+            }
+            type = (econfd_request_type) i;
+            break;
+        }
+        case 'h':
+            usage();
+            return EXIT_SUCCESS;
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind < 2 || argc - optind > 3 || clients < 1 || batch < 1 ||
+        duration <= 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    const char *project = argv[optind];
+    const char *group = argc - optind == 3 ? argv[optind + 1] : NULL;
+    const char *key = argv[argc - 1];
+
+    econf_client_request *requests = calloc(batch, sizeof(econf_client_request));
+    int *fds = calloc(clients, sizeof(int));
+    pid_t *pids = calloc(clients, sizeof(pid_t));
+    if (requests == NULL || fds == NULL || pids == NULL) {
+        fprintf(stderr, "%s: out of memory\n", utilname);
+        return EXIT_FAILURE;
+    }
+    for (long i = 0; i < batch; i++) {
+        requests[i].type = type;
+        requests[i].project = project;
+        requests[i].group = group;
+        requests[i].key = key;
+    }
+
+    uint64_t start = now_ns();
+    uint64_t deadline = start + (uint64_t) (duration * 1e9);
+    for (long i = 0; i < clients; i++) {
+        int pipefd[2];
+        if (pipe(pipefd) < 0) {
+            perror("pipe() failed");
+            return EXIT_FAILURE;
+        }
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            perror("fork() failed");
+            return EXIT_FAILURE;
+        }
+        if (pids[i] == 0) {
+            close(pipefd[0]);
+            _exit(run_client(pipefd[1], socket_path, requests, batch, deadline));
+        }
+        close(pipefd[1]);
+        fds[i] = pipefd[0];
+    }
+
+    struct result total = { 0, 0, 0 };
+    uint64_t *samples = NULL;
+    int ret = EXIT_SUCCESS;
+    for (long i = 0; i < clients; i++) {
+        struct result result;
+        if (read_all(fds[i], &result, sizeof(result)) == 0) {
+            uint64_t *tmp = realloc(samples, (total.samples + result.samples) * sizeof(uint64_t));
+            if (tmp == NULL ||
+                read_all(fds[i], tmp + total.samples, result.samples * sizeof(uint64_t))) {
+                fprintf(stderr, "%s: cannot read the result of client %ld\n", utilname, i);
+                ret = EXIT_FAILURE;
+                if (tmp)
+                    samples = tmp;
+            } else {
+                samples = tmp;
+                total.lookups += result.lookups;
+                total.errors += result.errors;
+                total.samples += result.samples;
+            }
+        } else {
+            ret = EXIT_FAILURE;
+        }
+        close(fds[i]);
+    }
+    for (long i = 0; i < clients; i++) {
+        int status;
+        waitpid(pids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            ret = EXIT_FAILURE;
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    printf("clients %ld, batch %ld, %.2f s\n", clients, batch, elapsed);
+    printf("lookups      %llu (%.0f/s)\n", (unsigned long long) total.lookups,
+           total.lookups / elapsed);
+    printf("errors       %llu\n", (unsigned long long) total.errors);
+    if (total.samples) {
+        qsort(samples, total.samples, sizeof(uint64_t), compare_u64);
+        printf("round trips  %llu\n", (unsigned long long) total.samples);
+        printf("latency    ");
+        print_latency("p50", samples[total.samples / 2]);
+        print_latency("p99", samples[total.samples * 99 / 100]);
+        print_latency("max", samples[total.samples - 1]);
+        printf("\n");
+    }
+    free(samples);
+    free(requests);
+    free(fds);
+    free(pids);
+    return ret;
+}
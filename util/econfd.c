@@ -0,0 +1,814 @@
+/*
+  Copyright (C) 2021 SUSE LLC
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+*/
+
+/* econfd loads and watches the configuration of some projects and
+   answers the lookups of libeconf_client over a UNIX socket. See
+   include/libeconf_client.h for the protocol. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libeconf.h"
+#include "libeconf_ext.h"
+#include "libeconf_client.h"
+
+/* Changes of the files are collected for this time before reloading */
+#define RELOAD_DELAY_MS 100
+
+/* Requests of a client are not read while more responses are waiting
+   to be sent, see CLIENT_WINDOW in lib/client.c */
+#define OUTPUT_LIMIT (1024 * 1024)
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | \
+                    IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static const char *utilname = "econfd";
+static const char *socket_path = ECONFD_SOCKET;
+static const char *usr_root_dir = "/usr/etc";
+static const char *root_dir = "/etc";
+static mode_t socket_mode = 0600;
+
+struct project {
+    /* name given on the command line, e.g. example.conf */
+    const char *name;
+    /* name without the suffix and the suffix (NULL if there is none) */
+    char *basename;
+    const char *suffix;
+    /* merged configuration, NULL if there is none */
+    econf_file *key_file;
+    /* econf_publish() of key_file, created on the first request */
+    int snapshot_fd;
+    /* watches of the drop-in directories, -1 if they do not exist */
+    int usr_dropin_wd, dropin_wd;
+    /* a file of the project has been changed, it is reloaded soon */
+    bool changed;
+};
+
+struct client {
+    /* -1 if the connection has been closed */
+    int fd;
+    /* received requests, a complete frame always fits */
+    char *in;
+    size_t in_length;
+    /* responses which have not been sent yet */
+    char *out;
+    size_t out_start, out_length, out_alloc_length;
+    /* snapshot which is sent with the response at fd_offset of out */
+    int passed_fd;
+    size_t fd_offset;
+};
+
+static struct project *projects;
+static size_t projects_length;
+static struct client *clients;
+static size_t clients_length, clients_alloc_length;
+static int inotify_fd = -1;
+/* watches of usr_root_dir and root_dir */
+static int usr_root_wd = -1, root_wd = -1;
+
+/**
+ * @brief Shows the usage.
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [OPTIONS] <filename>.conf...\n\n", utilname);
+    fprintf(stderr, "Loads the configuration of the given files (in /usr/etc and /etc), reloads\n");
+    fprintf(stderr, "it when the files are changed and answers the lookups of libeconf_client.\n");
+    fprintf(stderr, "  -s, --socket=PATH:  UNIX socket, default %s\n", ECONFD_SOCKET);
+    fprintf(stderr, "  --socket-mode=MODE: permissions of the socket, default 0600\n");
+    fprintf(stderr, "  --vendordir=DIR:    vendor directory, default /usr/etc\n");
+    fprintf(stderr, "  --etcdir=DIR:       directory of the administrator, default /etc\n");
+    fprintf(stderr, "  -h, --help:         shows this help.\n\n");
+    fprintf(stderr, "SIGHUP reloads all files.\n\n");
+}
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Watch the directories of all projects. Directories which do
+ *        not exist yet are noticed by the watch of their parent.
+ *        Existing watches are kept by inotify_add_watch(), which
+ *        returns the same watch descriptor again.
+ */
+static void add_watches(void)
+{
+    char path[4096];
+
+    usr_root_wd = inotify_add_watch(inotify_fd, usr_root_dir, WATCH_MASK);
+    root_wd = inotify_add_watch(inotify_fd, root_dir, WATCH_MASK);
+    for (size_t i = 0; i < projects_length; i++) {
+        struct project *project = &projects[i];
+        project->usr_dropin_wd = project->dropin_wd = -1;
+        if (snprintf(path, sizeof(path), "%s/%s.d", usr_root_dir,
+                     project->name) < (int) sizeof(path))
+            project->usr_dropin_wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+        if (snprintf(path, sizeof(path), "%s/%s.d", root_dir,
+                     project->name) < (int) sizeof(path))
+            project->dropin_wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+    }
+}
+
+/**
+ * @brief Whether an entry of a root directory belongs to the project:
+ *        its file or its drop-in directory.
+ */
+static bool is_project_entry(const struct project *project, const char *name)
+{
+    size_t length = strlen(project->name);
+    return strncmp(name, project->name, length) == 0 &&
+        (name[length] == '\0' || strcmp(name + length, ".d") == 0);
+}
+
+/**
+ * @brief Whether a file of a drop-in directory is read, see
+ *        econf_readDirs().
+ */
+static bool is_dropin_entry(const struct project *project, const char *name)
+{
+    if (project->suffix == NULL)
+        return true;
+    size_t length = strlen(name), suffix_length = strlen(project->suffix);
+    return length > suffix_length &&
+        name[length - suffix_length - 1] == '.' &&
+        strcmp(name + length - suffix_length, project->suffix) == 0;
+}
+
+/**
+ * @brief Mark the projects whose files are touched by the inotify
+ *        events. Returns whether a project has to be reloaded.
+ */
+static bool handle_events(void)
+{
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    bool changed = false;
+
+    while ((length = read(inotify_fd, events, sizeof(events))) > 0) {
+        for (char *p = events; p < events + length;) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+            const char *name = event->len ? event->name : "";
+            p += sizeof(struct inotify_event) + event->len;
+
+            /* Events have been lost or a root directory itself has
+               been removed or moved */
+            bool all = (event->mask & IN_Q_OVERFLOW) ||
+                ((event->wd == usr_root_wd || event->wd == root_wd) &&
+                 (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)));
+            for (size_t i = 0; i < projects_length; i++) {
+                struct project *project = &projects[i];
+                bool dropin = event->wd >= 0 &&
+                    (event->wd == project->usr_dropin_wd || event->wd == project->dropin_wd);
+                bool root = event->wd >= 0 &&
+                    (event->wd == usr_root_wd || event->wd == root_wd);
+                if (all || (dropin && (*name == '\0' || is_dropin_entry(project, name))) ||
+                    (root && *name && is_project_entry(project, name))) {
+                    project->changed = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return changed;
+}
+/**
+ * @brief Read the files of a project again. The old configuration is
+ *        kept if the new one cannot be parsed.
+ */
+static void load_project(struct project *project)
+{
+    econf_file *key_file = NULL;
+    econf_err error = econf_readDirs(&key_file, usr_root_dir, root_dir,
+                                     project->basename, project->suffix,
+                                     "=", "#");
+    if (error && error != ECONF_NOFILE) {
+        fprintf(stderr, "%s: cannot load %s: %s\n", utilname, project->name,
+                econf_errString(error));
+        return;
+    }
+    econf_free(project->key_file);
+    project->key_file = error ? NULL : key_file;
+    if (project->snapshot_fd >= 0) {
+        close(project->snapshot_fd);
+        project->snapshot_fd = -1;
+    }
+}
+
+/**
+ * @brief Reload the changed projects and watch drop-in directories
+ *        which have been created in the meantime.
+ */
+static void load_projects(void)
+{
+    for (size_t i = 0; i < projects_length; i++) {
+        if (projects[i].changed) {
+            projects[i].changed = false;
+            load_project(&projects[i]);
+        }
+    }
+    add_watches();
+}
+
+static struct project *find_project(const char *name)
+{
+    for (size_t i = 0; i < projects_length; i++) {
+        if (strcmp(projects[i].name, name) == 0)
+            return &projects[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Append a response to the output of the client.
+ */
+static bool append_response(struct client *c, econf_err error,
+                            const void *value, size_t length)
+{
+    uint32_t frame[2] = { sizeof(uint32_t) + length, error };
+
+    if (c->out_start) {
+        memmove(c->out, c->out + c->out_start, c->out_length);
+        c->fd_offset -= c->out_start;
+        c->out_start = 0;
+    }
+    size_t needed = c->out_length + sizeof(frame) + length;
+    if (needed > c->out_alloc_length) {
+        size_t alloc_length = c->out_alloc_length ? c->out_alloc_length : 4096;
+        while (alloc_length < needed)
+            alloc_length *= 2;
+        char *tmp = realloc(c->out, alloc_length);
+        if (tmp == NULL)
+            return false;
+        c->out = tmp;
+        c->out_alloc_length = alloc_length;
+    }
+    memcpy(c->out + c->out_length, frame, sizeof(frame));
+    if (length)
+        memcpy(c->out + c->out_length + sizeof(frame), value, length);
+    c->out_length = needed;
+    return true;
+}
+
+static bool append_snapshot(struct client *c, struct project *project)
+{
+    econf_err error = ECONF_NOFILE;
+
+    if (project && project->key_file) {
+        error = ECONF_SUCCESS;
+        if (project->snapshot_fd < 0)
+            error = econf_publish(project->key_file, &project->snapshot_fd);
+    }
+    if (error)
+        return append_response(c, error, NULL, 0);
+
+    /* The snapshot may be replaced before the response has been sent */
+    int fd = fcntl(project->snapshot_fd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return append_response(c, ECONF_ERROR, NULL, 0);
+    if (!append_response(c, ECONF_SUCCESS, NULL, 0)) {
+        close(fd);
+        return false;
+    }
+    /* append_response() may have moved the pending output */
+    c->fd_offset = c->out_length - 2 * sizeof(uint32_t);
+    c->passed_fd = fd;
+    return true;
+}
+
+/**
+ * @brief Answer one request with the same econf_get*Value() function
+ *        an application would call.
+ */
+static bool handle_request(struct client *c, unsigned char type,
+                           const char *name, const char *group,
+                           const char *key)
+{
+    struct project *project = find_project(name);
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    } number = { 0 };
+    econf_err error;
+
+    if (type == ECONFD_GET_SNAPSHOT)
+        return append_snapshot(c, project);
+    if (project == NULL || project->key_file == NULL)
+        return append_response(c, ECONF_NOFILE, NULL, 0);
+    if (!*group)
+        group = NULL;
+
+    econf_file *kf = project->key_file;
+    switch (type) {
+    case ECONFD_GET_STRING: {
+        char *value;
+        if ((error = econf_getStringValue(kf, group, key, &value)))
+            return append_response(c, error, NULL, 0);
+        bool ret = append_response(c, ECONF_SUCCESS, value, strlen(value) + 1);
+        free(value);
+        return ret;
+    }
+    case ECONFD_GET_INT: {
+        int32_t value;
+        if (!(error = econf_getIntValue(kf, group, key, &value)))
+            number.i = value;
+        break;
+    }
+    case ECONFD_GET_INT64: {
+        int64_t value;
+        if (!(error = econf_getInt64Value(kf, group, key, &value)))
+            number.i = value;
+        break;
+    }
+    case ECONFD_GET_UINT: {
+        uint32_t value;
+        if (!(error = econf_getUIntValue(kf, group, key, &value)))
+            number.u = value;
+        break;
+    }
+    case ECONFD_GET_UINT64: {
+        uint64_t value;
+        if (!(error = econf_getUInt64Value(kf, group, key, &value)))
+            number.u = value;
+        break;
+    }
+    case ECONFD_GET_FLOAT: {
+        float value;
+        if (!(error = econf_getFloatValue(kf, group, key, &value)))
+            number.d = value;
+        break;
+    }
+    case ECONFD_GET_DOUBLE: {
+        double value;
+        if (!(error = econf_getDoubleValue(kf, group, key, &value)))
+            number.d = value;
+        break;
+    }
+    case ECONFD_GET_BOOL: {
+        bool value;
+        if (!(error = econf_getBoolValue(kf, group, key, &value)))
+            number.u = value;
+        break;
+    }
+    default:
+        error = ECONF_ERROR;
+        break;
+    }
+    if (error)
+        return append_response(c, error, NULL, 0);
+    return append_response(c, ECONF_SUCCESS, &number, sizeof(number));
+}
+
+/**
+ * @brief Answer all complete requests which have been received. Returns
+ *        false if the client has to be disconnected.
+ */
+static bool process_requests(struct client *c)
+{
+    size_t pos = 0;
+    bool ret = true;
+
+    while (c->out_length < OUTPUT_LIMIT && c->in_length - pos >= sizeof(uint32_t)) {
+        uint32_t length;
+        memcpy(&length, c->in + pos, sizeof(length));
+        if (length < 4 || length > ECONFD_MAX_REQUEST) {
+            ret = false;
+            break;
+        }
+        if (c->in_length - pos - sizeof(length) < length)
+            break;
+
+        const char *frame = c->in + pos + sizeof(length);
+        const char *end = frame + length;
+        const char *project = frame + 1, *group = NULL, *key = NULL;
+        const char *nul = memchr(project, 0, end - project);
+        if (nul) {
+            group = nul + 1;
+            nul = memchr(group, 0, end - group);
+        }
+        if (nul) {
+            key = nul + 1;
+            nul = memchr(key, 0, end - key);
+        }
+        if (nul == NULL) {
+            ret = false;
+            break;
+        }
+        /* Only one snapshot can be in flight */
+        if (frame[0] == ECONFD_GET_SNAPSHOT && c->passed_fd >= 0)
+            break;
+        if (!handle_request(c, frame[0], project, group, key)) {
+            ret = false;
+            break;
+        }
+        pos += sizeof(length) + length;
+    }
+    memmove(c->in, c->in + pos, c->in_length - pos);
+    c->in_length -= pos;
+    return ret;
+}
+
+static ssize_t send_with_fd(int fd, char *buffer, size_t length, int passed_fd)
+{
+    struct iovec iov = { .iov_base = buffer, .iov_len = length };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    memset(&control, 0, sizeof(control));
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &passed_fd, sizeof(int));
+    return sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+/**
+ * @brief Send as many responses as possible without blocking. Returns
+ *        false if the client has to be disconnected.
+ */
+static bool flush_responses(struct client *c)
+{
+    while (c->out_length > 0) {
+        char *buffer = c->out + c->out_start;
+        size_t length = c->out_length;
+        bool with_fd = false;
+        ssize_t n;
+
+        if (c->passed_fd >= 0) {
+            if (c->fd_offset > c->out_start)
+                length = c->fd_offset - c->out_start;
+            else
+                with_fd = true;
+        }
+        if (with_fd)
+            n = send_with_fd(c->fd, buffer, length, c->passed_fd);
+        else
+            n = send(c->fd, buffer, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (with_fd) {
+            close(c->passed_fd);
+            c->passed_fd = -1;
+        }
+        c->out_start += n;
+        c->out_length -= n;
+    }
+    c->out_start = 0;
+    return true;
+}
+
+/**
+ * @brief Read requests of the client, answer them and send the
+ *        responses. Returns false if the client has to be disconnected.
+ */
+/**
+ * @brief Process the buffered requests and send their responses. A
+ *        snapshot stops the processing until its fd has been sent, so
+ *        the requests are processed again after every flush which
+ *        empties the output; nothing else would pick them up.
+ */
+static bool serve_requests(struct client *c)
+{
+    for (;;) {
+        if (!flush_responses(c))
+            return false;
+        /* The rest is processed when the client can take more output */
+        if (c->out_length > 0)
+            return true;
+        size_t in_length = c->in_length;
+        if (!process_requests(c))
+            return false;
+        if (c->in_length == in_length)
+            return true;
+    }
+}
+
+static bool read_requests(struct client *c)
+{
+    size_t size = sizeof(uint32_t) + ECONFD_MAX_REQUEST;
+
+    if (c->in_length < size) {
+        ssize_t n = recv(c->fd, c->in + c->in_length, size - c->in_length, 0);
+        if (n == 0)
+            return false;
+        if (n < 0)
+            return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+        c->in_length += n;
+    }
+    return serve_requests(c);
+}
+
+static void close_client(struct client *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    if (c->passed_fd >= 0)
+        close(c->passed_fd);
+    free(c->in);
+    free(c->out);
+}
+
+static void accept_clients(int listen_fd)
+{
+    int fd;
+
+    while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (clients_length == clients_alloc_length) {
+            size_t alloc_length = clients_alloc_length ? clients_alloc_length * 2 : 16;
+            struct client *tmp = realloc(clients, alloc_length * sizeof(struct client));
+            if (tmp == NULL) {
+                close(fd);
+                return;
+            }
+            clients = tmp;
+            clients_alloc_length = alloc_length;
+        }
+        struct client *c = &clients[clients_length];
+        memset(c, 0, sizeof(*c));
+        c->in = malloc(sizeof(uint32_t) + ECONFD_MAX_REQUEST);
+        if (c->in == NULL) {
+            close(fd);
+            return;
+        }
+        c->fd = fd;
+        c->passed_fd = -1;
+        clients_length++;
+    }
+}
+
+static int open_socket(void)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path %s is too long\n", utilname, socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket() failed");
+        return -1;
+    }
+    unlink(socket_path);
+    /* The socket is created without any permissions, so nobody can
+       connect before its mode has been set */
+    mode_t old_umask = umask(0777);
+    int ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+    umask(old_umask);
+    if (ret < 0 || chmod(socket_path, socket_mode) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "%s: cannot listen on %s: %s\n", utilname, socket_path,
+                strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Serve the clients until SIGTERM or SIGINT is received.
+ */
+static int serve(int listen_fd, int signal_fd)
+{
+    struct pollfd *fds = NULL;
+    long long reload_at = -1;
+    enum { POLL_LISTEN, POLL_INOTIFY, POLL_SIGNAL, POLL_CLIENTS };
+
+    for (;;) {
+        struct pollfd *tmp = realloc(fds, (POLL_CLIENTS + clients_length) * sizeof(struct pollfd));
+        if (tmp == NULL) {
+            fprintf(stderr, "%s: out of memory\n", utilname);
+            free(fds);
+            return EXIT_FAILURE;
+        }
+        fds = tmp;
+        fds[POLL_LISTEN] = (struct pollfd) { .fd = listen_fd, .events = POLLIN };
+        fds[POLL_INOTIFY] = (struct pollfd) { .fd = inotify_fd, .events = POLLIN };
+        fds[POLL_SIGNAL] = (struct pollfd) { .fd = signal_fd, .events = POLLIN };
+        size_t polled = clients_length;
+        for (size_t i = 0; i < polled; i++) {
+            struct client *c = &clients[i];
+            fds[POLL_CLIENTS + i].fd = c->fd;
+            fds[POLL_CLIENTS + i].events = 0;
+            fds[POLL_CLIENTS + i].revents = 0;
+            if (c->out_length < OUTPUT_LIMIT)
+                fds[POLL_CLIENTS + i].events |= POLLIN;
+            if (c->out_length > 0)
+                fds[POLL_CLIENTS + i].events |= POLLOUT;
+        }
+
+        int timeout = -1;
+        if (reload_at >= 0) {
+            long long delay = reload_at - now_ms();
+            timeout = delay > 0 ? (int) delay : 0;
+        }
+        if (poll(fds, POLL_CLIENTS + polled, timeout) < 0 && errno != EINTR) {
+            perror("poll() failed");
+            free(fds);
+            return EXIT_FAILURE;
+        }
+
+        if (fds[POLL_SIGNAL].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGHUP) {
+                    for (size_t i = 0; i < projects_length; i++)
+                        projects[i].changed = true;
+                    reload_at = 0;
+                } else {
+                    free(fds);
+                    return EXIT_SUCCESS;
+                }
+            }
+        }
+        if ((fds[POLL_INOTIFY].revents & POLLIN) && handle_events() &&
+            reload_at < 0)
+            reload_at = now_ms() + RELOAD_DELAY_MS;
+        if (reload_at >= 0 && now_ms() >= reload_at) {
+            load_projects();
+            reload_at = -1;
+        }
+
+        for (size_t i = 0; i < polled; i++) {
+            struct client *c = &clients[i];
+            short revents = fds[POLL_CLIENTS + i].revents;
+            bool ok = true;
+            if (revents & POLLIN)
+                ok = read_requests(c);
+            else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                ok = false;
+            if (ok && (revents & POLLOUT))
+                ok = serve_requests(c);
+            if (!ok)
+                close_client(c);
+        }
+        /* Remove the closed connections */
+        size_t length = 0;
+        for (size_t i = 0; i < clients_length; i++) {
+            if (clients[i].fd >= 0)
+                clients[length++] = clients[i];
+        }
+        clients_length = length;
+
+        if (fds[POLL_LISTEN].revents & POLLIN)
+            accept_clients(listen_fd);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option longopts[] = {
+        {"socket", required_argument, NULL, 's'},
+        {"socket-mode", required_argument, NULL, 'm'},
+        {"vendordir", required_argument, NULL, 'v'},
+        {"etcdir", required_argument, NULL, 'e'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "hs:", longopts, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'm': {
+            char *end;
+            unsigned long mode = strtoul(optarg, &end, 8);
+            if (*optarg == '\0' || *end != '\0' || mode > 0777) {
+                fprintf(stderr, "%s: invalid socket mode %s\n", utilname, optarg);
+                return EXIT_FAILURE;
+            }
+            socket_mode = mode;
+            break;
+        }
+        case 'v':
+            usr_root_dir = optarg;
+            break;
+        case 'e':
+            root_dir = optarg;
+            break;
+        case 'h':
+            usage();
+            return EXIT_SUCCESS;
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    projects_length = argc - optind;
+    projects = calloc(projects_length, sizeof(struct project));
+    if (projects == NULL) {
+        fprintf(stderr, "%s: out of memory\n", utilname);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < projects_length; i++) {
+        struct project *project = &projects[i];
+        project->name = argv[optind + i];
+        project->basename = strdup(project->name);
+        project->snapshot_fd = -1;
+        project->changed = true;
+        if (project->basename == NULL) {
+            fprintf(stderr, "%s: out of memory\n", utilname);
+            return EXIT_FAILURE;
+        }
+        char *dot = strrchr(project->basename, '.');
+        if (dot && dot != project->basename) {
+            *dot = '\0';
+            project->suffix = dot + 1;
+        }
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    int signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (signal_fd < 0 || inotify_fd < 0) {
+        perror("cannot set up the event handling");
+        return EXIT_FAILURE;
+    }
+
+    /* The socket is created after loading, so the clients never see a
+       daemon without configuration */
+    load_projects();
+    int listen_fd = open_socket();
+    if (listen_fd < 0)
+        return EXIT_FAILURE;
+
+    int ret = serve(listen_fd, signal_fd);
+
+    unlink(socket_path);
+    close(listen_fd);
+    for (size_t i = 0; i < clients_length; i++)
+        close_client(&clients[i]);
+    free(clients);
+    for (size_t i = 0; i < projects_length; i++) {
+        econf_free(projects[i].key_file);
+        if (projects[i].snapshot_fd >= 0)
+            close(projects[i].snapshot_fd);
+        free(projects[i].basename);
+    }
+    free(projects);
+    close(inotify_fd);
+    close(signal_fd);
+    return ret;
+}
@@ -20,9 +20,11 @@
   SOFTWARE.
 */
 
+#include <ctype.h>
 #include <errno.h>
 #include <ftw.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -37,6 +39,8 @@
 
 static const char *utilname = "econftool";
 static bool non_interactive = false;
+static bool show_stats = false;
+static const char *lookups_file = NULL; /* keys read by an application */
 static char *conf_suffix = NULL; /* the suffix of the filename e.g. .conf */
 static char conf_dir[PATH_MAX] = {0}; /* the directory of the config file */
 static char conf_basename[PATH_MAX] = {0}; /* the filename without the suffix */
@@ -57,10 +61,15 @@ static void usage(void)
     fprintf(stderr, "         and prints all groups,keys and their values.\n");
     fprintf(stderr, "         The root directories is /. It can be set by the environment\n");
     fprintf(stderr, "         variable $ECONFTOOL_ROOT \n");
+    fprintf(stderr, "  --stats:         prints the statistics of loading the files.\n");
+    fprintf(stderr, "  --lookups=FILE:  looks up the keys listed in FILE (one [group]key\n");
+    fprintf(stderr, "                   per line, - for stdin) and reports the hot keys,\n");
+    fprintf(stderr, "                   the keys which are never read and the missing keys.\n");
     fprintf(stderr, "cat      prints the content of the files and the name of the file in the order\n");
     fprintf(stderr, "         as it has been read.\n");
     fprintf(stderr, "edit     starts the editor $EDITOR (environment variable) where the\n");
     fprintf(stderr, "         groups, keys and values can be modified and saved afterwards.\n");
+    fprintf(stderr, "         As root only the changes are stored in a drop-in file.\n");
     fprintf(stderr, "  -f, --full:      copy the original configuration file to /etc instead of\n");
     fprintf(stderr, "                   creating drop-in files.\n");
     fprintf(stderr, "  --use-home:      only has an effect if the user is root.\n");
@@ -127,14 +136,6 @@ static int generate_tmp_file(char *tmp_name)
     return 0;
 }
 
-/**
- * @brief freeing used memory which has been used for groups
- */
-static void free_groups(char ***groups)
-{
-    econf_free(*groups);
-}
-
 /**
  * @brief printing header
  */
@@ -146,14 +147,59 @@ static void pr_header(void)
   printf ("Suffix: %s\n",conf_suffix);
 }
 
+/**
+ * @brief printing one value. Multiline values are split into lines
+ *        and trimmed the same way as econf_getExtValue() does it.
+ */
+static void pr_value(const char *key, const char *value)
+{
+    const char *end, *next;
+    bool first = true;
+
+    if (value == NULL)
+        value = "";
+    while (isspace((unsigned char)*value))
+        value++;
+    end = value + strlen(value);
+    while (end > value && isspace((unsigned char)end[-1]))
+        end--;
+
+    if (*value == '"') {
+        /* one quoted string only */
+        printf("%s = %.*s\n", key, (int)(end - value), value);
+        return;
+    }
+
+    do {
+        const char *line = value, *line_end;
+
+        next = memchr(value, '\n', end - value);
+        line_end = next ? next : end;
+        while (line < line_end && isspace((unsigned char)*line))
+            line++;
+        while (line_end > line && isspace((unsigned char)line_end[-1]))
+            line_end--;
+        if (first) {
+            printf("%s = %.*s\n", key, (int)(line_end - line), line);
+            first = false;
+        } else {
+            printf("     %.*s\n", (int)(line_end - line), line);
+        }
+        value = next + 1;
+    } while (next);
+}
+
 /**
  * @brief printing one key_file entry
  */
 static econf_err pr_key_file(struct econf_file *key_file)
 {
-    char **groups __attribute__ ((__cleanup__(free_groups))) = NULL;
-    econf_ext_value *value = NULL;
-    size_t groupCount = 0;
+    econf_entry entry;
+    const char *group = NULL;
+    /* keys of the current group which have been printed */
+    const char **keys = NULL;
+    size_t keys_length = 0, keys_alloc_length = 0;
+    size_t cursor = 0;
     econf_err econf_error;
 
     fprintf(stderr, "----------------------------------\n");
@@ -165,48 +211,144 @@ static econf_err pr_key_file(struct econf_file *key_file)
     free(path);
 
     /* show groups, keys and their value */
-    econf_error = econf_getGroups(key_file, &groupCount, &groups);
-    if (econf_error) {
+    while ((econf_error = econf_nextEntry(key_file, &cursor, &entry)) == ECONF_SUCCESS) {
+        /* keys without a group are not shown */
+        if (entry.group == NULL)
+            continue;
+        if (group == NULL || strcmp(group, entry.group) != 0) {
+            if (group != NULL)
+                printf("\n");
+            printf("%s\n", entry.group);
+            group = entry.group;
+            keys_length = 0;
+        }
+        /* Only the first entry of a key is returned by econf_get*Value() */
+        bool duplicate = false;
+        for (size_t i = 0; i < keys_length && !duplicate; i++)
+            duplicate = strcmp(keys[i], entry.key) == 0;
+        if (duplicate)
+            continue;
+        if (keys_length == keys_alloc_length) {
+            size_t alloc_length = keys_alloc_length ? keys_alloc_length * 2 : 16;
+            const char **tmp = realloc(keys, alloc_length * sizeof(*keys));
+            if (tmp == NULL) {
+                free(keys);
+                fprintf(stderr, "%d: %s\n", ECONF_NOMEM, econf_errString(ECONF_NOMEM));
+                return ECONF_NOMEM;
+            }
+            keys = tmp;
+            keys_alloc_length = alloc_length;
+        }
+        keys[keys_length++] = entry.key;
+        pr_value(entry.key, entry.value);
+    }
+    free(keys);
+    if (econf_error == ECONF_NOKEY && group == NULL)
+        econf_error = ECONF_NOGROUP;
+    if (econf_error != ECONF_NOKEY) {
         fprintf(stderr, "%d: %s\n", econf_error, econf_errString(econf_error));
         return econf_error;
     }
-    for (size_t g = 0; g < groupCount; g++) {
-        char **keys = NULL;
-        size_t key_count = 0;
+    printf("\n");
+    return ECONF_SUCCESS;
+}
 
-        econf_error = econf_getKeys(key_file, groups[g], &key_count, &keys);
-        if (econf_error) {
-            fprintf(stderr, "%d: %s\n", econf_error, econf_errString(econf_error));
-            econf_free(keys);
-            return econf_error;
-        }
-        printf("%s\n", groups[g]);
-        for (size_t k = 0; k < key_count; k++) {
-            econf_error = econf_getExtValue(key_file, groups[g], keys[k], &value);
-            if (econf_error) {
-                fprintf(stderr, "%d: %s\n", econf_error, econf_errString(econf_error));
-                econf_free(keys);
-                return econf_error;
-            }
-            if (value != NULL) {
-	      size_t v = 0;
-	      while (value->values[v] != 0) {
-		if (v==0) {
-		  printf("%s = %s\n", keys[k], value->values[v]);
-		} else {
-		  printf("     %s\n", value->values[v]);
-		}
-		v++;
-	      }
-	      econf_freeExtValue(value);
-	    }
+
+/**
+ * @brief printing the statistics of loading key_file
+ */
+static void pr_stats(struct econf_file *key_file)
+{
+    econf_stats stats;
+
+    if (econf_getStats(key_file, &stats))
+        return;
+
+    fprintf(stderr, "----------------------------------\n");
+    fprintf(stderr, "Files: %" PRIu64 ", bytes: %" PRIu64 ", lines: %" PRIu64
+            ", entries: %" PRIu64 ", allocations: %" PRIu64 "\n",
+            stats.files, stats.bytes, stats.lines, stats.entries,
+            stats.allocations);
+    fprintf(stderr, "Time (ns): scan %" PRIu64 ", parse %" PRIu64 ", join %" PRIu64
+            ", merge %" PRIu64 ", total %" PRIu64 "\n\n",
+            stats.scan_ns, stats.parse_ns, stats.join_ns, stats.merge_ns,
+            stats.total_ns);
+    for (size_t i = 0; i < stats.file_stats_length; i++) {
+        const econf_file_stats *fs = &stats.file_stats[i];
+        fprintf(stderr, "%s\n", fs->path);
+        fprintf(stderr, "  bytes: %" PRIu64 ", lines: %" PRIu64 ", entries: %" PRIu64
+                ", allocations: %" PRIu64 "\n",
+                fs->bytes, fs->lines, fs->entries, fs->allocations);
+        fprintf(stderr, "  time (ns): parse %" PRIu64 ", join %" PRIu64 "\n",
+                fs->parse_ns, fs->join_ns);
+    }
+}
+
+/**
+ * @brief looking up all keys listed in lookups_file. A line is either
+ *        "key" or "[group]key".
+ */
+static int lookup_keys(struct econf_file *key_file)
+{
+    FILE *fp = strcmp(lookups_file, "-") ? fopen(lookups_file, "r") : stdin;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", lookups_file, strerror(errno));
+        return -1;
+    }
+    while ((length = getline(&line, &size, fp)) != -1) {
+        char *group = NULL, *key = line, *value = NULL, *end;
+
+        while (length > 0 && isspace((unsigned char)line[length - 1]))
+            line[--length] = '\0';
+        while (isspace((unsigned char)*key))
+            key++;
+        if (*key == '[' && (end = strchr(key, ']')) != NULL) {
+            group = strndup(key, end + 1 - key);
+            key = end + 1;
         }
-        printf("\n");
-        econf_free(keys);
+        if (*key != '\0' && econf_getStringValue(key_file, group, key, &value) == ECONF_SUCCESS)
+            free(value);
+        free(group);
     }
-    return ECONF_SUCCESS;
+    free(line);
+    if (fp != stdin)
+        fclose(fp);
+    return 0;
 }
 
+/**
+ * @brief printing the report of the keys which have been looked up
+ */
+static void pr_lookups(struct econf_file *key_file)
+{
+    econf_lookup *lookups;
+    size_t length;
+
+    if (econf_getLookups(key_file, &lookups, &length))
+        return;
+
+    fprintf(stderr, "----------------------------------\n");
+    fprintf(stderr, "Hot keys:\n");
+    for (size_t i = 0; i < length; i++)
+        if (lookups[i].found && lookups[i].count > 0)
+            fprintf(stderr, "%10" PRIu64 " %s%s\n", lookups[i].count,
+                    lookups[i].group ? lookups[i].group : "", lookups[i].key);
+    fprintf(stderr, "\nNever read:\n");
+    for (size_t i = 0; i < length; i++)
+        if (lookups[i].found && lookups[i].count == 0)
+            fprintf(stderr, "           %s%s\n",
+                    lookups[i].group ? lookups[i].group : "", lookups[i].key);
+    fprintf(stderr, "\nMissing:\n");
+    for (size_t i = 0; i < length; i++)
+        if (!lookups[i].found)
+            fprintf(stderr, "%10" PRIu64 " %s%s\n", lookups[i].count,
+                    lookups[i].group ? lookups[i].group : "", lookups[i].key);
+    econf_freeLookups(lookups);
+}
 
 /**
  * @brief This command will read all snippets for filename.conf
@@ -216,14 +358,34 @@ static econf_err pr_key_file(struct econf_file *key_file)
 static int econf_show(struct econf_file **key_file)
 {
     econf_err econf_error;
-    econf_error = econf_readDirs(key_file, usr_root_dir, root_dir, conf_basename,
-                                 conf_suffix, "=", "#");
+    econf_options *options = NULL;
+
+    if ((show_stats || lookups_file) &&
+        ((econf_error = econf_newOptions(&options)) ||
+         (econf_error = econf_setOpt(options, ECONF_OPT_STATS, show_stats)) ||
+         (econf_error = econf_setOpt(options, ECONF_OPT_PROFILE_LOOKUPS,
+                                     lookups_file != NULL)))) {
+        fprintf(stderr, "%d: %s\n", econf_error, econf_errString(econf_error));
+        econf_freeOptions(options);
+        return -1;
+    }
+    econf_error = econf_readDirsWithOptions(key_file, usr_root_dir, root_dir,
+                                            conf_basename, conf_suffix, "=", "#",
+                                            options);
+    econf_freeOptions(options);
     if (econf_error) {
         fprintf(stderr, "%d: %s\n", econf_error, econf_errString(econf_error));
         return -1;
     }
     pr_header();
     pr_key_file(*key_file);
+    if (show_stats)
+        pr_stats(*key_file);
+    if (lookups_file) {
+        if (lookup_keys(*key_file))
+            return -1;
+        pr_lookups(*key_file);
+    }
     return 0;
 }
 
@@ -328,11 +490,33 @@ static int econf_edit_editor(struct econf_file **key_file_edit, struct econf_fil
     return ret;
 }
 
+/**
+ * @brief Writes key_file_edit to conf_dir/conf_filename. A drop-in file
+ *        only gets the entries which differ from key_file.
+ */
+static int write_edited_file(econf_file *key_file, econf_file *key_file_edit,
+                             bool write_dropin)
+{
+    econf_err econf_error;
+
+    printf( "Writing file %s to %s\n",conf_filename, conf_dir);
+    if (write_dropin)
+        econf_error = econf_writeDropIn(key_file, key_file_edit, conf_dir, conf_filename, 0);
+    else
+        econf_error = econf_writeFile(key_file_edit, conf_dir, conf_filename);
+    if (econf_error) {
+        fprintf(stderr, "%s\n", econf_errString(econf_error));
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief This command will start an editor (EDITOR environment variable),
  *        which shows all groups, keys and their values (like econftool
  *        show output), allows the admin to modify them, and stores the
- *        changes afterwards in a drop-in file in /etc/filename.conf.d/.
+ *        changed and added keys afterwards in a drop-in file in
+ *        /etc/filename.conf.d/.
  *
  * --full: copy the original config file to /etc instead of creating drop-in
  *         files.
@@ -343,7 +527,7 @@ static int econf_edit_editor(struct econf_file **key_file_edit, struct econf_fil
  *  TODO:
  *      - Replace static values of the path with future libeconf API calls
  */
-static int econf_edit(struct econf_file **key_file)
+static int econf_edit(struct econf_file **key_file, bool write_dropin)
 {
     econf_err econf_error;
     econf_file *key_file_edit = NULL;
@@ -369,30 +553,7 @@ static int econf_edit(struct econf_file **key_file)
         return -1;
     }
 
-    /*********************************************************************/
-    /* TODO: analyse the key_files of the 2 tmp files to extract the change
-     * - starting with groups, then keys and then values
-     */
     int ret = 0;
-    char **groups = NULL;
-    char **groupsEdit = NULL;
-    size_t groupCount = 0;
-    size_t groupEditCount = 0;
-
-    /* extract the groups of the original key_file into groups */
-    econf_error = econf_getGroups(*key_file, &groupCount, &groups);
-    if (econf_error) {
-        fprintf(stderr, "%s\n", econf_errString(econf_error));
-        ret = -1;
-        goto cleanup;
-    }
-    /* extract the groups of the edited key_file into groupsEdit */
-    econf_error = econf_getGroups(key_file_edit, &groupEditCount, &groupsEdit);
-    if (econf_error) {
-        fprintf(stderr, "%s\n", econf_errString(econf_error));
-        ret = -1;
-        goto cleanup;
-    }
 
     /* if path does not exist, create it */
     if (access(conf_dir, F_OK) == -1 && errno == ENOENT) {
@@ -416,27 +577,15 @@ static int econf_edit(struct econf_file **key_file)
         } while (strcmp(input, "y") != 0 && strcmp(input, "n") != 0);
 
         if (strcmp(input, "y") == 0) {
-            printf( "Writing file %s to %s\n",conf_filename, conf_dir);
-            if ((econf_error = econf_writeFile(key_file_edit, conf_dir, conf_filename))) {
-                fprintf(stderr, "%s\n", econf_errString(econf_error));
-                ret = -1;
-                goto cleanup;
-            }
+            ret = write_edited_file(*key_file, key_file_edit, write_dropin);
         }
     } else {
-        printf( "Writing file %s to %s\n",conf_filename, conf_dir);
-        if ((econf_error = econf_writeFile(key_file_edit, conf_dir, conf_filename))) {
-            fprintf(stderr, "%s\n", econf_errString(econf_error));
-            ret = -1;
-            goto cleanup;
-        }
+        ret = write_edited_file(*key_file, key_file_edit, write_dropin);
     }
 
     /* cleanup */
   cleanup:
     econf_free(key_file_edit);
-    econf_free(groupsEdit);
-    econf_free(groups);
     return ret;
 
 }
@@ -530,6 +679,8 @@ int main (int argc, char *argv[])
         {"help",        no_argument,       0, 'h'},
         {"yes",         no_argument,       0, 'y'},
         {"use-home",    no_argument,       0, 'u'},
+        {"stats",       no_argument,       0, 's'},
+        {"lookups",     required_argument, 0, 'l'},
         {0,             0,                 0,  0 }
     };
 
@@ -550,6 +701,12 @@ int main (int argc, char *argv[])
         case 'u':
             use_homedir = true;
             break;
+        case 's':
+            show_stats = true;
+            break;
+        case 'l':
+            lookups_file = optarg;
+            break;
         case '?':
         default:
             fprintf(stderr, "Try '%s --help' for more information.\n", utilname);
@@ -636,7 +793,7 @@ int main (int argc, char *argv[])
                     conf_filename);
         }
 
-        ret = econf_edit(&key_file);
+        ret = econf_edit(&key_file, is_dropin_file && is_root && !use_homedir);
     } else if (strcmp(argv[optind], "revert") == 0) {
         ret = econf_revert(is_root, use_homedir);
     } else if (strcmp(argv[optind], "cat") == 0) {